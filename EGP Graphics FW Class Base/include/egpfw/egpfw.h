@@ -17,6 +17,8 @@
 #include "egpfw/egpfw/egpfwPrimitiveDataSimple.h"
 #include "egpfw/egpfw/egpfwShaderProgram.h"
 #include "egpfw/egpfw/egpfwVertexBuffer.h"
+#include "egpfw/egpfw/egpfwStateCache.h"
+#include "egpfw/egpfw/egpfwTextureTable.h"
 
 #include "egpfw/egpfw/egpfwOBJLoader.h"
 #include "egpfw/egpfw/egpfwFrameBuffer.h"
@@ -29,6 +29,7 @@ extern "C"
 		COLOR_RGBA8,		// 4 channels, 8 bits (byte)
 		COLOR_RGBA16,		// 4 channels, 16 bits (short)
 		COLOR_RGBA32F,		// 4 channels, 32 bits (float, use sparingly)
+		COLOR_RG16,			// 2 channels, 16 bits (short, e.g. encoded normals)
 	};
 
 	// depth buffer format
@@ -72,10 +73,14 @@ extern "C"
 	// contains handle to internal FBO and information about its targets
 	// additionally, has a bunch of texture handles
 	// also contains formats as per the above enums
+	// frame size is the area drawn to (the viewport); texture size is what 
+	//	the targets were allocated at, which may be bigger if the FBO is 
+	//	drawn to in part (e.g. kept at its largest size through resizes)
 	struct egpFrameBufferObjectDescriptor
 	{
 		unsigned int glhandle;
 		unsigned int frameWidth, frameHeight;
+		unsigned int textureWidth, textureHeight;
 		unsigned int numColorTargets, hasDepthTarget, hasStencilTarget;
 		unsigned int colorTargetHandle[16], depthTargetHandle[1];
 		egpColorFormat colorFormat;
@@ -98,7 +103,14 @@ extern "C"
 	// the total number of targets must not be zero or nothing will be created
 	egpFrameBufferObjectDescriptor egpfwCreateFBO(const unsigned int frameWidth, const unsigned int frameHeight, const unsigned int numColorTargets, const egpColorFormat colorFormat, const egpDepthFormat depthFormat, const egpWrapSmoothFormat wrapSmoothFormat);
 
+	// generate a framebuffer object whose color targets each have their own 
+	//	format, e.g. a g-buffer packing each attribute as tightly as it can
+	// 'colorFormats' param holds 'numColorTargets' formats, none 'disable'
+	// otherwise the same as above
+	egpFrameBufferObjectDescriptor egpfwCreateFBOFormats(const unsigned int frameWidth, const unsigned int frameHeight, const unsigned int numColorTargets, const egpColorFormat *colorFormats, const egpDepthFormat depthFormat, const egpWrapSmoothFormat wrapSmoothFormat);
+
 	// bind a framebuffer for drawing
+	// the viewport is set to the FBO's frame size
 	// 'fbo' param can be null to deactivate FBO
 	void egpfwActivateFBO(const egpFrameBufferObjectDescriptor *fbo);
 
@@ -32,8 +32,21 @@ extern "C"
 		NORMAL_COMPUTE_TANGENT_VERTEX,	// compute full tangent basis per-vertex (texcoords must exist)
 	};
 
+	// mesh optimization flags, combine with bitwise or
+	enum egpMeshOptimizeFlag
+	{
+		OPTIMIZE_NONE = 0x00,			// keep triangles and vertices in file order
+		OPTIMIZE_VERTEX_CACHE = 0x01,	// reorder triangles for post-transform cache hits
+		OPTIMIZE_OVERDRAW = 0x02,		// reorder triangle clusters outside-in (implies cache pass)
+		OPTIMIZE_VERTEX_FETCH = 0x04,	// renumber vertices in order of first use
+		OPTIMIZE_REPORT = 0x08,			// print ACMR/ATVR before and after
+
+		OPTIMIZE_ALL = OPTIMIZE_VERTEX_CACHE | OPTIMIZE_OVERDRAW | OPTIMIZE_VERTEX_FETCH,
+	};
+
 #ifndef __cplusplus
 	typedef enum egpMeshNormalMode egpMeshNormalMode;
+	typedef enum egpMeshOptimizeFlag egpMeshOptimizeFlag;
 #endif	// __cplusplus
 
 
@@ -48,11 +61,15 @@ extern "C"
 	// NOTE: this is a SHARED RESOURCE; do not load the same OBJ multiple times
 	//	because that wastes memory; just *draw* it multiple times!
 	// stores all attribute data contiguously
+	// if loaded from binary, 'data' points into a mapped view of the file 
+	//	starting at 'mappedBase'; otherwise 'mappedBase' is null
 	struct egpTriOBJDescriptor
 	{
 		unsigned int attribOffset[16];
 		unsigned int dataSize;
 		void *data;
+		void *mappedBase;
+		unsigned long long mappedSize;
 	};
 
 
@@ -60,16 +77,47 @@ extern "C"
 // functions
 
 	// load triangulated OBJ file
-	// returns descriptor with fully-ordered, non-indexed attribute data
+	// returns descriptor with welded, indexed attribute data: every unique 
+	//	position/texcoord/normal combination becomes one vertex
+	// file is mapped and split into line-aligned chunks that are parsed on 
+	//	separate threads (streamed in one pass if it can't be mapped); there 
+	//	is no limit on the number of elements and v/vt/vn/f lines may appear 
+	//	in any order
+	// polygons with more than three corners are fanned into triangles
+	// compute modes replace the file's normals; tangent modes also fill the 
+	//	tangent and bitangent attributes (faces without texcoords get an 
+	//	arbitrary tangent perpendicular to the normal)
+	// computation is split across threads for big meshes
 	// 'objPath' param cannot be null or an empty string
+	// 'optimizeFlags' is any combination of egpMeshOptimizeFlag; the mesh is 
+	//	optimized after welding, so a binary saved afterwards keeps the result
 	// 'globalScale' will default to 1 if not positive
-	egpTriOBJDescriptor egpfwLoadTriangleOBJ(const char *objPath, const egpMeshNormalMode normalMode, const double globalScale);
+	egpTriOBJDescriptor egpfwLoadTriangleOBJ(const char *objPath, const egpMeshNormalMode normalMode, const unsigned int optimizeFlags, const double globalScale);
+
+	// reorder an already loaded OBJ's triangles and vertices
+	// can also be run on a binary OBJ; its mapped view is copy-on-write
+	// returns 1 if successful, 0 if failed (the OBJ is left unchanged)
+	// 'obj' param cannot be null and must be initialized
+	// 'flags' is any combination of egpMeshOptimizeFlag
+	int egpfwOptimizeOBJ(egpTriOBJDescriptor *obj, const unsigned int flags);
 
-	// convert OBJ to VAO & VBO
+	// measure how well an OBJ's index order uses a FIFO post-transform cache
+	// ACMR is transformed vertices per triangle (0.5 is ideal, 3 is worst)
+	// ATVR is transformed vertices per unique vertex (1 is ideal)
+	// returns 1 if successful, 0 if failed
+	// 'obj' param cannot be null and must be initialized
+	// 'acmr_out' and 'atvr_out' params can be null
+	int egpfwGetOBJCacheStats(const egpTriOBJDescriptor *obj, const unsigned int cacheSize, float *acmr_out, float *atvr_out);
+
+	// convert OBJ to VAO, VBO & IBO
+	// if 'packed' is nonzero the vertex is half the size: half float 
+	//	positions, 10:10:10 normals and tangents, and 16-bit normalized 
+	//	texcoords (half floats if any are outside [0, 1]); half positions 
+	//	only hold about 3 significant digits, so leave large meshes unpacked
 	// returns number of active attributes if successful, 0 if failed
 	// 'obj' param cannot be null and must be initialized
-	// 'vao_out' and 'vbo_out' params cannot be null and must be empty
-	int egpfwCreateVAOFromOBJ(const egpTriOBJDescriptor *obj, egpVertexArrayObjectDescriptor *vao_out, egpVertexBufferObjectDescriptor *vbo_out);
+	// 'vao_out', 'vbo_out' and 'ibo_out' params cannot be null and must be empty
+	int egpfwCreateVAOFromOBJ(const egpTriOBJDescriptor *obj, egpVertexArrayObjectDescriptor *vao_out, egpVertexBufferObjectDescriptor *vbo_out, egpIndexBufferObjectDescriptor *ibo_out, const int packed);
 
 	// free obj data
 	// returns 1 if successful, 0 if failed
@@ -77,6 +125,11 @@ extern "C"
 
 	// write binary version to file for fast loading next time
 	// additionally a load function which returns a new object
+	// the file is a versioned header (offsets, counts, checksum) followed by 
+	//	the data with every section aligned; loading maps the file instead 
+	//	of reading it, so attribute data can be sent to GL without a copy
+	// files with the wrong version or a bad checksum, or whose indices or 
+	//	attributes don't fit in the data, are rejected
 	// returns 1 if successful, 0 if failed
 	// 'obj' param cannot be null and must be initialized
 	// 'binPath' param cannot be null or an empty string
@@ -92,6 +145,13 @@ extern "C"
 	const void *egpfwGetOBJAttributeData(const egpTriOBJDescriptor *obj, const egpAttributeName attrib);
 	unsigned int egpfwGetOBJNumVertices(const egpTriOBJDescriptor *obj);
 
+	// get index data from OBJ
+	// 'obj' param cannot be null
+	// indices are 16-bit (ushort) if the vertex count allows, 32-bit otherwise
+	unsigned int egpfwGetOBJNumIndices(const egpTriOBJDescriptor *obj);
+	const void *egpfwGetOBJIndexData(const egpTriOBJDescriptor *obj);
+	egpIndexType egpfwGetOBJIndexType(const egpTriOBJDescriptor *obj);
+
 
 //-----------------------------------------------------------------------------
 
@@ -41,8 +41,86 @@ extern "C"
 	void egpfwSendUniformInt(int location, const egpUniformIntType type, const unsigned int count, const int *values);
 	void egpfwSendUniformFloat(int location, const egpUniformFloatType type, const unsigned int count, const float *values);
 	void egpfwSendUniformFloatMatrix(int location, const egpUniformFloatMatrixType type, const unsigned int count, const int transpose, const float *values);
-	
-		
+
+
+//-----------------------------------------------------------------------------
+// uniform buffers
+// blocks are declared 'layout (std140)' in GLSL: a C struct made of 4D 
+//	vectors and 4x4 matrices (scalars padded out to 16 bytes) has the 
+//	same layout and can be copied into the buffer as-is
+
+#ifndef __cplusplus
+	typedef struct egpUniformBufferObjectDescriptor egpUniformBufferObjectDescriptor;
+#endif	// __cplusplus
+
+	// uniform buffer object (UBO)
+	struct egpUniformBufferObjectDescriptor
+	{
+		unsigned int glhandle;
+		unsigned int size;
+	};
+
+	// create a uniform buffer of 'size' bytes
+	// 'data' param may be null to leave contents undefined
+	egpUniformBufferObjectDescriptor egpfwCreateUBO(const unsigned int size, const void *data);
+
+	// change part of a uniform buffer
+	// replacing the whole buffer lets the driver hand out new storage 
+	//	instead of waiting for draws still reading the old contents
+	void egpfwUpdateUBO(const egpUniformBufferObjectDescriptor *ubo, const unsigned int offset, const unsigned int size, const void *data);
+
+	// bind a whole buffer or a range of it to a block binding point
+	// range offsets must be multiples of the alignment below
+	void egpfwBindUBO(const egpUniformBufferObjectDescriptor *ubo, const unsigned int binding);
+	void egpfwBindUBORange(const egpUniformBufferObjectDescriptor *ubo, const unsigned int binding, const unsigned int offset, const unsigned int size);
+	unsigned int egpfwGetUBOOffsetAlignment();
+
+	// delete a uniform buffer
+	// returns 1 if success, 0 if failed
+	int egpfwReleaseUBO(egpUniformBufferObjectDescriptor *ubo);
+
+	// connect a program's named uniform block to a binding point
+	// returns 1 if the program has the block, 0 if not
+	int egpfwBindUniformBlock(const egpProgram *program, const char *blockName, const unsigned int binding);
+
+
+//-----------------------------------------------------------------------------
+// texture buffers
+// a buffer that GLSL reads as a samplerBuffer (or isampler/usampler) with 
+//	texelFetch: for arrays too long or too changeable for a uniform block
+
+#ifndef __cplusplus
+	typedef struct egpTextureBufferObjectDescriptor egpTextureBufferObjectDescriptor;
+#endif	// __cplusplus
+
+	// texture buffer object (TBO): the buffer and the texture reading it
+	struct egpTextureBufferObjectDescriptor
+	{
+		unsigned int glhandle;
+		unsigned int texhandle;
+		unsigned int format;
+		unsigned int size;
+	};
+
+	// create a texture buffer of 'size' bytes, read as texels of 'format' 
+	//	(a sized format, e.g. GL_RGBA32F or GL_R32UI)
+	// 'data' param may be null to leave contents undefined
+	egpTextureBufferObjectDescriptor egpfwCreateTBO(const unsigned int format, const unsigned int size, const void *data);
+
+	// replace the contents with 'size' bytes
+	// the buffer grows if it is too small and is orphaned either way, so 
+	//	draws still reading the old contents don't hold up the upload; the 
+	//	texture keeps its name, so bindings made with it stay valid
+	void egpfwUpdateTBO(egpTextureBufferObjectDescriptor *tbo, const unsigned int size, const void *data);
+
+	// bind the texture to a unit (unit is an index, not GL_TEXTURE0 + index)
+	void egpfwBindTBO(const egpTextureBufferObjectDescriptor *tbo, const unsigned int unit);
+
+	// delete a texture buffer
+	// returns 1 if success, 0 if failed
+	int egpfwReleaseTBO(egpTextureBufferObjectDescriptor *tbo);
+
+
 //-----------------------------------------------------------------------------
 
 
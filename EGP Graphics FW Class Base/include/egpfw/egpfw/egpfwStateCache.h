@@ -0,0 +1,125 @@
+/*
+	EGP Graphics Framework
+	(c) 2017 Dan Buckstein
+	GL state cache
+
+	Modified by: ______________________________________________________________
+*/
+
+#ifndef __EGPFW_STATECACHE_H
+#define __EGPFW_STATECACHE_H
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+// enums
+
+	// kinds of state the cache shadows, also used to index counters
+	enum egpStateKind
+	{
+		STATE_PROGRAM,			// bound GLSL program
+		STATE_FRAMEBUFFER,		// bound framebuffer
+		STATE_DRAW_BUFFERS,		// draw buffer list of each framebuffer
+		STATE_CAPABILITY,		// depth/stencil test, blending, culling
+		STATE_VIEWPORT,			// viewport rectangle
+		STATE_VERTEX_ARRAY,		// bound VAO
+		STATE_TEXTURE,			// texture bound to each unit
+		STATE_UNIFORM_BUFFER,	// buffer range bound to each block binding
+		STATE_UNIFORM,			// uniform values of each program
+
+		STATE_KIND_COUNT
+	};
+
+#ifndef __cplusplus
+	typedef enum egpStateKind egpStateKind;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+// data structures
+
+	// per-frame counters
+	// 'issued' calls went to GL, 'elided' calls were skipped because GL
+	//	already had that state
+	struct egpStateCacheStats
+	{
+		unsigned int issued[STATE_KIND_COUNT];
+		unsigned int elided[STATE_KIND_COUNT];
+	};
+
+#ifndef __cplusplus
+	typedef struct egpStateCacheStats egpStateCacheStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+// functions
+// the cache only knows what goes through it: any code that changes tracked
+//	state with GL directly must call the invalidate function afterwards
+// everything starts out unknown, so the first call of each kind always
+//	goes to GL
+
+	// bind program, framebuffer or VAO by GL handle (0 to unbind)
+	void egpfwStateUseProgram(const unsigned int glhandle);
+	void egpfwStateBindFramebuffer(const unsigned int glhandle);
+	void egpfwStateBindVertexArray(const unsigned int glhandle);
+
+	// set draw buffers of the bound framebuffer
+	// draw buffers belong to the framebuffer object, so this only reaches
+	//	GL the first time (or when the count changes) for each framebuffer
+	// 'buffers' param must hold at least 'count' attachment names
+	void egpfwStateDrawBuffers(const unsigned int count, const unsigned int *buffers);
+
+	// enable or disable a capability
+	// GL_DEPTH_TEST, GL_STENCIL_TEST, GL_BLEND and GL_CULL_FACE are tracked,
+	//	anything else always goes to GL
+	void egpfwStateSetCapability(const unsigned int cap, const int enabled);
+
+	// set viewport
+	void egpfwStateViewport(const int x, const int y, const int width, const int height);
+
+	// bind texture to a unit (unit is an index, not GL_TEXTURE0 + index)
+	// also switches the active unit, but only when the binding changes, so 
+	//	use the select version before changing a texture's data or parameters
+	void egpfwStateBindTexture(const unsigned int unit, const unsigned int target, const unsigned int glhandle);
+	void egpfwStateSelectTexture(const unsigned int unit, const unsigned int target, const unsigned int glhandle);
+
+	// bind a uniform buffer range to a block binding point
+	// 'size' param of zero binds the whole buffer
+	void egpfwStateBindUniformBuffer(const unsigned int binding, const unsigned int glhandle, const unsigned int offset, const unsigned int size);
+
+	// uniform check for the bound program
+	// returns 1 if the values differ from what was last sent to this
+	//	location (and remembers them), 0 if sending them would change nothing
+	// 'tag' distinguishes different uploads to the same location (e.g. type)
+	int egpfwStateUniformChanged(const int location, const unsigned int tag, const void *values, const unsigned int size);
+
+	// forget an object that is being deleted, since GL may reuse its name
+	// works for programs, framebuffers, VAOs, textures and uniform buffers
+	void egpfwStateForget(const egpStateKind kind, const unsigned int glhandle);
+
+	// forget everything, e.g. after GL was used directly or shaders reloaded
+	void egpfwStateInvalidate();
+
+	// copy this frame's counters and start the next frame
+	// 'stats_out' param may be null to just reset
+	void egpfwStateEndFrame(egpStateCacheStats *stats_out);
+
+	// release uniform storage
+	void egpfwStateRelease();
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// __EGPFW_STATECACHE_H
@@ -0,0 +1,102 @@
+/*
+	EGP Graphics Framework
+	(c) 2017 Dan Buckstein
+	Texture table: pass inputs looked up by index
+
+	Modified by: ______________________________________________________________
+*/
+
+#ifndef __EGPFW_TEXTURETABLE_H
+#define __EGPFW_TEXTURETABLE_H
+
+
+#include "egpfw/egpfw/egpfwShaderProgram.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+// texture table
+// a fixed set of slots, each holding a 2D texture; shaders read from it
+//	with an index instead of having each input bound before every pass
+// GLSL side (see blur and deferred shading shaders):
+//	bindless:	layout (std140) uniform TextureTable { sampler2D textureTable[N]; };
+//	units:		uniform sampler2D textureTable[N];
+// in bindless mode the table is a uniform buffer of resident texture handles
+//	that only changes when a slot does; otherwise every slot is bound to its
+//	own texture unit, starting at 'firstUnit', once per frame
+// with units, every slot counts against the fragment stage's sampler limit
+//	(GL_MAX_TEXTURE_IMAGE_UNITS, only 16 guaranteed on GL 4.1), so a shader
+//	reading the table may declare at most 'freeUnits' samplers of its own
+
+#define EGP_TEXTURE_TABLE_SIZE	12
+
+	enum egpTextureTableMode
+	{
+		TEXTURE_TABLE_UNITS,
+		TEXTURE_TABLE_BINDLESS,
+	};
+
+#ifndef __cplusplus
+	typedef enum egpTextureTableMode				egpTextureTableMode;
+	typedef struct egpTextureTableDescriptor		egpTextureTableDescriptor;
+#endif	// __cplusplus
+
+	struct egpTextureTableDescriptor
+	{
+		egpTextureTableMode mode;
+		unsigned int firstUnit;
+		unsigned int texture[EGP_TEXTURE_TABLE_SIZE];
+		unsigned long long handle[EGP_TEXTURE_TABLE_SIZE];
+		unsigned int uboHandle;
+		unsigned int freeUnits;
+		int dirty;
+	};
+
+	// check for ARB_bindless_texture
+	// returns 1 if the context has it, 0 if not
+	int egpfwTextureTableSupportsBindless();
+
+	// create an empty table
+	// bindless mode falls back to units if the context can't do it
+	// in units mode, checks the context's unit limits and prints a warning
+	//	if the table doesn't fit them; 'freeUnits' is left with how many
+	//	samplers a shader has besides the table (unlimited if bindless)
+	egpTextureTableDescriptor egpfwCreateTextureTable(const egpTextureTableMode mode, const unsigned int firstUnit);
+
+	// put a texture in a slot (0 empties it)
+	// in bindless mode the texture's handle is made resident, so its
+	//	image and parameters must be final by now
+	void egpfwTextureTableSet(egpTextureTableDescriptor *table, const unsigned int slot, const unsigned int texture);
+
+	// empty every slot
+	// call before deleting textures the table holds
+	void egpfwTextureTableClear(egpTextureTableDescriptor *table);
+
+	// make the table visible to shaders: upload changed handles and bind
+	//	the buffer to 'binding', or bind every slot to its unit
+	void egpfwActivateTextureTable(egpTextureTableDescriptor *table, const unsigned int binding);
+
+	// point a program's table at this one (block binding or sampler units)
+	// only needs to happen once per program
+	// returns 1 if the program reads the table, 0 if not
+	int egpfwConnectTextureTable(const egpTextureTableDescriptor *table, const egpProgram *program, const unsigned int binding);
+
+	// empty the table and delete its buffer
+	// returns 1 if success, 0 if failed
+	int egpfwReleaseTextureTable(egpTextureTableDescriptor *table);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// __EGPFW_TEXTURETABLE_H
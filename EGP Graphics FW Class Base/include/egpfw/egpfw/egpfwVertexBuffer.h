@@ -19,10 +19,38 @@ extern "C"
 #endif	// __cplusplus
 
 
+//-----------------------------------------------------------------------------
+// packed attribute types
+
+	// extra attribute types, continuing after the utils types
+	// attribute data is still given as floats (as many as the type name says) 
+	//	and converted while interleaving; vertex fetch expands them back to 
+	//	floats, so shaders take them as before
+	// C++ has to cast these to egpAttributeType
+	enum egpPackedAttributeType
+	{
+		ATTRIB_VEC2_HALF = ATTRIB_VEC4 + 1,	// 2D float vector as half floats (4 bytes)
+		ATTRIB_VEC3_HALF,					// 3D float vector as half floats, padded (8 bytes)
+		ATTRIB_VEC4_HALF,					// 4D float vector as half floats (8 bytes)
+		ATTRIB_VEC2_UNORM16,				// 2D float vector in [0, 1] as normalized 16-bit (4 bytes)
+		ATTRIB_VEC3_SNORM10,				// 3D float vector in [-1, 1] as 10:10:10 normalized (4 bytes)
+	};
+
+	// number of attribute types including packed ones
+#define EGPFW_ATTRIB_TYPE_COUNT (ATTRIB_VEC3_SNORM10 + 1)
+
+#ifndef __cplusplus
+	typedef enum egpPackedAttributeType	egpPackedAttributeType;
+#endif	// __cplusplus
+
+
 //-----------------------------------------------------------------------------
 // newly-defined functions
 // see utils version for descriptions of functions
 // return and argument types are borrowed from the utils version
+// interleaved VBOs always store attributes in name order, whatever order 
+//	they are passed in, so a VAO can be built from the VBO's types alone
+// drawing and releasing VAOs made here must go through these functions too
 
 	egpAttributeDescriptor egpfwCreateAttributeDescriptor(const egpAttributeName name, const egpAttributeType type, const void *data);
 	egpVertexBufferObjectDescriptor egpfwCreateVBOInterleaved(const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int numVertices);
@@ -40,6 +68,202 @@ extern "C"
 	int egpfwReleaseVAO(egpVertexArrayObjectDescriptor *vao);
 
 
+//-----------------------------------------------------------------------------
+// dynamic vertex buffers
+// for vertex data that changes every frame
+// one buffer is split into EGPFW_DYNAMIC_REGIONS regions used round-robin, 
+//	one per frame; the buffer stays mapped (ARB_buffer_storage, persistent 
+//	and coherent) so writing vertices is just writing memory, and each 
+//	region is fenced at the end of its frame and only reused once the GPU is 
+//	done with it, so nothing ever waits on a buffer update
+// without buffer storage (e.g. GL 4.1) vertices are staged in system memory 
+//	and sent with glBufferSubData right before they are drawn
+
+// regions in the ring: the CPU fills one while the GPU may still be 
+//	reading the previous two
+#define EGPFW_DYNAMIC_REGIONS 3
+
+#ifndef __cplusplus
+	typedef struct egpDynamicVertexBufferDescriptor egpDynamicVertexBufferDescriptor;
+#endif	// __cplusplus
+
+	// dynamic VBO descriptor
+	// 'vao' and 'vbo' are ordinary descriptors, so the VAO can be activated 
+	//	and drawn like any other (region offsets are baked into 'first')
+	// 'fence' holds one GL sync object per region, null if not pending
+	struct egpDynamicVertexBufferDescriptor
+	{
+		egpVertexArrayObjectDescriptor vao;
+		egpVertexBufferObjectDescriptor vbo;
+		void *mapped;
+		void *fence[EGPFW_DYNAMIC_REGIONS];
+		unsigned int regionVertices, region, used;
+		int persistent;
+	};
+
+	// create dynamic VBO with its own VAO
+	// attributes are interleaved in name order like any other VBO (packed 
+	//	types are written packed); their data pointers are ignored since 
+	//	nothing is uploaded yet
+	// 'maxVertices' is the most vertices that will be written in one frame
+	// returns 1 if successful, 0 if failed
+	// 'dvbo_out' param cannot be null
+	// 'num...' params cannot be zero
+	int egpfwCreateDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo_out, const egpPrimitiveType primType, const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int maxVertices);
+
+	// reserve space for vertices in this frame's region
+	// returns pointer to write 'numVertices' interleaved vertices to and sets 
+	//	'first_out' to the vertex index to draw them from, or returns null if 
+	//	the region does not have room left
+	// the first reservation of a frame waits for the GPU to release the 
+	//	region; with three regions it practically never has to
+	void *egpfwMapDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo, const unsigned int numVertices, unsigned int *first_out);
+
+	// draw reserved vertices (activates the dynamic VAO)
+	// 'first' and 'count' as returned/passed to the map function
+	void egpfwDrawDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo, const unsigned int first, const unsigned int count);
+
+	// end of frame: fence this frame's region and move on to the next one
+	// call once per frame after the last draw that uses its vertices
+	void egpfwAdvanceDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo);
+
+	// delete dynamic VBO and VAO
+	// returns 1 if successful, 0 if failed
+	int egpfwReleaseDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo);
+
+
+//-----------------------------------------------------------------------------
+// mesh pool and indirect drawing
+// many static meshes packed into a few shared pages, each page one VBO, 
+//	one IBO and one VAO, all in the same vertex format; a mesh is a range 
+//	of a page, so everything in a page can be drawn without switching 
+//	buffers, and with multi-draw-indirect (GL 4.3) in a single call
+// each draw also gets a draw index, read by vertex shaders from attribute 
+//	EGPFW_DRAW_INDEX_ATTRIB as 'layout (location = 15) in int drawIndex;' 
+//	and used to look up per-object data (e.g. an array in a uniform block)
+// with multi-draw the index is the command's base instance, fetched from 
+//	a per-instance attribute; without it (e.g. GL 4.1) the commands are 
+//	drawn one by one from system memory with the index set as the 
+//	attribute's constant value, so the same shaders work either way
+
+// pages in a pool; allocation fails once all are full
+#define EGPFW_MESH_POOL_PAGES 8
+
+// attribute location of the draw index; must not be used by the pool format
+#define EGPFW_DRAW_INDEX_ATTRIB 15
+
+// highest draw index plus one
+#define EGPFW_DRAW_INDEX_COUNT 4096
+
+#ifndef __cplusplus
+	typedef struct egpMeshPoolPage					egpMeshPoolPage;
+	typedef struct egpMeshPoolDescriptor			egpMeshPoolDescriptor;
+	typedef struct egpMeshPoolMesh					egpMeshPoolMesh;
+	typedef struct egpDrawIndirectCommand			egpDrawIndirectCommand;
+	typedef struct egpIndirectBufferDescriptor		egpIndirectBufferDescriptor;
+#endif	// __cplusplus
+
+	// one page: ordinary descriptors, so the VAO can also be drawn directly
+	// indices are always 32-bit, relative to the mesh's base vertex
+	struct egpMeshPoolPage
+	{
+		egpVertexArrayObjectDescriptor vao;
+		egpVertexBufferObjectDescriptor vbo;
+		egpIndexBufferObjectDescriptor ibo;
+		unsigned int usedVertices, usedIndices;
+	};
+
+	// mesh pool descriptor
+	// 'multiDraw' is set if the context has multi-draw-indirect
+	struct egpMeshPoolDescriptor
+	{
+		egpMeshPoolPage page[EGPFW_MESH_POOL_PAGES];
+		egpAttributeType attribTypes[16];
+		egpPrimitiveType primType;
+		unsigned int numPages, pageVertices, pageIndices;
+		unsigned int drawIndexHandle;
+		int multiDraw;
+	};
+
+	// where a mesh went in its pool
+	struct egpMeshPoolMesh
+	{
+		unsigned int page, baseVertex, firstIndex, indexCount;
+	};
+
+	// GL's indexed indirect command, in GL's layout
+	struct egpDrawIndirectCommand
+	{
+		unsigned int count, instanceCount, firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	// draw commands in system memory and, with multi-draw, in a 
+	//	GL_DRAW_INDIRECT_BUFFER
+	// with multi-draw the GL buffer may also be filled on the GPU (e.g. 
+	//	bound as a shader storage buffer for a culling compute shader) and 
+	//	drawn without uploading; the fallback only draws what was uploaded
+	struct egpIndirectBufferDescriptor
+	{
+		egpDrawIndirectCommand *commands;
+		unsigned int glhandle, capacity, count;
+	};
+
+	// check for multi-draw-indirect (GL 4.3 or ARB_multi_draw_indirect)
+	// returns 1 if the context has it, 0 if not
+	int egpfwMultiDrawIndirectSupported();
+
+	// create empty mesh pool; pages are made when first needed
+	// attribute types set the vertex format like any other interleaved VBO; 
+	//	their data pointers are ignored
+	// every mesh is drawn as 'primType', so strips and fans must be added 
+	//	as lists
+	// returns 1 if successful, 0 if failed
+	// 'pool_out' param cannot be null
+	// 'num...' and 'page...' params cannot be zero
+	int egpfwCreateMeshPool(egpMeshPoolDescriptor *pool_out, const egpPrimitiveType primType, const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int pageVertices, const unsigned int pageIndices);
+
+	// copy a mesh into the first page with room for it
+	// attributes are matched to the pool's by name; data is converted to the 
+	//	pool's type if both take the same number of source values (e.g. 
+	//	vec3 to 10:10:10), attributes the mesh lacks are zeros and 
+	//	attributes the pool lacks are skipped
+	// without indices ('indexType' INDEX_DISABLE) the vertices are indexed 
+	//	in order
+	// meshes stay until the pool is released
+	// returns 1 and fills 'mesh_out' if successful, 0 if failed
+	int egpfwMeshPoolAdd(egpMeshPoolDescriptor *pool, const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int numVertices, const egpIndexType indexType, const unsigned int numIndices, const void *indexData, egpMeshPoolMesh *mesh_out);
+
+	// command drawing one instance of a mesh with a draw index
+	egpDrawIndirectCommand egpfwMeshPoolCommand(const egpMeshPoolMesh *mesh, const unsigned int drawIndex);
+
+	// create indirect buffer with room for 'capacity' commands
+	// returns 1 if successful, 0 if failed
+	int egpfwCreateIndirectBuffer(egpIndirectBufferDescriptor *buf_out, const unsigned int capacity);
+
+	// replace the buffer's commands, growing it if needed
+	// returns 1 if successful, 0 if failed
+	int egpfwUploadIndirectBuffer(egpIndirectBufferDescriptor *buf, const egpDrawIndirectCommand *commands, const unsigned int count);
+
+	// draw 'count' commands starting at 'first', all from one page 
+	//	(activates the page's VAO)
+	void egpfwDrawMeshPoolIndirect(const egpMeshPoolDescriptor *pool, const unsigned int page, const egpIndirectBufferDescriptor *buf, const unsigned int first, const unsigned int count);
+
+	// set the draw index for ordinary draws with programs that read one
+	// only applies to VAOs without a draw index attribute, i.e. anything 
+	//	that is not a multi-draw pool page
+	void egpfwSetDrawIndex(const unsigned int drawIndex);
+
+	// delete indirect buffer
+	// returns 1 if successful, 0 if failed
+	int egpfwReleaseIndirectBuffer(egpIndirectBufferDescriptor *buf);
+
+	// delete every page of a pool
+	// returns 1 if successful, 0 if failed
+	int egpfwReleaseMeshPool(egpMeshPoolDescriptor *pool);
+
+
 //-----------------------------------------------------------------------------
 
 
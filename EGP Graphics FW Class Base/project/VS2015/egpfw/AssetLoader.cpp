@@ -0,0 +1,248 @@
+#include "AssetLoader.h"
+#include <stdio.h>
+#include <GL/glew.h>
+#include "IL/il.h"
+
+// DevIL keeps its bound image and settings in globals, so only one thread may decode at a time
+static std::mutex ilMutex;
+
+AssetLoader::AssetLoader(unsigned int numWorkers, size_t uploadCapacity, size_t frameBudget)
+{
+	mNumWorkers = numWorkers ? numWorkers : 1;
+	mUploadCapacity = uploadCapacity;
+	mFrameBudget = frameBudget;
+	mQueuedBytes = 0;
+	mPending = 0;
+	mStopping = false;
+}
+
+AssetLoader::~AssetLoader()
+{
+	shutdown();
+}
+
+void AssetLoader::start()
+{
+	if (!mWorkers.empty())
+		return;
+
+	mStopping = false;
+	for (unsigned int i = 0; i < mNumWorkers; ++i)
+		mWorkers.push_back(std::thread(&AssetLoader::workerLoop, this));
+}
+
+void AssetLoader::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mRequestReady.notify_all();
+	mUploadSpace.notify_all();
+
+	for (auto& worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+
+	//Workers finish what they were loading before they exit, so everything left is in one of the two queues.
+	for (auto& request : mRequests)
+		cancel(request);
+	for (auto& pending : mUploads)
+	{
+		cancel(pending.request);
+		egpfwReleaseOBJ(&pending.obj);
+	}
+	mRequests.clear();
+	mUploads.clear();
+	mQueuedBytes = 0;
+	mPending = 0;
+}
+
+void AssetLoader::requestOBJ(const char* objPath, const char* cachePath, egpMeshNormalMode normalMode, unsigned int optimizeFlags, bool packAttribs,
+	egpVertexArrayObjectDescriptor* vao, egpVertexBufferObjectDescriptor* vbo, egpIndexBufferObjectDescriptor* ibo,
+	const egpVertexArrayObjectDescriptor* placeholder)
+{
+	AssetRequest request;
+	request.type = ASSET_OBJ;
+	request.path = objPath;
+	request.cachePath = cachePath ? cachePath : "";
+	request.normalMode = normalMode;
+	request.optimizeFlags = optimizeFlags;
+	request.packAttribs = packAttribs;
+	request.vao = vao;
+	request.vbo = vbo;
+	request.ibo = ibo;
+	request.texture = 0;
+
+	//Anything drawing this slot sees the placeholder until the upload replaces it.
+	if (placeholder)
+		*vao = *placeholder;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRequests.push_back(request);
+		++mPending;
+	}
+	mRequestReady.notify_one();
+}
+
+void AssetLoader::requestTexture(const char* imagePath, unsigned int texture)
+{
+	AssetRequest request = { };
+	request.type = ASSET_TEXTURE;
+	request.path = imagePath;
+	request.texture = texture;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRequests.push_back(request);
+		++mPending;
+	}
+	mRequestReady.notify_one();
+}
+
+size_t AssetLoader::processUploads()
+{
+	size_t uploaded = 0;
+
+	while (uploaded < mFrameBudget)
+	{
+		AssetUpload next;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mUploads.empty())
+				break;
+			next = std::move(mUploads.front());
+			mUploads.pop_front();
+			mQueuedBytes -= next.size;
+		}
+		mUploadSpace.notify_all();
+
+		upload(next);
+		uploaded += next.size;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		--mPending;
+	}
+
+	return uploaded;
+}
+
+bool AssetLoader::isIdle()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPending == 0;
+}
+
+void AssetLoader::workerLoop()
+{
+	for (;;)
+	{
+		AssetUpload loaded;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mRequestReady.wait(lock, [this] { return mStopping || !mRequests.empty(); });
+			if (mStopping)
+				return;
+			loaded.request = mRequests.front();
+			mRequests.pop_front();
+		}
+
+		loaded.obj = egpTriOBJDescriptor();
+		loaded.width = loaded.height = 0;
+		loaded.size = 0;
+		if (loaded.request.type == ASSET_OBJ)
+			loadOBJ(loaded);
+		else
+			loadImage(loaded);
+
+		//Wait for room in the upload queue. An empty queue always takes one item, however big,
+		//so an asset larger than the whole queue can't block forever.
+		std::unique_lock<std::mutex> lock(mMutex);
+		mUploadSpace.wait(lock, [this, &loaded] {
+			return mStopping || mUploads.empty() || mQueuedBytes + loaded.size <= mUploadCapacity;
+		});
+		mQueuedBytes += loaded.size;
+		mUploads.push_back(std::move(loaded));
+	}
+}
+
+void AssetLoader::loadOBJ(AssetUpload& upload) const
+{
+	const AssetRequest& request = upload.request;
+
+	if (!request.cachePath.empty())
+		upload.obj = egpfwLoadBinaryOBJ(request.cachePath.c_str());
+	if (!upload.obj.data)
+	{
+		upload.obj = egpfwLoadTriangleOBJ(request.path.c_str(), request.normalMode, request.optimizeFlags, 1.0);
+		if (upload.obj.data && !request.cachePath.empty())
+			egpfwSaveBinaryOBJ(&upload.obj, request.cachePath.c_str());
+	}
+	upload.size = upload.obj.dataSize;
+}
+
+void AssetLoader::loadImage(AssetUpload& upload) const
+{
+	//Read the file outside the DevIL lock so several workers can be waiting on disk at once.
+	std::vector<unsigned char> file;
+	FILE* fp = fopen(upload.request.path.c_str(), "rb");
+	if (!fp)
+	{
+		printf("Unable to open image %s.\n", upload.request.path.c_str());
+		return;
+	}
+	fseek(fp, 0, SEEK_END);
+	const long fileSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (fileSize > 0)
+	{
+		file.resize((size_t)fileSize);
+		file.resize(fread(file.data(), 1, file.size(), fp));
+	}
+	fclose(fp);
+
+	std::lock_guard<std::mutex> lock(ilMutex);
+	unsigned int ilHandle = 0;
+	ilGenImages(1, &ilHandle);
+	ilBindImage(ilHandle);
+	if (!file.empty() && ilLoadL(IL_TYPE_UNKNOWN, file.data(), (ILuint)file.size()) && ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE))
+	{
+		upload.width = ilGetInteger(IL_IMAGE_WIDTH);
+		upload.height = ilGetInteger(IL_IMAGE_HEIGHT);
+		const unsigned char* data = ilGetData();
+		upload.pixels.assign(data, data + (size_t)upload.width * upload.height * 4);
+		upload.size = upload.pixels.size();
+	}
+	else
+		printf("Unable to decode image %s.\n", upload.request.path.c_str());
+	ilDeleteImages(1, &ilHandle);
+}
+
+void AssetLoader::upload(AssetUpload& upload) const
+{
+	const AssetRequest& request = upload.request;
+
+	if (request.type == ASSET_OBJ)
+	{
+		//Either way the placeholder goes; a failed load ends up empty, same as loading it up front would.
+		*request.vao = egpVertexArrayObjectDescriptor();
+		if (upload.obj.data)
+		{
+			egpfwCreateVAOFromOBJ(&upload.obj, request.vao, request.vbo, request.ibo, request.packAttribs);
+			egpfwReleaseOBJ(&upload.obj);
+		}
+	}
+	else if (!upload.pixels.empty())
+	{
+		egpfwStateSelectTexture(0, GL_TEXTURE_2D, request.texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, upload.width, upload.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, upload.pixels.data());
+	}
+}
+
+void AssetLoader::cancel(AssetRequest& request) const
+{
+	//Placeholder VAOs belong to someone else; forget them so they aren't released twice.
+	if (request.type == ASSET_OBJ)
+		*request.vao = egpVertexArrayObjectDescriptor();
+}
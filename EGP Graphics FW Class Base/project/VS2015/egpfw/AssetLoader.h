@@ -0,0 +1,97 @@
+#pragma once
+#include "egpfw/egpfw.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * \brief Loads OBJs and images on worker threads and hands them to the GL thread through a bounded upload queue.
+ * Workers only touch files and memory; every GL call happens in processUploads(), which must run on the GL thread. */
+class AssetLoader
+{
+	private:
+		enum AssetType
+		{
+			ASSET_OBJ,
+			ASSET_TEXTURE,
+		};
+
+		struct AssetRequest
+		{
+			AssetType type;
+			std::string path, cachePath;
+
+			egpMeshNormalMode normalMode;
+			unsigned int optimizeFlags;
+			bool packAttribs;
+			egpVertexArrayObjectDescriptor* vao;
+			egpVertexBufferObjectDescriptor* vbo;
+			egpIndexBufferObjectDescriptor* ibo;
+
+			unsigned int texture;
+		};
+
+		struct AssetUpload
+		{
+			AssetRequest request;
+			egpTriOBJDescriptor obj;
+			std::vector<unsigned char> pixels;
+			unsigned int width, height;
+			size_t size;
+		};
+
+		unsigned int mNumWorkers;
+		std::vector<std::thread> mWorkers;
+
+		std::deque<AssetRequest> mRequests;
+		std::deque<AssetUpload> mUploads;
+		std::mutex mMutex;
+		std::condition_variable mRequestReady, mUploadSpace;
+
+		size_t mUploadCapacity, mFrameBudget, mQueuedBytes;
+		unsigned int mPending;
+		bool mStopping;
+
+		void workerLoop();
+		void loadOBJ(AssetUpload& upload) const;
+		void loadImage(AssetUpload& upload) const;
+		void upload(AssetUpload& upload) const;
+		void cancel(AssetRequest& request) const;
+
+	public:
+		/**
+		 * \brief Create an AssetLoader. No threads run until start() is called.
+		 * \param numWorkers Number of worker threads doing file I/O and decoding.
+		 * \param uploadCapacity Most bytes of decoded data allowed to wait for upload; workers stall while it is full.
+		 * \param frameBudget Bytes processUploads() sends to GL per call. At least one asset is always sent, however big. */
+		AssetLoader(unsigned int numWorkers, size_t uploadCapacity, size_t frameBudget);
+		~AssetLoader();
+
+		void start();
+		/**
+		 * \brief Stop the workers and drop anything not uploaded yet, putting placeholder VAOs back to empty.
+		 * Call on the GL thread before releasing the geometry and textures this loader fills in. */
+		void shutdown();
+
+		/**
+		 * \brief Queue an OBJ. The binary cache is tried first and written if the OBJ has to be parsed.
+		 * \param packAttribs Upload with packed vertex formats (see egpfwCreateVAOFromOBJ).
+		 * \param placeholder VAO copied into vao until the real one is uploaded; it is never released by this class. */
+		void requestOBJ(const char* objPath, const char* cachePath, egpMeshNormalMode normalMode, unsigned int optimizeFlags, bool packAttribs,
+			egpVertexArrayObjectDescriptor* vao, egpVertexBufferObjectDescriptor* vbo, egpIndexBufferObjectDescriptor* ibo,
+			const egpVertexArrayObjectDescriptor* placeholder);
+		/**
+		 * \brief Queue an image for an existing texture name. The texture keeps whatever it holds now (and its
+		 * parameters) until the image is uploaded with glTexImage2D. */
+		void requestTexture(const char* imagePath, unsigned int texture);
+
+		/**
+		 * \brief Upload finished assets until this frame's byte budget is used up. GL thread only.
+		 * \return Bytes uploaded. */
+		size_t processUploads();
+		bool isIdle();
+};
@@ -0,0 +1,134 @@
+#include "BlurChain.h"
+
+//Pascal's triangle row of each quality; HIGH is the 11-tap kernel the blur always had.
+static const unsigned int qualityRow[blurQualityCount] = { 4, 8, 10, 16 };
+
+BlurChain::BlurChain(egpFrameBufferObjectDescriptor* fbos, egpProgram* programs, int (*uniformSets)[GLSLCommonUniformCount], egpVertexArrayObjectDescriptor* quad)
+{
+	mFBOArray = fbos;
+	mProgramArray = programs;
+	mUniformSets = uniformSets;
+	mQuad = quad;
+
+	mSeparableProgram = mDownProgram = mUpProgram = GLSLProgramCount;
+
+	for (unsigned int q = 0; q < blurQualityCount; ++q)
+		foldBinomial(qualityRow[q], mKernels[q]);
+	mZero = 0.0f;
+	setQuality(BLUR_QUALITY_HIGH);
+}
+
+void BlurChain::foldBinomial(unsigned int row, Kernel& kernel)
+{
+	//Half a row, center first: weight[i] goes at offsets +i and -i.
+	double weight[17];
+	const unsigned int half = row / 2;
+	double c = 1.0, total = 0.0;
+	for (unsigned int k = 0; k <= row; ++k)
+	{
+		if (k >= half)
+			weight[k - half] = c;
+		total += c;
+		c = c * (double)(row - k) / (double)(k + 1);
+	}
+
+	//A fetch between texels i and i + 1, at the point dividing them by weight, returns their weighted average, so one
+	//fetch weighted by their sum replaces both. A last texel without a partner is fetched on its own.
+	kernel.taps[0][0] = 0.0f;
+	kernel.taps[0][1] = (float)(weight[0] / total);
+	kernel.count = 1;
+	for (unsigned int i = 1; i <= half && kernel.count < (int)maxTaps; i += 2)
+	{
+		const double w0 = weight[i], w1 = i < half ? weight[i + 1] : 0.0;
+		kernel.taps[kernel.count][0] = (float)(((double)i * w0 + (double)(i + 1) * w1) / (w0 + w1));
+		kernel.taps[kernel.count][1] = (float)((w0 + w1) / total);
+		++kernel.count;
+	}
+
+	for (int t = kernel.count; t < (int)maxTaps; ++t)
+		kernel.taps[t][0] = kernel.taps[t][1] = 0.0f;
+}
+
+void BlurChain::setPrograms(GLSLProgramIndex separable, GLSLProgramIndex down, GLSLProgramIndex up)
+{
+	mSeparableProgram = separable;
+	mDownProgram = down;
+	mUpProgram = up;
+}
+
+void BlurChain::setQuality(BlurQuality quality)
+{
+	mQuality = quality < blurQualityCount ? quality : BLUR_QUALITY_HIGH;
+	mKernel = mKernels[mQuality];
+}
+
+const char* BlurChain::getQualityName(BlurQuality quality)
+{
+	static const char* names[blurQualityCount] = { "low", "medium", "high", "ultra" };
+	return quality < blurQualityCount ? names[quality] : "?";
+}
+
+const char* BlurChain::name(const char* chain, const char* pass, unsigned int level)
+{
+	mNames.push_back(std::string(chain) + " " + pass + " " + std::to_string(level));
+	return mNames.back().c_str();
+}
+
+void BlurChain::addPasses(FrameGraph& graph, BlurMode mode, const BlurTarget& source, const BlurTarget (*levels)[2], unsigned int numLevels, const char* chain)
+{
+	const BlurTarget* input = &source;
+
+	for (unsigned int l = 0; l < numLevels; ++l)
+	{
+		RenderPass first(mFBOArray, mProgramArray), second(mFBOArray, mProgramArray);
+		const BlurTarget& firstTarget = levels[l][0];
+		const BlurTarget& secondTarget = levels[l][1];
+
+		first.setVAO(mQuad);
+		first.setPipelineStage(firstTarget.fbo);
+		first.addTableRead(input->fbo);
+
+		second.setVAO(mQuad);
+		second.setPipelineStage(secondTarget.fbo);
+		second.addTableRead(firstTarget.fbo);
+
+		if (mode == BLUR_SEPARABLE)
+		{
+			//Both passes step one texel of what they read along their axis; the other component stays zero.
+			int* uniforms = mUniformSets[mSeparableProgram];
+			first.setProgram(mSeparableProgram);
+			first.addUniform(render_pass_uniform_int(uniforms[unif_tableIndex], UNIF_IVEC4, 1, input->tableIndex));
+			first.addUniform(render_pass_uniform_float_complex(uniforms[unif_pixelSizeInv], UNIF_VEC2, 1, { &input->pixelSize->x, &mZero }));
+			first.addUniform(render_pass_uniform_float(uniforms[unif_blurKernel], UNIF_VEC2, maxTaps, &mKernel.taps[0][0]));
+			first.addUniform(render_pass_uniform_int(uniforms[unif_blurTapCount], UNIF_INT, 1, &mKernel.count));
+
+			second.setProgram(mSeparableProgram);
+			second.addUniform(render_pass_uniform_int(uniforms[unif_tableIndex], UNIF_IVEC4, 1, firstTarget.tableIndex));
+			second.addUniform(render_pass_uniform_float_complex(uniforms[unif_pixelSizeInv], UNIF_VEC2, 1, { &mZero, &firstTarget.pixelSize->y }));
+			second.addUniform(render_pass_uniform_float(uniforms[unif_blurKernel], UNIF_VEC2, maxTaps, &mKernel.taps[0][0]));
+			second.addUniform(render_pass_uniform_int(uniforms[unif_blurTapCount], UNIF_INT, 1, &mKernel.count));
+
+			first.setName(name(chain, "hblur", l + 1));
+			second.setName(name(chain, "vblur", l + 1));
+		}
+		else
+		{
+			//Both filters place their taps by the texel size of what they read.
+			int* downUniforms = mUniformSets[mDownProgram];
+			int* upUniforms = mUniformSets[mUpProgram];
+			first.setProgram(mDownProgram);
+			first.addUniform(render_pass_uniform_int(downUniforms[unif_tableIndex], UNIF_IVEC4, 1, input->tableIndex));
+			first.addUniform(render_pass_uniform_float(downUniforms[unif_pixelSizeInv], UNIF_VEC2, 1, &input->pixelSize->x));
+
+			second.setProgram(mUpProgram);
+			second.addUniform(render_pass_uniform_int(upUniforms[unif_tableIndex], UNIF_IVEC4, 1, firstTarget.tableIndex));
+			second.addUniform(render_pass_uniform_float(upUniforms[unif_pixelSizeInv], UNIF_VEC2, 1, &firstTarget.pixelSize->x));
+
+			first.setName(name(chain, "down", l + 1));
+			second.setName(name(chain, "up", l + 1));
+		}
+
+		graph.addPasses(std::move(first), std::move(second));
+		input = &secondTarget;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <deque>
+#include <string>
+#include "render_enums.h"
+#include "FrameGraph.h"
+
+/**
+ * \brief Kernel sizes of the separable blur, smallest first. Each is a row of Pascal's triangle (4, 8, 10 and 16). */
+enum BlurQuality
+{
+	BLUR_QUALITY_LOW,
+	BLUR_QUALITY_MEDIUM,
+	BLUR_QUALITY_HIGH,
+	BLUR_QUALITY_ULTRA,
+
+	blurQualityCount
+};
+
+/**
+ * \brief How each level of a chain is blurred.
+ * Separable: a horizontal then a vertical Gaussian pass, kernel from the quality table.
+ * Dual filter: a 5-tap downsample from the level above, then the 8-tap upsample tent at the level's own size; wider
+ * for its cost than the Gaussian, but the quality table doesn't apply. */
+enum BlurMode
+{
+	BLUR_SEPARABLE,
+	BLUR_DUAL_FILTER,
+};
+
+/**
+ * \brief A render target a chain reads or writes, with what its shaders need to read it. */
+struct BlurTarget
+{
+	FBOIndex fbo;
+	int* tableIndex;
+	cbmath::vec2* pixelSize;
+
+	/**
+	 * \param f FBO slot of the target.
+	 * \param t ivec4 with the target's texture table slot in x.
+	 * \param p Size of one of its texels in texture space; read when the passes run, so it may change with the frame. */
+	BlurTarget(FBOIndex f, int* t, cbmath::vec2* p) : fbo(f), tableIndex(t), pixelSize(p) {}
+};
+
+/**
+ * \brief Builds the passes that blur an image into a chain of levels, for any path that needs one (bloom and depth of
+ * field both do).
+ * Every level takes two passes into two targets, reading the finished level before it, so the blur a level already has
+ * is kept instead of being redone: the first level reads the source, the second the first level's output, and so on.
+ * The separable kernel folds each pair of neighbouring taps into one bilinear fetch between them, weighted so the
+ * filtering hardware does the blend, which about halves the fetches (the 11-tap kernel takes 7). The kernel is read by
+ * address when the passes run, so the quality can change without building the paths again. */
+class BlurChain
+{
+	public:
+		/**
+		 * \brief Most folded taps in a kernel, the center included; matches BLUR_MAX_TAPS in the shader. */
+		static const unsigned int maxTaps = 5;
+
+	private:
+		//Offset in texels and weight of each tap; [0] is the center. Taps past the center are fetched on both sides.
+		struct Kernel
+		{
+			float taps[maxTaps][2];
+			int count;
+		};
+
+		egpFrameBufferObjectDescriptor* mFBOArray;
+		egpProgram* mProgramArray;
+		int (*mUniformSets)[GLSLCommonUniformCount];
+		egpVertexArrayObjectDescriptor* mQuad;
+
+		GLSLProgramIndex mSeparableProgram, mDownProgram, mUpProgram;
+
+		Kernel mKernels[blurQualityCount];
+		//What the passes send: a copy of the chosen kernel.
+		Kernel mKernel;
+		BlurQuality mQuality;
+		float mZero;
+
+		//Pass names; a deque never moves what it holds.
+		std::deque<std::string> mNames;
+
+		static void foldBinomial(unsigned int row, Kernel& kernel);
+		const char* name(const char* chain, const char* pass, unsigned int level);
+
+	public:
+		/**
+		 * \param fbos Pointer to the global FBO array.
+		 * \param programs Pointer to the global GLSLProgram array.
+		 * \param uniformSets Pointer to the global uniform location table, indexed by program.
+		 * \param quad Full screen quad the passes draw. */
+		BlurChain(egpFrameBufferObjectDescriptor* fbos, egpProgram* programs, int (*uniformSets)[GLSLCommonUniformCount], egpVertexArrayObjectDescriptor* quad);
+
+		/**
+		 * \brief Programs of the separable pass and of the dual filter's down and up passes. */
+		void setPrograms(GLSLProgramIndex separable, GLSLProgramIndex down, GLSLProgramIndex up);
+
+		void setQuality(BlurQuality quality);
+		BlurQuality getQuality() const { return mQuality; }
+		/**
+		 * \brief Texture fetches per pixel of one separable pass at the current quality. */
+		unsigned int getFetchCount() const { return mKernel.count * 2 - 1; }
+		static const char* getQualityName(BlurQuality quality);
+
+		/**
+		 * \brief Add the passes of a chain to a frame graph.
+		 * \param levels Targets of each level, first then second pass; the second of each is the level's output.
+		 * \param chain Name the passes are labelled with. */
+		void addPasses(FrameGraph& graph, BlurMode mode, const BlurTarget& source, const BlurTarget (*levels)[2], unsigned int numLevels, const char* chain);
+};
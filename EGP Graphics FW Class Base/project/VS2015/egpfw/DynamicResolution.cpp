@@ -0,0 +1,123 @@
+#include "DynamicResolution.h"
+#include <GL/glew.h>
+#include <math.h>
+
+//Weight of the newest sample; the rest comes from previous frames.
+static const float smoothing = 0.1f;
+
+//Samples to take after a change before the next one, so the smoothed time reflects the new scale.
+static const unsigned int settleSamples = 16;
+
+//The scale only changes by whole steps, and not at all while the time is between headroom * target and the target.
+static const float scaleStep = 1.0f / 16.0f;
+static const float headroom = 0.85f;
+
+DynamicResolution::DynamicResolution()
+{
+	for (unsigned int s = 0; s < numQuerySets; ++s)
+	{
+		mQueries[s][0] = mQueries[s][1] = 0;
+		mIssued[s] = false;
+	}
+	mFrame = 0;
+
+	mTargetMs = 1000.0f / 60.0f;
+	mMinScale = 0.5f;
+	mMaxScale = 1.0f;
+	mGpuMs = 0.0f;
+	mScale = 1.0f;
+	mSamples = 0;
+	mEnabled = false;
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	//Queries belong to the context, which may be gone by now; release() is for a clean shutdown.
+}
+
+void DynamicResolution::setTarget(float targetMs, float minScale, float maxScale)
+{
+	mTargetMs = targetMs;
+	mMinScale = minScale;
+	mMaxScale = maxScale;
+	mScale = mScale < mMinScale ? mMinScale : mScale > mMaxScale ? mMaxScale : mScale;
+}
+
+void DynamicResolution::setEnabled(bool enabled)
+{
+	mEnabled = enabled;
+	if (!enabled)
+		mScale = mMaxScale;
+	mSamples = 0;
+}
+
+void DynamicResolution::beginFrame()
+{
+	if (!mQueries[0][0])
+		for (unsigned int s = 0; s < numQuerySets; ++s)
+			glGenQueries(2, mQueries[s]);
+
+	//A frame still waiting on the GPU is simply reissued; its old result is lost, not waited for.
+	const unsigned int set = mFrame % numQuerySets;
+	if (mIssued[set])
+	{
+		GLuint available;
+		glGetQueryObjectuiv(mQueries[set][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(mQueries[set][0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(mQueries[set][1], GL_QUERY_RESULT, &end);
+
+			//Frames already in flight when the scale changed were drawn at the old one, so the average only starts after them.
+			const float ms = (float)((end - begin) * 1.0e-6);
+			mGpuMs = mSamples > numQuerySets ? mGpuMs + (ms - mGpuMs) * smoothing : ms;
+			++mSamples;
+		}
+		mIssued[set] = false;
+	}
+
+	glQueryCounter(mQueries[set][0], GL_TIMESTAMP);
+}
+
+void DynamicResolution::endFrame()
+{
+	const unsigned int set = mFrame % numQuerySets;
+	glQueryCounter(mQueries[set][1], GL_TIMESTAMP);
+	mIssued[set] = true;
+	++mFrame;
+}
+
+bool DynamicResolution::update()
+{
+	if (!mEnabled || mSamples < settleSamples || mGpuMs <= 0.0f)
+		return false;
+
+	const bool over = mGpuMs > mTargetMs;
+	if (!over && mGpuMs >= mTargetMs * headroom)
+		return false;
+
+	//Aim for the middle of the band; rounding may land on the same step, but being outside the band is worth one.
+	float scale = mScale * sqrtf(mTargetMs * (0.5f + 0.5f * headroom) / mGpuMs);
+	scale = floorf(scale / scaleStep + 0.5f) * scaleStep;
+	if (scale == mScale)
+		scale += over ? -scaleStep : scaleStep;
+	scale = scale < mMinScale ? mMinScale : scale > mMaxScale ? mMaxScale : scale;
+
+	if (scale == mScale)
+		return false;
+	mScale = scale;
+	mSamples = 0;
+	return true;
+}
+
+void DynamicResolution::release()
+{
+	if (mQueries[0][0])
+		for (unsigned int s = 0; s < numQuerySets; ++s)
+		{
+			glDeleteQueries(2, mQueries[s]);
+			mQueries[s][0] = mQueries[s][1] = 0;
+			mIssued[s] = false;
+		}
+}
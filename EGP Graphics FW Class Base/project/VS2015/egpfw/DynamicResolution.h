@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * \brief Picks the scale to render the frame at so that GPU time stays near a target.
+ * The GPU time of each frame is measured with a pair of GL_TIMESTAMP queries, read back a few frames later and only if
+ * they are ready, so it never stalls (timestamps also don't clash with the PassTimer's elapsed-time queries). The cost of
+ * a frame mostly follows its pixel count, so the scale moves by the square root of how far the time is from the target.
+ * It only moves once the smoothed time has settled after the last change, and only by whole steps, so it doesn't hunt.
+ * GL thread only. */
+class DynamicResolution
+{
+	private:
+		static const unsigned int numQuerySets = 3;
+
+		unsigned int mQueries[numQuerySets][2];
+		bool mIssued[numQuerySets];
+		unsigned int mFrame;
+
+		float mTargetMs, mMinScale, mMaxScale;
+		float mGpuMs;
+		float mScale;
+		unsigned int mSamples;
+		bool mEnabled;
+
+	public:
+		DynamicResolution();
+		~DynamicResolution();
+
+		/**
+		 * \brief Frame time to hold and the range the scale stays in (fractions of the full size per axis). */
+		void setTarget(float targetMs, float minScale, float maxScale);
+		/**
+		 * \brief When disabled the scale goes back to the maximum; the frame is still timed. */
+		void setEnabled(bool enabled);
+		bool isEnabled() const { return mEnabled; }
+
+		/**
+		 * \brief Collect the oldest frame's time if it's ready and mark the start of this one.
+		 * Call it right before the frame's first draw, after the CPU has prepared the frame; otherwise the time includes
+		 * the GPU sitting idle while the CPU catches up, and a CPU-bound frame drops the scale for nothing. */
+		void beginFrame();
+		void endFrame();
+		/**
+		 * \brief Move the scale toward the target, if it's time to. Goes by the times collected so far, so it may come
+		 * before beginFrame().
+		 * \return Whether the scale changed. */
+		bool update();
+
+		float getScale() const { return mScale; }
+		float getGpuMs() const { return mGpuMs; }
+
+		/**
+		 * \brief Delete the queries. Needs the GL context, so it can't wait for the destructor. */
+		void release();
+};
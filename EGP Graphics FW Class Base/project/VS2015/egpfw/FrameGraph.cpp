@@ -0,0 +1,419 @@
+#include "FrameGraph.h"
+#include <stdio.h>
+#include <algorithm>
+#include <limits.h>
+
+//Maximum sizes are rounded up to this, a multiple of every size divisor in use, so each target divides it evenly.
+static const unsigned int maxFrameSizeStep = 64;
+
+static unsigned int roundUpFrameSize(unsigned int size)
+{
+	return (size + maxFrameSizeStep - 1) / maxFrameSizeStep * maxFrameSizeStep;
+}
+
+FrameGraphTargetDesc::FrameGraphTargetDesc(unsigned int d, unsigned int n, egpColorFormat c, egpDepthFormat z, egpWrapSmoothFormat w)
+	: sizeDivisor(d), numColorTargets(c != COLOR_DISABLE && n <= maxColorTargets ? n : 0), colorFormat(), depthFormat(z), wrapSmoothFormat(w)
+{
+	for (unsigned int i = 0; i < numColorTargets; ++i)
+		colorFormat[i] = c;
+}
+
+FrameGraphTargetDesc::FrameGraphTargetDesc(unsigned int d, std::initializer_list<egpColorFormat> c, egpDepthFormat z, egpWrapSmoothFormat w)
+	: sizeDivisor(d), numColorTargets(0), colorFormat(), depthFormat(z), wrapSmoothFormat(w)
+{
+	for (auto format : c)
+		if (numColorTargets < maxColorTargets)
+			colorFormat[numColorTargets++] = format;
+}
+
+bool FrameGraphTargetDesc::operator==(const FrameGraphTargetDesc& other) const
+{
+	if (sizeDivisor != other.sizeDivisor || numColorTargets != other.numColorTargets || depthFormat != other.depthFormat ||
+		wrapSmoothFormat != other.wrapSmoothFormat)
+		return false;
+	for (unsigned int i = 0; i < numColorTargets; ++i)
+		if (colorFormat[i] != other.colorFormat[i])
+			return false;
+	return true;
+}
+
+CompiledFrameGraph::CompiledFrameGraph()
+{
+	for (int i = 0; i < fboCount; ++i)
+		slotTarget[i] = -1;
+	numPasses = numLivePasses = 0;
+}
+
+FrameGraph::FrameGraph(egpFrameBufferObjectDescriptor* fbos)
+{
+	mFBOArray = fbos;
+	mFrameWidth = mFrameHeight = 0;
+	mMaxWidth = mMaxHeight = 0;
+	mPoolBudget = (size_t)-1;
+	mActivations = 0;
+	mActive = nullptr;
+
+	for (int i = 0; i < fboCount; ++i)
+		mImported[i] = mExported[i] = false;
+}
+
+FrameGraph::~FrameGraph()
+{
+}
+
+void FrameGraph::declareTarget(FBOIndex slot, const FrameGraphTargetDesc& desc)
+{
+	mDescs[slot] = desc;
+}
+
+unsigned int FrameGraph::getTargetWidth(FBOIndex slot) const
+{
+	const unsigned int d = mDescs[slot].sizeDivisor;
+	return d ? (mFrameWidth + d - 1) / d : 0;
+}
+
+unsigned int FrameGraph::getTargetHeight(FBOIndex slot) const
+{
+	const unsigned int d = mDescs[slot].sizeDivisor;
+	return d ? (mFrameHeight + d - 1) / d : 0;
+}
+
+unsigned int FrameGraph::getTargetTextureWidth(FBOIndex slot) const
+{
+	return mDescs[slot].sizeDivisor ? mMaxWidth / mDescs[slot].sizeDivisor : 0;
+}
+
+unsigned int FrameGraph::getTargetTextureHeight(FBOIndex slot) const
+{
+	return mDescs[slot].sizeDivisor ? mMaxHeight / mDescs[slot].sizeDivisor : 0;
+}
+
+void FrameGraph::setMaxFrameSize(unsigned int width, unsigned int height)
+{
+	width = roundUpFrameSize(width);
+	height = roundUpFrameSize(height);
+	if (width == mMaxWidth && height == mMaxHeight)
+		return;
+
+	release();
+	mMaxWidth = width;
+	mMaxHeight = height;
+}
+
+void FrameGraph::setFrameSize(unsigned int width, unsigned int height)
+{
+	mFrameWidth = width;
+	mFrameHeight = height;
+
+	//Growing past the maximum is the only case that has to reallocate; it keeps the larger size from then on.
+	if (!fitsFrameSize(width, height))
+		setMaxFrameSize(width > mMaxWidth ? width : mMaxWidth, height > mMaxHeight ? height : mMaxHeight);
+	else if (mActive)
+		fillSlots(*mActive);
+}
+
+RenderPassHandle FrameGraph::addPass(RenderPass&& pass)
+{
+	mPasses.push_back(std::move(pass));
+	return (RenderPassHandle)mPasses.size() - 1;
+}
+
+void FrameGraph::clearPasses()
+{
+	mPasses.clear();
+}
+
+void FrameGraph::importTarget(FBOIndex slot)
+{
+	mImported[slot] = true;
+}
+
+void FrameGraph::exportTarget(FBOIndex slot)
+{
+	mExported[slot] = true;
+}
+
+void FrameGraph::clearExports()
+{
+	for (int i = 0; i < fboCount; ++i)
+		mExported[i] = false;
+}
+
+void FrameGraph::compile(CompiledFrameGraph& compiled)
+{
+	const int numPasses = (int)mPasses.size();
+	std::vector<int> writes(numPasses);
+	std::vector<bool> live(numPasses);
+	bool needed[fboCount];
+	int firstUse[fboCount], lastUse[fboCount];
+	int i, slot;
+
+	//Passes without a pipeline stage keep drawing into whatever the pass before them used.
+	int stage = -1;
+	for (i = 0; i < numPasses; ++i)
+	{
+		if (mPasses[i].getPipelineStage() != fboCount)
+			stage = mPasses[i].getPipelineStage();
+		writes[i] = stage;
+	}
+
+	//Cull: walk backwards from the exports, keeping a pass only if something later needs what it writes.
+	//Passes that don't write to any FBO can't be reasoned about, so they are always kept.
+	for (slot = 0; slot < fboCount; ++slot)
+		needed[slot] = mExported[slot];
+	for (i = numPasses - 1; i >= 0; --i)
+	{
+		live[i] = writes[i] < 0 || needed[writes[i]];
+		if (!live[i])
+			continue;
+		mPasses[i].forEachTargetFBO([&needed](int fboIndex) { needed[fboIndex] = true; });
+	}
+
+	//Lifetimes, in live pass indices. Imports start before the first pass, exports end after the last.
+	for (slot = 0; slot < fboCount; ++slot)
+	{
+		firstUse[slot] = mExported[slot] ? numPasses : INT_MAX;
+		lastUse[slot] = mExported[slot] ? INT_MAX : -1;
+	}
+	for (i = 0; i < numPasses; ++i)
+	{
+		if (!live[i])
+			continue;
+		if (writes[i] >= 0)
+		{
+			firstUse[writes[i]] = firstUse[writes[i]] < i ? firstUse[writes[i]] : i;
+			lastUse[writes[i]] = lastUse[writes[i]] > i ? lastUse[writes[i]] : i;
+		}
+		mPasses[i].forEachTargetFBO([&firstUse, &lastUse, i](int fboIndex) {
+			firstUse[fboIndex] = firstUse[fboIndex] < i ? firstUse[fboIndex] : i;
+			lastUse[fboIndex] = lastUse[fboIndex] > i ? lastUse[fboIndex] : i;
+		});
+	}
+	for (slot = 0; slot < fboCount; ++slot)
+		if (mImported[slot] && firstUse[slot] != INT_MAX)
+			firstUse[slot] = -1;
+
+	//Alias: visit used slots in order of first use and give each the first target with the same description that is free
+	//by then. Only descriptions so far; activate() finds FBOs for them.
+	std::vector<int> order;
+	for (slot = 0; slot < fboCount; ++slot)
+	{
+		compiled.slotTarget[slot] = -1;
+		if (mDescs[slot].sizeDivisor && firstUse[slot] != INT_MAX)
+			order.push_back(slot);
+	}
+	std::stable_sort(order.begin(), order.end(), [&firstUse](int a, int b) { return firstUse[a] < firstUse[b]; });
+
+	std::vector<int> targetLastUse;
+	compiled.targets.clear();
+	for (auto s : order)
+	{
+		int chosen = -1;
+		for (size_t t = 0; t < compiled.targets.size() && chosen < 0; ++t)
+			if (compiled.targets[t] == mDescs[s] && targetLastUse[t] < firstUse[s])
+				chosen = (int)t;
+
+		if (chosen < 0)
+		{
+			compiled.targets.push_back(mDescs[s]);
+			targetLastUse.push_back(INT_MIN);
+			chosen = (int)compiled.targets.size() - 1;
+		}
+
+		targetLastUse[chosen] = lastUse[s];
+		compiled.slotTarget[s] = chosen;
+	}
+	compiled.pooled.assign(compiled.targets.size(), -1);
+
+	//Hand the survivors to the path, resolving anything a culled pass used to set for them.
+	int program = GLSLProgramCount;
+	egpVertexArrayObjectDescriptor* vao = nullptr;
+	bool inheritProgram = false, inheritVAO = false, inheritStage = false;
+
+	RenderPath& path = compiled.path;
+	path.clearAllPasses();
+	compiled.numPasses = (unsigned int)numPasses;
+	compiled.numLivePasses = 0;
+	for (i = 0; i < numPasses; ++i)
+	{
+		const RenderPass& pass = mPasses[i];
+		if (pass.getProgram() != GLSLProgramCount)
+			program = pass.getProgram();
+		if (pass.getVAO() != nullptr)
+			vao = pass.getVAO();
+
+		if (!live[i])
+		{
+			inheritProgram |= pass.getProgram() != GLSLProgramCount;
+			inheritVAO |= pass.getVAO() != nullptr;
+			inheritStage |= pass.getPipelineStage() != fboCount;
+			continue;
+		}
+
+		RenderPass resolved = pass.clone();
+		if (inheritProgram && pass.getProgram() == GLSLProgramCount)
+			resolved.setProgram((GLSLProgramIndex)program);
+		if (inheritVAO && pass.getVAO() == nullptr)
+			resolved.setVAO(vao);
+		if (inheritStage && pass.getPipelineStage() == fboCount && writes[i] >= 0)
+			resolved.setPipelineStage((FBOIndex)writes[i]);
+		inheritProgram = inheritVAO = inheritStage = false;
+
+		path.addRenderPass(std::move(resolved));
+		++compiled.numLivePasses;
+	}
+}
+
+void FrameGraph::activate(CompiledFrameGraph& compiled)
+{
+	//Pool entries stamped with this activation are taken; every target gets its own.
+	const unsigned int stamp = ++mActivations;
+	const bool allocate = mFrameWidth && mFrameHeight;
+	const size_t numTargets = compiled.targets.size();
+
+	for (size_t t = 0; t < numTargets; ++t)
+	{
+		const FrameGraphTargetDesc& desc = compiled.targets[t];
+		int chosen = compiled.pooled[t];
+		if (chosen < 0 || chosen >= (int)mPool.size() || !(mPool[chosen].desc == desc) || mPool[chosen].lastActivated == stamp)
+		{
+			chosen = -1;
+			for (size_t p = 0; p < mPool.size() && chosen < 0; ++p)
+				if (mPool[p].desc == desc && mPool[p].lastActivated != stamp)
+					chosen = (int)p;
+		}
+
+		if (chosen < 0 && allocate)
+		{
+			PhysicalTarget target;
+			target.desc = desc;
+			target.fbo = egpfwCreateFBOFormats(mMaxWidth / desc.sizeDivisor, mMaxHeight / desc.sizeDivisor,
+				desc.numColorTargets, desc.colorFormat, desc.depthFormat, desc.wrapSmoothFormat);
+			mPool.push_back(target);
+			chosen = (int)mPool.size() - 1;
+		}
+
+		if (chosen >= 0)
+			mPool[chosen].lastActivated = stamp;
+		compiled.pooled[t] = chosen;
+	}
+
+	evict(compiled);
+	fillSlots(compiled);
+	mActive = &compiled;
+}
+
+void FrameGraph::fillSlots(const CompiledFrameGraph& compiled)
+{
+	//Slots get a copy of the pooled FBO with the frame's part of it as the size, so activating one sets the viewport.
+	for (int slot = 0; slot < fboCount; ++slot)
+	{
+		if (!mDescs[slot].sizeDivisor)
+			continue;
+		const int target = compiled.slotTarget[slot];
+		const int pooled = target >= 0 ? compiled.pooled[target] : -1;
+		mFBOArray[slot] = pooled >= 0 ? mPool[pooled].fbo : egpFrameBufferObjectDescriptor();
+		if (pooled >= 0)
+		{
+			mFBOArray[slot].frameWidth = getTargetWidth((FBOIndex)slot);
+			mFBOArray[slot].frameHeight = getTargetHeight((FBOIndex)slot);
+		}
+	}
+}
+
+void FrameGraph::setPoolBudget(size_t bytes)
+{
+	mPoolBudget = bytes;
+}
+
+void FrameGraph::evict(CompiledFrameGraph& active)
+{
+	const unsigned int stamp = mActivations;
+	size_t spare = 0;
+	for (auto& target : mPool)
+		if (target.lastActivated != stamp)
+			spare += targetBytes(target.desc);
+
+	//Least recently activated first. The last entry moves into the hole, so the active graph's hints are patched.
+	while (spare > mPoolBudget)
+	{
+		size_t oldest = mPool.size();
+		for (size_t p = 0; p < mPool.size(); ++p)
+			if (mPool[p].lastActivated != stamp && (oldest == mPool.size() || mPool[p].lastActivated < mPool[oldest].lastActivated))
+				oldest = p;
+		if (oldest == mPool.size())
+			break;
+
+		spare -= targetBytes(mPool[oldest].desc);
+		releasePhysical(mPool[oldest]);
+		for (auto& index : active.pooled)
+			if (index == (int)mPool.size() - 1)
+				index = (int)oldest;
+		mPool[oldest] = mPool.back();
+		mPool.pop_back();
+	}
+}
+
+void FrameGraph::release()
+{
+	for (auto& target : mPool)
+		releasePhysical(target);
+	mPool.clear();
+
+	for (int slot = 0; slot < fboCount; ++slot)
+		if (mDescs[slot].sizeDivisor)
+			mFBOArray[slot] = egpFrameBufferObjectDescriptor();
+}
+
+void FrameGraph::releasePhysical(PhysicalTarget& target)
+{
+	egpfwReleaseFBO(&target.fbo);
+	target.fbo = egpFrameBufferObjectDescriptor();
+}
+
+size_t FrameGraph::targetBytes(const FrameGraphTargetDesc& desc) const
+{
+	//Bytes per pixel as drivers usually store them (three-channel formats padded to four).
+	static const size_t colorBytes[] = { 0, 4, 8, 16, 4, 8, 16, 4 };
+	static const size_t depthBytes[] = { 0, 2, 4, 4, 4 };
+	size_t bytesPerPixel = depthBytes[desc.depthFormat];
+
+	if (!desc.sizeDivisor)
+		return 0;
+	for (unsigned int i = 0; i < desc.numColorTargets; ++i)
+		bytesPerPixel += colorBytes[desc.colorFormat[i]];
+	const size_t pixels = (size_t)(mMaxWidth / desc.sizeDivisor) * (mMaxHeight / desc.sizeDivisor);
+	return pixels * bytesPerPixel;
+}
+
+void FrameGraph::printStats() const
+{
+	size_t declared = 0, used = 0, pooled = 0;
+	unsigned int numDeclared = 0, numSlots = 0;
+
+	for (int slot = 0; slot < fboCount; ++slot)
+	{
+		declared += targetBytes(mDescs[slot]);
+		numDeclared += mDescs[slot].sizeDivisor != 0;
+	}
+	for (auto& target : mPool)
+		pooled += targetBytes(target.desc);
+
+	if (mActive)
+	{
+		for (int slot = 0; slot < fboCount; ++slot)
+			numSlots += mActive->slotTarget[slot] >= 0;
+		for (auto& desc : mActive->targets)
+			used += targetBytes(desc);
+
+		printf("\n Frame graph: %u/%u passes, %u/%u targets on %u FBOs, %.1f MB (%.1f MB if every target were allocated)\n",
+			mActive->numLivePasses, mActive->numPasses, numSlots, numDeclared, (unsigned int)mActive->targets.size(),
+			used / (1024.0 * 1024.0), declared / (1024.0 * 1024.0));
+	}
+
+	printf(" Target pool: %u FBOs, %.1f MB, %ux%u frame drawn in %ux%u targets", (unsigned int)mPool.size(), pooled / (1024.0 * 1024.0),
+		mFrameWidth, mFrameHeight, mMaxWidth, mMaxHeight);
+	if (mPoolBudget != (size_t)-1)
+		printf(" (%.1f MB kept for inactive graphs at most)", mPoolBudget / (1024.0 * 1024.0));
+	printf("\n");
+}
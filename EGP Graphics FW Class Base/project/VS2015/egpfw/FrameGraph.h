@@ -0,0 +1,182 @@
+#pragma once
+#include <vector>
+#include <initializer_list>
+#include <stddef.h>
+#include "render_enums.h"
+#include "RenderPath.h"
+
+/**
+ * \brief Describes a render target the FrameGraph may create for an FBO slot. Size is relative to the frame size. */
+struct FrameGraphTargetDesc
+{
+	static const unsigned int maxColorTargets = 16;
+
+	unsigned int sizeDivisor;
+	unsigned int numColorTargets;
+	egpColorFormat colorFormat[maxColorTargets];
+	egpDepthFormat depthFormat;
+	egpWrapSmoothFormat wrapSmoothFormat;
+
+	FrameGraphTargetDesc() : sizeDivisor(0), numColorTargets(0), colorFormat(), depthFormat(DEPTH_DISABLE), wrapSmoothFormat(WRAP_DISABLE) {}
+
+	/**
+	 * \param d Size divisor (1 = full frame, 2 = half, ...)
+	 * \param n Number of color targets
+	 * \param c Color format of every target
+	 * \param z Depth format
+	 * \param w Wrap/smooth format */
+	FrameGraphTargetDesc(unsigned int d, unsigned int n, egpColorFormat c, egpDepthFormat z, egpWrapSmoothFormat w);
+	/**
+	 * \param c Color format of each target, in order; as many targets as formats */
+	FrameGraphTargetDesc(unsigned int d, std::initializer_list<egpColorFormat> c, egpDepthFormat z, egpWrapSmoothFormat w);
+
+	bool operator==(const FrameGraphTargetDesc& other) const;
+};
+
+/**
+ * \brief What FrameGraph::compile() produced: the path to run and the targets it needs, with no FBOs behind them yet.
+ * Any number can be kept around; FrameGraph::activate() points the FBO slots at one, so switching between them is cheap. */
+struct CompiledFrameGraph
+{
+	RenderPath path;
+
+	//Targets left after aliasing, and which one each slot uses (-1 if the slot isn't used).
+	std::vector<FrameGraphTargetDesc> targets;
+	int slotTarget[fboCount];
+	//Pool entry each target got when last activated; only a hint, since entries move when others are evicted.
+	std::vector<int> pooled;
+
+	unsigned int numPasses, numLivePasses;
+
+	CompiledFrameGraph();
+};
+
+/**
+ * \brief Builds RenderPaths from passes, creating only the FBOs those passes need, and only once they are about to run.
+ * Each pass writes the FBO in its pipeline stage and reads the FBOs in its color/depth targets. Passes whose results never
+ * reach an output are culled, and slots with identical descriptions whose lifetimes don't overlap share one target.
+ * FBOs live in a pool shared by every compiled graph: activate() reuses whatever fits, creates the rest, and releases
+ * the least recently activated ones that aren't needed while the pool is over its budget.
+ * Pooled FBOs are allocated for the largest frame size (see setMaxFrameSize) and drawn to in part: resizing the frame only
+ * changes the viewport the slots get, so nothing is reallocated unless the frame outgrows them. Shaders sampling a target
+ * scale their texture coordinates by getFrameScaleX/Y().
+ * Declared slots are owned by the graph: fbo[slot] is filled in by activate() and emptied for slots that aren't needed. */
+class FrameGraph
+{
+	private:
+		struct PhysicalTarget
+		{
+			FrameGraphTargetDesc desc;
+			egpFrameBufferObjectDescriptor fbo;
+			unsigned int lastActivated;
+		};
+
+		egpFrameBufferObjectDescriptor* mFBOArray;
+		unsigned int mFrameWidth, mFrameHeight;
+		//Size pooled FBOs are allocated for; the frame is drawn in its lower left corner.
+		unsigned int mMaxWidth, mMaxHeight;
+
+		FrameGraphTargetDesc mDescs[fboCount];
+		bool mImported[fboCount];
+		bool mExported[fboCount];
+
+		std::vector<RenderPass> mPasses;
+		std::vector<PhysicalTarget> mPool;
+		size_t mPoolBudget;
+
+		//Counts activations; pool entries remember the last one that used them.
+		unsigned int mActivations;
+		const CompiledFrameGraph* mActive;
+
+		void evict(CompiledFrameGraph& active);
+		void fillSlots(const CompiledFrameGraph& compiled);
+		void releasePhysical(PhysicalTarget& target);
+		size_t targetBytes(const FrameGraphTargetDesc& desc) const;
+
+	public:
+		/**
+		 * \param fbos Pointer to the global FBO array. */
+		explicit FrameGraph(egpFrameBufferObjectDescriptor* fbos);
+		~FrameGraph();
+
+		/**
+		 * \brief Let the graph create the FBO for a slot. Takes effect at the next compile(). */
+		void declareTarget(FBOIndex slot, const FrameGraphTargetDesc& desc);
+		const FrameGraphTargetDesc& getTargetDesc(FBOIndex slot) const { return mDescs[slot]; }
+		/**
+		 * \brief Size of the part of a slot's target that is drawn to, rounded up so it covers the whole frame. */
+		unsigned int getTargetWidth(FBOIndex slot) const;
+		unsigned int getTargetHeight(FBOIndex slot) const;
+		/**
+		 * \brief Size a slot's target is allocated at. One texel is 1 / this in texture coordinates. */
+		unsigned int getTargetTextureWidth(FBOIndex slot) const;
+		unsigned int getTargetTextureHeight(FBOIndex slot) const;
+		/**
+		 * \brief Part of every target the frame covers: texture coordinates in [0, 1] over the frame are this much of a
+		 * target's. */
+		float getFrameScaleX() const { return mMaxWidth ? (float)mFrameWidth / (float)mMaxWidth : 1.0f; }
+		float getFrameScaleY() const { return mMaxHeight ? (float)mFrameHeight / (float)mMaxHeight : 1.0f; }
+
+		/**
+		 * \brief Set the largest frame size expected (e.g. the screen's). Pooled FBOs are allocated at this size (rounded up)
+		 * so later frame sizes fit in them. Releases every FBO if it changes. */
+		void setMaxFrameSize(unsigned int width, unsigned int height);
+		/**
+		 * \brief Set the size that declared targets are relative to. If it fits the maximum size, the FBOs are kept and the
+		 * active graph's slots just get the new viewport; otherwise the maximum grows to fit and every FBO is released for
+		 * the next activate() to create again. Compiled graphs stay valid. Nothing is created while either dimension is
+		 * zero. */
+		void setFrameSize(unsigned int width, unsigned int height);
+		/**
+		 * \brief Whether setFrameSize() with this size keeps the FBOs. */
+		bool fitsFrameSize(unsigned int width, unsigned int height) const { return width <= mMaxWidth && height <= mMaxHeight; }
+
+		/**
+		 * \brief Take ownership of a pass; hand it over with std::move. The handle stays valid until clearPasses(). */
+		RenderPassHandle addPass(RenderPass&& pass);
+		template <typename... Passes>
+		void addPasses(Passes&&... passes);
+		/**
+		 * \brief Edit a pass in place. Takes effect at the next compile(). */
+		RenderPass& getPass(RenderPassHandle handle) { return mPasses[handle]; }
+		void clearPasses();
+
+		/**
+		 * \brief Mark a slot as written before the graph runs (e.g. the skybox clearing the scene), so it is never shared with
+		 * something used earlier in the frame. */
+		void importTarget(FBOIndex slot);
+		/**
+		 * \brief Mark a slot as read after the graph runs (e.g. the final display). Only passes that contribute to an
+		 * exported slot are kept. */
+		void exportTarget(FBOIndex slot);
+		void clearExports();
+
+		/**
+		 * \brief Cull, compute lifetimes and alias targets, and fill the compiled path with the passes that survive.
+		 * Creates no FBOs; activate the result before rendering it (again, if it was the active one).
+		 * A culled pass's program, VAO or pipeline stage is carried over to the next pass that relied on inheriting it. */
+		void compile(CompiledFrameGraph& compiled);
+		/**
+		 * \brief Point the declared FBO slots at FBOs for a compiled graph's targets, creating any the pool doesn't have.
+		 * The graph must stay alive while it is active. */
+		void activate(CompiledFrameGraph& compiled);
+		const CompiledFrameGraph* getActive() const { return mActive; }
+		/**
+		 * \brief Bytes of targets the pool keeps for graphs that aren't active. The active graph's targets are always
+		 * kept, even past the budget. Defaults to unlimited. */
+		void setPoolBudget(size_t bytes);
+		/**
+		 * \brief Release every FBO the graph created and empty their slots. */
+		void release();
+
+		/**
+		 * \brief Print what the active graph kept, how much target memory aliasing saved, and what the pool holds. */
+		void printStats() const;
+};
+
+template <typename... Passes>
+inline void FrameGraph::addPasses(Passes&&... passes)
+{
+	int expand[] = { 0, ((void)addPass(std::forward<Passes>(passes)), 0)... };
+	(void)expand;
+}
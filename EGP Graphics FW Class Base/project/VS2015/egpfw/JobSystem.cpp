@@ -0,0 +1,80 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(unsigned int numWorkers)
+{
+	mNumWorkers = numWorkers;
+	mJob = nullptr;
+	mNextJob = mJobCount = mJobsLeft = 0;
+	mStopping = false;
+}
+
+JobSystem::~JobSystem()
+{
+	shutdown();
+}
+
+void JobSystem::start()
+{
+	if (!mWorkers.empty())
+		return;
+
+	mStopping = false;
+	for (unsigned int i = 0; i < mNumWorkers; ++i)
+		mWorkers.push_back(std::thread(&JobSystem::workerLoop, this));
+}
+
+void JobSystem::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWorkReady.notify_all();
+
+	for (auto& worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+}
+
+void JobSystem::run(unsigned int count, const std::function<void(unsigned int)>& job)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mJob = &job;
+	mNextJob = 0;
+	mJobCount = mJobsLeft = count;
+	lock.unlock();
+	mWorkReady.notify_all();
+
+	//Help out rather than sit idle, then wait for whatever the workers are still running.
+	lock.lock();
+	while (mNextJob < mJobCount)
+	{
+		const unsigned int index = mNextJob++;
+		lock.unlock();
+		job(index);
+		lock.lock();
+		--mJobsLeft;
+	}
+	mWorkDone.wait(lock, [this] { return mJobsLeft == 0; });
+	mJob = nullptr;
+}
+
+void JobSystem::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWorkReady.wait(lock, [this] { return mStopping || (mJob && mNextJob < mJobCount); });
+		if (mStopping)
+			return;
+
+		const std::function<void(unsigned int)>& job = *mJob;
+		const unsigned int index = mNextJob++;
+		lock.unlock();
+		job(index);
+		lock.lock();
+
+		if (--mJobsLeft == 0)
+			mWorkDone.notify_one();
+	}
+}
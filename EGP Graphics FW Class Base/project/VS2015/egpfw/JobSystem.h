@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * \brief Fixed pool of worker threads that run batches of indexed jobs.
+ * The thread calling run() works on the batch too and returns once every job is done, so a JobSystem with no workers
+ * (or one that hasn't been started) simply runs everything on the caller. Only one thread may call run() at a time. */
+class JobSystem
+{
+	private:
+		unsigned int mNumWorkers;
+		std::vector<std::thread> mWorkers;
+
+		std::mutex mMutex;
+		std::condition_variable mWorkReady, mWorkDone;
+
+		const std::function<void(unsigned int)>* mJob;
+		unsigned int mNextJob, mJobCount, mJobsLeft;
+		bool mStopping;
+
+		void workerLoop();
+
+	public:
+		/**
+		 * \brief Create a JobSystem. No threads run until start() is called.
+		 * \param numWorkers Number of threads besides the one calling run(). */
+		explicit JobSystem(unsigned int numWorkers);
+		~JobSystem();
+
+		void start();
+		void shutdown();
+
+		/**
+		 * \brief Number of threads a batch is spread over while running, the caller included. */
+		unsigned int getNumThreads() const { return (unsigned int)mWorkers.size() + 1; }
+
+		/**
+		 * \brief Call job(i) for every i in [0, count), spread over the workers and the calling thread. Blocks until all are done.
+		 * Jobs may run in any order and at the same time, so each must only write data no other job touches. */
+		void run(unsigned int count, const std::function<void(unsigned int)>& job);
+};
@@ -176,27 +176,27 @@ void KeyframeWindow::renderToFBO(int* curveUniformSet, int* solidColorUniformSet
 	for (size_t i = 0; i < mWaypointChannels.size(); ++i)
 	{
 		// draw curve
-		egpActivateProgram(mProgramList + drawCurveProgram);
-		egpSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
+		egpfwActivateProgram(mProgramList + drawCurveProgram);
+		egpfwSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
 
 		vecSize = mWaypointChannels[i].size();
 
 		// ship waypoint data to program, where it will be received by GS
-		egpSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, mWaypointChannels[i].data()->v);
-		egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
-		egpSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &vecSize);
-		egpSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
-		egpSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
+		egpfwSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, mWaypointChannels[i].data()->v);
+		egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
+		egpfwSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &vecSize);
+		egpfwSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
+		egpfwSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
 
-		egpActivateVAO(mVAOList + pointModel);
-		egpDrawActiveVAO();
+		egpfwActivateVAO(mVAOList + pointModel);
+		egpfwDrawActiveVAO();
 
 		// draw waypoints using solid color program and sphere model
 		cbmath::mat4 waypointModelMatrix = cbmath::makeScale4(4.0f);
-		egpActivateProgram(mProgramList + testSolidColorProgramIndex);
-		egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
+		egpfwActivateProgram(mProgramList + testSolidColorProgramIndex);
+		egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
 
-		egpActivateVAO(mVAOList + sphere8x6Model);
+		egpfwActivateVAO(mVAOList + sphere8x6Model);
 
 		// draw waypoints
 		for (j = 0, waypointPtr = mWaypointChannels[i].data(); j < mWaypointChannels[i].size(); ++j, ++waypointPtr)
@@ -204,57 +204,57 @@ void KeyframeWindow::renderToFBO(int* curveUniformSet, int* solidColorUniformSet
 			// set position, update MVP for this waypoint and draw
 			waypointModelMatrix.c3 = *waypointPtr;
 			waypointMVP = mLittleBoxWindowMatrix * waypointModelMatrix;
-			egpSendUniformFloatMatrix(solidColorUniformSet[unif_mvp], UNIF_MAT4, 1, 0, waypointMVP.m);
-			egpDrawActiveVAO();
+			egpfwSendUniformFloatMatrix(solidColorUniformSet[unif_mvp], UNIF_MAT4, 1, 0, waypointMVP.m);
+			egpfwDrawActiveVAO();
 		}
 	}
 
 	//Drew all the keyframes. Now, draw the scrub head thing.
 	cbmath::vec4 points[2] = { cbmath::vec4(t / 2 * mWindowSize.x, 0.0f, 0.0f, 1.0f), cbmath::vec4(t / 2 * mWindowSize.x, mWindowSize.y, 0.0f, 1.0f) };
-	egpActivateProgram(mProgramList + drawCurveProgram);
-	egpSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
+	egpfwActivateProgram(mProgramList + drawCurveProgram);
+	egpfwSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
 
-	egpSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, points[0].v);
-	egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[NUM_OF_CHANNELS].v);
-	egpSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &twoTest);
-	egpSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
-	egpSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
+	egpfwSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, points[0].v);
+	egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[NUM_OF_CHANNELS].v);
+	egpfwSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &twoTest);
+	egpfwSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
+	egpfwSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
 
-	egpActivateVAO(mVAOList + pointModel);
-	egpDrawActiveVAO();
+	egpfwActivateVAO(mVAOList + pointModel);
+	egpfwDrawActiveVAO();
 
 	//Now, draw the x axis.
 	points[0] = cbmath::vec4(0.0f, mWindowSize.y / 2.0f, 0.0f, 1.0f);
 	points[1] = cbmath::vec4(mWindowSize.x, mWindowSize.y / 2.0f, 0.0f, 1.0f);
 
-	egpActivateProgram(mProgramList + drawCurveProgram);
-	egpSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
+	egpfwActivateProgram(mProgramList + drawCurveProgram);
+	egpfwSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
 
-	egpSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, points[0].v);
-	egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[NUM_OF_CHANNELS].v);
-	egpSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &twoTest);
-	egpSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
-	egpSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
+	egpfwSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, points[0].v);
+	egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[NUM_OF_CHANNELS].v);
+	egpfwSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &twoTest);
+	egpfwSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
+	egpfwSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
 
-	egpActivateVAO(mVAOList + pointModel);
-	egpDrawActiveVAO();
+	egpfwActivateVAO(mVAOList + pointModel);
+	egpfwDrawActiveVAO();
 	
 }
 
 void KeyframeWindow::renderToBackbuffer(int* textureUniformSet)
 {
 	//Draw our FBO to the backbuffer
-	egpActivateProgram(mProgramList + testTextureProgramIndex);
-	egpActivateVAO(mVAOList + fsqModel);
+	egpfwActivateProgram(mProgramList + testTextureProgramIndex);
+	egpfwActivateVAO(mVAOList + fsqModel);
 	egpfwBindColorTargetTexture(mFBOList + curvesFBO, 0, 0);
-	egpSendUniformFloatMatrix(textureUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mOnScreenMatrix.m);
-	egpDrawActiveVAO();
+	egpfwSendUniformFloatMatrix(textureUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mOnScreenMatrix.m);
+	egpfwDrawActiveVAO();
 
 	//Draw the axes using immediate mode :( :( :(
 	//Seriously though, how do you even do this with the programmable pipeline???
 
 	glBegin(GL_BITMAP); //more like GL_BUTTMAP hahahaha
-	egpActivateProgram(0);
+	egpfwActivateProgram(0);
 	glDisable(GL_TEXTURE_2D);
 
 	auto color = COLORS[mCurrentChannel];
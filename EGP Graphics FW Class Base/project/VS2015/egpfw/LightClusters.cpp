@@ -0,0 +1,250 @@
+#include "LightClusters.h"
+#include <GL/glew.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+//Fewer lights than this per job aren't worth waking a worker for.
+static const unsigned int minLightsPerBatch = 64;
+
+//Weight of the newest build time in the smoothed one.
+static const float smoothing = 0.1f;
+
+LightClusters::LightClusters()
+{
+	mTilesX = 16;
+	mTilesY = 9;
+	mSlices = 24;
+
+	mSliceScale = mSliceBias = mNear = mFar = 0.0f;
+	mDepthA = mDepthB = 0.0f;
+
+	mListBuffer = egpTextureBufferObjectDescriptor();
+	mJobs = nullptr;
+	mNumLights = mNumVisible = mNumEntries = mMaxPerCluster = mNumBatches = 0;
+	mBuildMs = 0.0f;
+}
+
+LightClusters::~LightClusters()
+{
+	//The buffer belongs to the context, which may be gone by now; release() is for a clean shutdown.
+}
+
+void LightClusters::setGrid(unsigned int tilesX, unsigned int tilesY, unsigned int slices)
+{
+	mTilesX = tilesX ? tilesX : 1;
+	mTilesY = tilesY ? tilesY : 1;
+	mSlices = slices ? slices : 1;
+
+	//Slice depths are rebuilt on the next build.
+	mNear = mFar = 0.0f;
+}
+
+void LightClusters::create()
+{
+	//Start big enough for the clusters, a few hundred lights and two in each cluster (half a texel); updates grow it
+	//when needed.
+	const unsigned int numClusters = mTilesX * mTilesY * mSlices;
+	mListBuffer = egpfwCreateTBO(GL_RGBA32UI, (numClusters + 256 * 2 + numClusters / 2) * 4 * sizeof(uint32_t), 0);
+}
+
+void LightClusters::setDepthRange(float zNear, float zFar)
+{
+	if (zNear == mNear && zFar == mFar && mSliceDepth.size() == mSlices + 1)
+		return;
+
+	mNear = zNear;
+	mFar = zFar;
+	mSliceScale = (float)mSlices / logf(zFar / zNear);
+	mSliceBias = -logf(zNear) * mSliceScale;
+
+	mSliceDepth.resize(mSlices + 1);
+	for (unsigned int s = 0; s <= mSlices; ++s)
+		mSliceDepth[s] = zNear * powf(zFar / zNear, (float)s / (float)mSlices);
+}
+
+unsigned int LightClusters::sliceOf(float depth) const
+{
+	const float s = logf(depth) * mSliceScale + mSliceBias;
+	return s <= 0.0f ? 0 : s >= (float)(mSlices - 1) ? mSlices - 1 : (unsigned int)s;
+}
+
+void LightClusters::cull(const cbmath::vec4* position, const cbmath::vec4* color, unsigned int first, unsigned int last,
+	const cbmath::mat4& viewMat, float zNear, float zFar, Batch& batch) const
+{
+	batch.lightData.clear();
+	batch.hits.clear();
+
+	for (unsigned int i = first; i < last; ++i)
+	{
+		const float radius = color[i].w;
+		const cbmath::vec4 view = viewMat * position[i];
+		const float depth = -view.z;
+		if (radius <= 0.0f || depth + radius < zNear || depth - radius > zFar)
+			continue;
+
+		//The sphere's box, as x and y over depth, bounds the tiles it can touch. Over a box those ratios are largest
+		//and smallest at its corners.
+		const float depthMin = depth - radius > zNear ? depth - radius : zNear;
+		const float depthMax = depth + radius < zFar ? depth + radius : zFar;
+		const float loX = fminf((view.x - radius) / depthMin, (view.x - radius) / depthMax);
+		const float hiX = fmaxf((view.x + radius) / depthMin, (view.x + radius) / depthMax);
+		const float loY = fminf((view.y - radius) / depthMin, (view.y - radius) / depthMax);
+		const float hiY = fmaxf((view.y + radius) / depthMin, (view.y + radius) / depthMax);
+		if (hiX < mEdgeX[0] || loX > mEdgeX[mTilesX] || hiY < mEdgeY[0] || loY > mEdgeY[mTilesY])
+			continue;
+
+		unsigned int x0 = 0, x1 = mTilesX - 1, y0 = 0, y1 = mTilesY - 1;
+		while (x0 < x1 && mEdgeX[x0 + 1] <= loX) ++x0;
+		while (x1 > x0 && mEdgeX[x1] >= hiX) --x1;
+		while (y0 < y1 && mEdgeY[y0 + 1] <= loY) ++y0;
+		while (y1 > y0 && mEdgeY[y1] >= hiY) --y1;
+		const unsigned int s0 = sliceOf(depthMin), s1 = sliceOf(depthMax);
+
+		//Each candidate cluster is a frustum piece; the sphere is tested against its box, which is a little loose near
+		//the corners but never misses.
+		const unsigned int light = (unsigned int)(batch.lightData.size() / 2);
+		const size_t numHits = batch.hits.size();
+		for (unsigned int s = s0; s <= s1; ++s)
+		{
+			const float d0 = mSliceDepth[s], d1 = mSliceDepth[s + 1];
+			const float dz = depth < d0 ? d0 - depth : depth > d1 ? depth - d1 : 0.0f;
+			for (unsigned int y = y0; y <= y1; ++y)
+			{
+				const float lo = fminf(mEdgeY[y] * d0, mEdgeY[y] * d1), hi = fmaxf(mEdgeY[y + 1] * d0, mEdgeY[y + 1] * d1);
+				const float dy = view.y < lo ? lo - view.y : view.y > hi ? view.y - hi : 0.0f;
+				for (unsigned int x = x0; x <= x1; ++x)
+				{
+					const float lo = fminf(mEdgeX[x] * d0, mEdgeX[x] * d1), hi = fmaxf(mEdgeX[x + 1] * d0, mEdgeX[x + 1] * d1);
+					const float dx = view.x < lo ? lo - view.x : view.x > hi ? view.x - hi : 0.0f;
+					if (dx * dx + dy * dy + dz * dz <= radius * radius)
+					{
+						batch.hits.push_back((s * mTilesY + y) * mTilesX + x);
+						batch.hits.push_back(light);
+					}
+				}
+			}
+		}
+
+		//Only lights that reached a cluster are uploaded.
+		if (batch.hits.size() != numHits)
+		{
+			batch.lightData.push_back(cbmath::vec4(position[i].x, position[i].y, position[i].z, radius));
+			batch.lightData.push_back(color[i]);
+		}
+	}
+}
+
+void LightClusters::build(const cbmath::vec4* position, const cbmath::vec4* color, unsigned int count, const cbmath::mat4& viewMat,
+	const cbmath::mat4& projectionMat, float zNear, float zFar)
+{
+	const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	setDepthRange(zNear, zFar);
+
+	//Clip z over clip w is -m22 + m32 / depth, so depth comes back as m32 / (ndc + m22).
+	mDepthA = projectionMat.m22;
+	mDepthB = projectionMat.m32;
+
+	const float scaleX = projectionMat.m00, scaleY = projectionMat.m11;
+	mEdgeX.resize(mTilesX + 1);
+	mEdgeY.resize(mTilesY + 1);
+	for (unsigned int t = 0; t <= mTilesX; ++t)
+		mEdgeX[t] = (2.0f * (float)t / (float)mTilesX - 1.0f) / scaleX;
+	for (unsigned int t = 0; t <= mTilesY; ++t)
+		mEdgeY[t] = (2.0f * (float)t / (float)mTilesY - 1.0f) / scaleY;
+	mNumLights = count;
+
+	//Contiguous runs of lights, one per job, so merging the runs in order finds every hit in the same order as one
+	//thread would.
+	unsigned int numBatches = (count + minLightsPerBatch - 1) / minLightsPerBatch;
+	if (!mJobs || numBatches < 1)
+		numBatches = 1;
+	else if (numBatches > mJobs->getNumThreads())
+		numBatches = mJobs->getNumThreads();
+	if (mBatches.size() < numBatches)
+		mBatches.resize(numBatches);
+	mNumBatches = numBatches;
+
+	//The grid is only read while culling, and each job writes only its own batch.
+	auto job = [&](unsigned int b)
+	{
+		cull(position, color, count * b / numBatches, count * (b + 1) / numBatches, viewMat, zNear, zFar, mBatches[b]);
+	};
+	if (numBatches > 1)
+		mJobs->run(numBatches, job);
+	else
+		job(0);
+
+	//Lights are numbered after those of the batches before them, and go after the clusters.
+	const unsigned int numClusters = mTilesX * mTilesY * mSlices;
+	uint32_t numEntries = 0;
+	mNumVisible = 0;
+	for (unsigned int b = 0; b < numBatches; ++b)
+	{
+		mNumVisible += (unsigned int)(mBatches[b].lightData.size() / 2);
+		numEntries += (uint32_t)(mBatches[b].hits.size() / 2);
+	}
+	const uint32_t lightTexel = numClusters, indexBase = (numClusters + mNumVisible * 2) * 4;
+	mListData.assign(indexBase + (numEntries + 3) / 4 * 4, 0);
+	mNumEntries = numEntries;
+
+	//Count, turn the counts into offsets, then place each hit; a cluster's lights keep the order they were found in.
+	for (unsigned int b = 0; b < numBatches; ++b)
+	{
+		const std::vector<uint32_t>& hits = mBatches[b].hits;
+		for (size_t h = 0; h < hits.size(); h += 2)
+			++mListData[hits[h] * 4 + 1];
+	}
+
+	uint32_t offset = indexBase;
+	mMaxPerCluster = 0;
+	for (unsigned int c = 0; c < numClusters; ++c)
+	{
+		const uint32_t n = mListData[c * 4 + 1];
+		mMaxPerCluster = n > mMaxPerCluster ? n : mMaxPerCluster;
+		mListData[c * 4] = offset;
+		mListData[c * 4 + 1] = 0;
+		offset += n;
+	}
+
+	uint32_t light = lightTexel;
+	for (unsigned int b = 0; b < numBatches; ++b)
+	{
+		const Batch& batch = mBatches[b];
+		for (size_t h = 0; h < batch.hits.size(); h += 2)
+		{
+			uint32_t* cluster = &mListData[batch.hits[h] * 4];
+			mListData[cluster[0] + cluster[1]++] = light + batch.hits[h + 1] * 2;
+		}
+		if (!batch.lightData.empty())
+			memcpy(&mListData[light * 4], batch.lightData.data(), batch.lightData.size() * sizeof(cbmath::vec4));
+		light += (uint32_t)batch.lightData.size();
+	}
+
+	egpfwUpdateTBO(&mListBuffer, (unsigned int)(mListData.size() * sizeof(uint32_t)), mListData.data());
+
+	const std::chrono::duration<float, std::milli> cpu = std::chrono::high_resolution_clock::now() - start;
+	mBuildMs += (cpu.count() - mBuildMs) * smoothing;
+}
+
+cbmath::vec4 LightClusters::getGridParams() const
+{
+	return cbmath::vec4((float)mTilesX, (float)mTilesY, (float)mSlices, 0.0f);
+}
+
+cbmath::vec4 LightClusters::getDepthParams() const
+{
+	return cbmath::vec4(mDepthA, mDepthB, mSliceScale, mSliceBias);
+}
+
+void LightClusters::printStats() const
+{
+	printf("\n Light clusters: %ux%ux%u, %u of %u lights visible, %u cluster entries, at most %u lights in a cluster; built in %.3f ms over %u jobs\n",
+		mTilesX, mTilesY, mSlices, mNumVisible, mNumLights, mNumEntries, mMaxPerCluster, mBuildMs, mNumBatches);
+}
+
+void LightClusters::release()
+{
+	egpfwReleaseTBO(&mListBuffer);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <cbmath/cbtkMatrix.h>
+#include "egpfw/egpfw/egpfwShaderProgram.h"
+#include "JobSystem.h"
+
+/**
+ * \brief Sorts point lights into a grid of clusters over the view frustum, so a shading pass only looks at the lights
+ * that can reach each pixel.
+ * The frustum is split into screen tiles, and each tile into slices that get deeper with distance (the slice of a view
+ * depth is its log), so clusters are roughly cube-shaped all the way out. Every frame each light's sphere is tested
+ * against the clusters it might touch, and the lists are packed into one RGBA32UI texture buffer the shader reads with
+ * texelFetch (one buffer rather than three, since a shader only gets 16 samplers on GL 4.1 and the texture table takes
+ * most of them). In order:
+ * - clusters: one texel each, numbered tile x, then tile y, then slice; x is where its run starts in the index list
+ *   (counted in uints from the start of the buffer, four to a texel), y how many lights are in it;
+ * - lights: two texels each, world position and radius, then color, as float bits;
+ * - indices: four to a texel, each the texel of a light.
+ *  Shading cost then follows the lights near each pixel, not the
+ * lights in the scene. Culling is spread over a JobSystem if there is one; everything else is GL thread only. */
+class LightClusters
+{
+	private:
+		unsigned int mTilesX, mTilesY, mSlices;
+
+		//Tile edges in NDC over the projection scale, so x_view = edge * depth (depth positive into the screen).
+		std::vector<float> mEdgeX, mEdgeY;
+		//Slice boundaries in view depth; mSlices + 1 of them.
+		std::vector<float> mSliceDepth;
+		float mSliceScale, mSliceBias, mNear, mFar;
+		float mDepthA, mDepthB;
+
+		//What one job found in its run of lights: their texels, then the cluster of each (cluster, light) hit followed by
+		//the light's index within the run, in the order found.
+		struct Batch
+		{
+			std::vector<cbmath::vec4> lightData;
+			std::vector<uint32_t> hits;
+		};
+
+		//Texel data, four uints a texel, kept between frames so building allocates nothing once it has seen the most lights.
+		std::vector<uint32_t> mListData;
+		std::vector<Batch> mBatches;
+
+		egpTextureBufferObjectDescriptor mListBuffer;
+
+		JobSystem* mJobs;
+
+		//Last build, for printStats().
+		unsigned int mNumLights, mNumVisible, mNumEntries, mMaxPerCluster, mNumBatches;
+		float mBuildMs;
+
+		void setDepthRange(float zNear, float zFar);
+		unsigned int sliceOf(float depth) const;
+		void cull(const cbmath::vec4* position, const cbmath::vec4* color, unsigned int first, unsigned int last,
+			const cbmath::mat4& viewMat, float zNear, float zFar, Batch& batch) const;
+
+	public:
+		LightClusters();
+		~LightClusters();
+
+		/**
+		 * \brief Grid size. Takes effect on the next build; the buffers grow to fit. */
+		void setGrid(unsigned int tilesX, unsigned int tilesY, unsigned int slices);
+
+		/**
+		 * \brief Cull runs of lights on these threads when building. Null (the default) culls everything on the calling thread. */
+		void setJobSystem(JobSystem* jobs) { mJobs = jobs; }
+
+		/**
+		 * \brief Create the texture buffer. Its texture name never changes afterwards, so passes can bind it once. */
+		void create();
+
+		/**
+		 * \brief Cull the lights into the grid and upload the lists.
+		 * \param position World position of each light.
+		 * \param color Color of each light in xyz, radius in w.
+		 * \param viewMat World to view transform.
+		 * \param projectionMat Perspective projection (from makePerspective).
+		 * \param zNear, zFar Clip planes of the projection. */
+		void build(const cbmath::vec4* position, const cbmath::vec4* color, unsigned int count, const cbmath::mat4& viewMat,
+			const cbmath::mat4& projectionMat, float zNear, float zFar);
+
+		/**
+		 * \brief Shader constants. grid: tiles across, tiles down, slices. depth: view depth from NDC depth is
+		 * y / (ndc + x); the slice of a view depth is log(depth) * z + w. */
+		cbmath::vec4 getGridParams() const;
+		cbmath::vec4 getDepthParams() const;
+
+		unsigned int getListTexture() const { return mListBuffer.texhandle; }
+
+		/**
+		 * \brief Print how many lights the last build kept, how full the clusters were and how long building took. */
+		void printStats() const;
+
+		/**
+		 * \brief Delete the texture buffer. Needs the GL context, so it can't wait for the destructor. */
+		void release();
+};
@@ -0,0 +1,100 @@
+#include "PassTimer.h"
+#include <GL/glew.h>
+
+//Weight of the newest sample; the rest comes from previous frames.
+static const float smoothing = 0.1f;
+
+PassTimer::PassTimer()
+{
+	mFrame = 0;
+	mActivePass = 0;
+	mPassActive = false;
+}
+
+PassTimer::~PassTimer()
+{
+	//Queries belong to the context, which may be gone by now; release() is for a clean shutdown.
+}
+
+void PassTimer::resize(unsigned int numPasses)
+{
+	if (numPasses == mTimings.size())
+		return;
+
+	release();
+	for (unsigned int s = 0; s < numQuerySets; ++s)
+	{
+		mQueries[s].resize(numPasses);
+		mIssued[s].assign(numPasses, 0);
+		if (numPasses)
+			glGenQueries(numPasses, mQueries[s].data());
+	}
+	mTimings.assign(numPasses, PassTiming());
+}
+
+void PassTimer::release()
+{
+	for (unsigned int s = 0; s < numQuerySets; ++s)
+	{
+		if (!mQueries[s].empty())
+			glDeleteQueries((GLsizei)mQueries[s].size(), mQueries[s].data());
+		mQueries[s].clear();
+		mIssued[s].clear();
+	}
+	mTimings.clear();
+	mPassActive = false;
+}
+
+void PassTimer::beginFrame()
+{
+	const unsigned int set = mFrame % numQuerySets;
+	GLuint available;
+	GLuint64 elapsed;
+
+	for (unsigned int i = 0; i < mQueries[set].size(); ++i)
+	{
+		if (!mIssued[set][i])
+			continue;
+
+		glGetQueryObjectuiv(mQueries[set][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		glGetQueryObjectui64v(mQueries[set][i], GL_QUERY_RESULT, &elapsed);
+		mTimings[i].gpuMs += ((float)(elapsed * 1.0e-6) - mTimings[i].gpuMs) * smoothing;
+		mIssued[set][i] = 0;
+	}
+}
+
+void PassTimer::beginPass(unsigned int i)
+{
+	if (mPassActive)
+		endPass();
+	if (i >= mTimings.size())
+		return;
+
+	//A query still waiting on the GPU is simply reissued; its old result is lost, not waited for.
+	const unsigned int set = mFrame % numQuerySets;
+	glBeginQuery(GL_TIME_ELAPSED, mQueries[set][i]);
+	mIssued[set][i] = 1;
+
+	mActivePass = i;
+	mPassActive = true;
+	mPassStart = std::chrono::high_resolution_clock::now();
+}
+
+void PassTimer::endPass()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+
+	const std::chrono::duration<float, std::milli> cpu = std::chrono::high_resolution_clock::now() - mPassStart;
+	mTimings[mActivePass].cpuMs += (cpu.count() - mTimings[mActivePass].cpuMs) * smoothing;
+	mPassActive = false;
+}
+
+void PassTimer::endFrame()
+{
+	if (mPassActive)
+		endPass();
+	++mFrame;
+}
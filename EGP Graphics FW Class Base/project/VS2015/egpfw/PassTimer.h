@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <chrono>
+
+/**
+ * \brief Time spent on one pass, smoothed over a few frames so it can be read at a glance. */
+struct PassTiming
+{
+	float gpuMs;
+	float cpuMs;
+};
+
+/**
+ * \brief Measures every pass of a RenderPath with GL_TIME_ELAPSED queries and CPU timestamps.
+ * Queries are double-buffered: a frame's results are read two frames later, and only if the GPU already has them,
+ * so reading back never stalls. A pass whose result isn't ready keeps its previous timing. GL thread only. */
+class PassTimer
+{
+	private:
+		static const unsigned int numQuerySets = 2;
+
+		std::vector<unsigned int> mQueries[numQuerySets];
+		std::vector<unsigned char> mIssued[numQuerySets];
+		std::vector<PassTiming> mTimings;
+
+		unsigned int mFrame;
+		unsigned int mActivePass;
+		bool mPassActive;
+		std::chrono::high_resolution_clock::time_point mPassStart;
+
+		void endPass();
+
+	public:
+		PassTimer();
+		~PassTimer();
+
+		/**
+		 * \brief Make room for numPasses passes, (re)creating queries if the count changed. Timings start over at zero. */
+		void resize(unsigned int numPasses);
+		/**
+		 * \brief Delete all queries and forget every timing. */
+		void release();
+
+		/**
+		 * \brief Collect whatever results from the last use of this frame's queries are ready. */
+		void beginFrame();
+		/**
+		 * \brief Stop timing the previous pass (if any) and start timing pass i. */
+		void beginPass(unsigned int i);
+		void endFrame();
+
+		const std::vector<PassTiming>& getTimings() const { return mTimings; }
+};
@@ -0,0 +1,62 @@
+#include "RenderCommand.h"
+#include "RenderQueue.h"
+#include "egpfw/egpfw.h"
+
+void executeRenderCommand(const RenderCommand& cmd, const float* const* gatherSources, float* gatherScratch)
+{
+	switch (cmd.type)
+	{
+		case RENDER_COMMAND_PASS_BEGIN:
+			break;
+		case RENDER_COMMAND_PROGRAM:
+			egpfwActivateProgram(cmd.program);
+			break;
+		case RENDER_COMMAND_FBO:
+			egpfwActivateFBO(cmd.fbo);
+			break;
+		case RENDER_COMMAND_VAO:
+			egpfwActivateVAO(cmd.vao);
+			break;
+		case RENDER_COMMAND_COLOR_TARGET:
+			egpfwBindColorTargetTexture(cmd.target.fbo, cmd.target.glBinding, cmd.target.targetIndex);
+			break;
+		case RENDER_COMMAND_DEPTH_TARGET:
+			egpfwBindDepthTargetTexture(cmd.target.fbo, cmd.target.glBinding);
+			break;
+		case RENDER_COMMAND_TABLE_READ:
+			break;
+		case RENDER_COMMAND_UNIFORM_BLOCK:
+			egpfwBindUBORange(cmd.uniformBlock.ubo, cmd.uniformBlock.binding, cmd.uniformBlock.offset, cmd.uniformBlock.size);
+			break;
+		case RENDER_COMMAND_UNIFORM_INT:
+			egpfwSendUniformInt(cmd.uniformInt.location, cmd.uniformInt.type, cmd.uniformInt.count, cmd.uniformInt.values);
+			break;
+		case RENDER_COMMAND_UNIFORM_FLOAT:
+			egpfwSendUniformFloat(cmd.uniformFloat.location, cmd.uniformFloat.type, cmd.uniformFloat.count, cmd.uniformFloat.values);
+			break;
+		case RENDER_COMMAND_UNIFORM_FLOAT_GATHER:
+		{
+			float* dst = gatherScratch + cmd.uniformGather.first;
+			const float* const* src = gatherSources + cmd.uniformGather.first;
+			for (unsigned int i = 0; i < cmd.uniformGather.numValues; ++i)
+				dst[i] = *src[i];
+			egpfwSendUniformFloat(cmd.uniformGather.location, cmd.uniformGather.type, cmd.uniformGather.count, dst);
+			break;
+		}
+		case RENDER_COMMAND_UNIFORM_MATRIX:
+			egpfwSendUniformFloatMatrix(cmd.uniformMatrix.location, UNIF_MAT4, cmd.uniformMatrix.count, cmd.uniformMatrix.transpose, cmd.uniformMatrix.values);
+			break;
+		case RENDER_COMMAND_TEXTURE:
+			egpfwStateBindTexture(cmd.texture.unit, cmd.texture.target, cmd.texture.handle);
+			break;
+		case RENDER_COMMAND_DRAW:
+			egpfwDrawActiveVAO();
+			break;
+		case RENDER_COMMAND_MULTI_DRAW:
+			egpfwDrawMeshPoolIndirect(cmd.multiDraw.pool, cmd.multiDraw.page, cmd.multiDraw.indirect, cmd.multiDraw.first, cmd.multiDraw.count);
+			break;
+		case RENDER_COMMAND_QUEUE:
+			cmd.queue->execute();
+			break;
+	}
+}
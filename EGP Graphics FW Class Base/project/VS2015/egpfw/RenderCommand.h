@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include "egpfw/egpfw/egpfwFrameBuffer.h"
+#include "egpfw/egpfw/egpfwVertexBuffer.h"
+#include "egpfw/egpfw/egpfwShaderProgram.h"
+
+class RenderQueue;
+
+/**
+ * \brief What a RenderCommand does when it is replayed. */
+enum RenderCommandType
+{
+	RENDER_COMMAND_PASS_BEGIN,
+	RENDER_COMMAND_PROGRAM,
+	RENDER_COMMAND_FBO,
+	RENDER_COMMAND_VAO,
+	RENDER_COMMAND_COLOR_TARGET,
+	RENDER_COMMAND_DEPTH_TARGET,
+	RENDER_COMMAND_TABLE_READ,
+	RENDER_COMMAND_UNIFORM_BLOCK,
+	RENDER_COMMAND_UNIFORM_INT,
+	RENDER_COMMAND_UNIFORM_FLOAT,
+	RENDER_COMMAND_UNIFORM_FLOAT_GATHER,
+	RENDER_COMMAND_UNIFORM_MATRIX,
+	RENDER_COMMAND_TEXTURE,
+	RENDER_COMMAND_DRAW,
+	RENDER_COMMAND_MULTI_DRAW,
+	RENDER_COMMAND_QUEUE,
+};
+
+/**
+ * \brief One step of a baked RenderPath. Plain data only, so a whole path fits in one contiguous array.
+ * Everything is stored by address, not by value: the command reads whatever the pointed-to object holds when it runs,
+ * exactly like the RenderPass it came from. */
+struct RenderCommand
+{
+	RenderCommandType type;
+
+	union
+	{
+		/** \brief Index of the pass in its path. Does nothing by itself; marks where the pass starts for timing. */
+		unsigned int passIndex;
+		const egpProgram* program;
+		const egpFrameBufferObjectDescriptor* fbo;
+		const egpVertexArrayObjectDescriptor* vao;
+		/** \brief Runs the queue's commands as they are when replayed, so it can be sorted again without baking. */
+		const RenderQueue* queue;
+
+		/** \brief Table reads only use fbo: the texture comes from the texture table, nothing is bound. */
+		struct
+		{
+			const egpFrameBufferObjectDescriptor* fbo;
+			unsigned int glBinding;
+			unsigned int targetIndex;
+		} target;
+
+		struct
+		{
+			unsigned int binding;
+			const egpUniformBufferObjectDescriptor* ubo;
+			unsigned int offset;
+			unsigned int size;
+		} uniformBlock;
+
+		struct
+		{
+			int location;
+			egpUniformIntType type;
+			unsigned int count;
+			const int* values;
+		} uniformInt;
+
+		struct
+		{
+			int location;
+			egpUniformFloatType type;
+			unsigned int count;
+			const float* values;
+		} uniformFloat;
+
+		/** \brief Values are read from the path's gather sources [first, first + numValues) into the same range of its scratch buffer. */
+		struct
+		{
+			int location;
+			egpUniformFloatType type;
+			unsigned int count;
+			unsigned int first, numValues;
+		} uniformGather;
+
+		struct
+		{
+			int location;
+			unsigned int count;
+			int transpose;
+			const float* values;
+		} uniformMatrix;
+
+		/** \brief Unit is an index, not GL_TEXTURE0 + index. */
+		struct
+		{
+			unsigned int unit;
+			unsigned int target;
+			unsigned int handle;
+		} texture;
+
+		/** \brief Commands [first, first + count) of the indirect buffer, all drawing from one page of the pool. */
+		struct
+		{
+			const egpMeshPoolDescriptor* pool;
+			const egpIndirectBufferDescriptor* indirect;
+			unsigned int page;
+			unsigned int first, count;
+		} multiDraw;
+	};
+};
+
+/**
+ * \brief Perform one command.
+ * \param gatherSources Array that gather commands' first/numValues index into.
+ * \param gatherScratch Space for gathered values, at least as long as gatherSources. */
+void executeRenderCommand(const RenderCommand& cmd, const float* const* gatherSources, float* gatherScratch);
+
+/**
+ * \brief Commands recorded by one thread, with the gather sources its commands index into.
+ * Kept between recordings so the vectors hold on to their capacity: after the first few frames re-recording allocates nothing. */
+struct RenderCommandBuffer
+{
+	std::vector<RenderCommand> commands;
+	std::vector<const float*> gatherSources;
+	std::vector<float> gatherScratch;
+};
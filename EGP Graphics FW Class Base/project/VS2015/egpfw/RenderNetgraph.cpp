@@ -1,4 +1,5 @@
 ﻿#include "RenderNetgraph.h"
+#include <math.h>
 
 void RenderNetgraph::generateMVPs()
 {
@@ -44,7 +45,7 @@ void RenderNetgraph::setupRenderPasses()
 		p.addUniform(render_pass_uniform_float_matrix(mTextureProgramUniforms[unif_mvp], 1, 0, &mQuadMVPs[i]));
 
 		//Add it to our internal render path.
-		mInternalRenderPath.addRenderPass(p);
+		mInternalRenderPath.addRenderPass(std::move(p));
 	}
 }
 
@@ -54,6 +55,10 @@ RenderNetgraph::RenderNetgraph(egpFrameBufferObjectDescriptor* fboArray, egpVert
 	mQuadModel = quad;
 	mProgramArray = programs;
 	mTextureProgramUniforms = textureProgramUniforms;
+
+	mTimedPath = nullptr;
+	mSolidColorProgramUniforms = nullptr;
+	mFrameBudgetMs = 16.6f;
 }
 
 void RenderNetgraph::clearFBOList()
@@ -93,4 +98,60 @@ void RenderNetgraph::render()
 {
 	//Ready to render? Just call our internal render path.
 	mInternalRenderPath.render();
+	renderTimings();
+}
+
+void RenderNetgraph::showTimings(const RenderPath* path, int* solidColorProgramUniforms, float frameBudgetMs)
+{
+	mTimedPath = path;
+	mSolidColorProgramUniforms = solidColorProgramUniforms;
+	mFrameBudgetMs = frameBudgetMs;
+}
+
+void RenderNetgraph::drawBar(float left, float top, float width, float height, const cbmath::vec4& color) const
+{
+	//The quad spans -1 to 1, so scale by half the size and move its center into place.
+	const cbmath::mat4 mvp = cbmath::makeTranslation4(left + width * 0.5f, top - height * 0.5f, 0.0f) * cbmath::makeScale4(width * 0.5f, height * 0.5f, 1.0f);
+
+	egpfwSendUniformFloatMatrix(mSolidColorProgramUniforms[unif_mvp], UNIF_MAT4, 1, 0, mvp.m);
+	egpfwSendUniformFloat(mSolidColorProgramUniforms[unif_color], UNIF_VEC4, 1, color.v);
+	egpfwDrawActiveVAO();
+}
+
+void RenderNetgraph::renderTimings() const
+{
+	if (!mTimedPath || !mSolidColorProgramUniforms)
+		return;
+
+	const std::vector<PassTiming>& timings = mTimedPath->getPassTimings();
+	if (timings.empty())
+		return;
+
+	//Some more magic numbers: a column down the left side, with the frame budget half a screen wide.
+	const float LEFT = -0.95f, TOP = 0.95f, BUDGET_WIDTH = 1.0f;
+	const float ROW = 1.5f / (timings.size() + 1), BAR = ROW * 0.4f;
+	const float toWidth = BUDGET_WIDTH / mFrameBudgetMs;
+
+	const cbmath::vec4 backgroundColor(0.2f, 0.2f, 0.2f, 1.0f), gpuColor(1.0f, 0.5f, 0.0f, 1.0f), cpuColor(0.2f, 0.6f, 1.0f, 1.0f);
+	const cbmath::vec4 overColor(1.0f, 0.1f, 0.1f, 1.0f);
+
+	egpfwActivateProgram(mProgramArray + testSolidColorProgramIndex);
+	egpfwActivateVAO(mQuadModel);
+
+	float gpuTotal = 0.0f, cpuTotal = 0.0f, top = TOP;
+	for (auto& timing : timings)
+	{
+		drawBar(LEFT, top, BUDGET_WIDTH, BAR * 2.0f, backgroundColor);
+		drawBar(LEFT, top, fminf(timing.gpuMs * toWidth, BUDGET_WIDTH), BAR, gpuColor);
+		drawBar(LEFT, top - BAR, fminf(timing.cpuMs * toWidth, BUDGET_WIDTH), BAR, cpuColor);
+
+		gpuTotal += timing.gpuMs;
+		cpuTotal += timing.cpuMs;
+		top -= ROW;
+	}
+
+	//Totals get their own row, in red once the whole path no longer fits in the budget.
+	drawBar(LEFT, top, BUDGET_WIDTH, BAR * 2.0f, backgroundColor);
+	drawBar(LEFT, top, fminf(gpuTotal * toWidth, BUDGET_WIDTH), BAR, gpuTotal > mFrameBudgetMs ? overColor : gpuColor);
+	drawBar(LEFT, top - BAR, fminf(cpuTotal * toWidth, BUDGET_WIDTH), BAR, cpuTotal > mFrameBudgetMs ? overColor : cpuColor);
 }
@@ -18,6 +18,13 @@ class RenderNetgraph
 		std::vector<FBOTargetColorTexture> mFBOsToDraw;
 		std::vector<cbmath::mat4> mQuadMVPs;
 
+		//Timing bars, drawn only while a path is attached.
+		const RenderPath* mTimedPath;
+		int* mSolidColorProgramUniforms;
+		float mFrameBudgetMs;
+
+		void drawBar(float left, float top, float width, float height, const cbmath::vec4& color) const;
+
 
 		/**
 		 * \brief Using the current list of FBO targets, creates an array of matrices to be used for their transformation. */
@@ -35,6 +42,17 @@ class RenderNetgraph
 		void addFBOs(std::initializer_list<FBOTargetColorTexture> fbos);
 		
 		FBOTargetColorTexture getFBOAtIndex(unsigned i);
+		unsigned int getFBOCount() const { return (unsigned int)mFBOsToDraw.size(); }
 
 		void render();
+
+		/**
+		 * \brief Draw a bar per pass of path (GPU time above, CPU time below) next to the thumbnails, plus the total.
+		 * Bars are scaled so frameBudgetMs fills the background bar; the total turns red when it goes over.
+		 * \param path Path whose timings to show (it must be profiling), or nullptr to stop showing them.
+		 * \param solidColorProgramUniforms Uniform locations of the solid color program (mvp and color). */
+		void showTimings(const RenderPath* path, int* solidColorProgramUniforms, float frameBudgetMs);
+		/**
+		 * \brief Draw only the timing bars. render() draws them too. */
+		void renderTimings() const;
 };
@@ -1,5 +1,4 @@
 #include "RenderPass.h"
-#include <stdexcept>
 
 RenderPass::RenderPass(egpFrameBufferObjectDescriptor* fbos, egpProgram* programs)
 {
@@ -11,31 +10,128 @@ RenderPass::RenderPass(egpFrameBufferObjectDescriptor* fbos, egpProgram* program
 	mProgram = GLSLProgramCount;
 	mPipelineStage = fboCount;
 	mAssociatedVAO = nullptr;
+	mQueue = nullptr;
+	mName = nullptr;
+}
+
+RenderPass RenderPass::clone() const
+{
+	RenderPass copy(mFBOArray, mProgramArray);
+	copy.mProgram = mProgram;
+	copy.mPipelineStage = mPipelineStage;
+	copy.mAssociatedVAO = mAssociatedVAO;
+	copy.mQueue = mQueue;
+	copy.mName = mName;
+	copy.mCommands.copyFrom(mCommands);
+	copy.mGatherSources.copyFrom(mGatherSources);
+	return copy;
+}
+
+void RenderPass::addCommand(const RenderCommand& cmd)
+{
+	//Insert after everything of the same or an earlier type, so data goes out grouped by type in the order it was added.
+	unsigned int i = mCommands.size();
+	while (i > 0 && mCommands[i - 1].type > cmd.type)
+		--i;
+	mCommands.insert(i, cmd);
 }
 
 void RenderPass::addUniform(const render_pass_uniform_int& i)
 {
-	mIntUniforms.push_back(i);
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_UNIFORM_INT;
+	cmd.uniformInt.location = i.location;
+	cmd.uniformInt.type = i.type;
+	cmd.uniformInt.count = i.count;
+	cmd.uniformInt.values = i.values;
+	addCommand(cmd);
 }
 
 void RenderPass::addUniform(const render_pass_uniform_float& f)
 {
-	mFloatUniforms.push_back(f);
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_UNIFORM_FLOAT;
+	cmd.uniformFloat.location = f.location;
+	cmd.uniformFloat.type = f.type;
+	cmd.uniformFloat.count = f.count;
+	cmd.uniformFloat.values = f.values;
+	addCommand(cmd);
 }
 
 void RenderPass::addUniform(const render_pass_uniform_float_complex& f)
 {
-	mComplexFloatUniforms.push_back(f);
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_UNIFORM_FLOAT_GATHER;
+	cmd.uniformGather.location = f.location;
+	cmd.uniformGather.type = f.type;
+	cmd.uniformGather.count = f.count;
+	cmd.uniformGather.first = mGatherSources.size();
+	cmd.uniformGather.numValues = f.numValues;
+	for (unsigned int i = 0; i < f.numValues; ++i)
+		mGatherSources.push_back(f.values[i]);
+	addCommand(cmd);
 }
 
 void RenderPass::addUniform(const render_pass_uniform_float_matrix& fm)
 {
-	mFloatMatrixUniforms.push_back(fm);
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_UNIFORM_MATRIX;
+	cmd.uniformMatrix.location = fm.location;
+	cmd.uniformMatrix.count = fm.count;
+	cmd.uniformMatrix.transpose = fm.transpose;
+	cmd.uniformMatrix.values = fm.value->m;
+	addCommand(cmd);
+}
+
+void RenderPass::addUniformBlock(const RenderPassUniformBlockData& b)
+{
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_UNIFORM_BLOCK;
+	cmd.uniformBlock.binding = b.binding;
+	cmd.uniformBlock.ubo = b.ubo;
+	cmd.uniformBlock.offset = b.offset;
+	cmd.uniformBlock.size = b.size;
+	addCommand(cmd);
+}
+
+void RenderPass::addColorTarget(const FBOTargetColorTexture& ct)
+{
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_COLOR_TARGET;
+	cmd.target.fbo = mFBOArray + ct.fboIndex;
+	cmd.target.glBinding = ct.glBinding;
+	cmd.target.targetIndex = ct.targetIndex;
+	addCommand(cmd);
+}
+
+void RenderPass::addDepthTarget(const FBOTargetDepthTexture& dt)
+{
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_DEPTH_TARGET;
+	cmd.target.fbo = mFBOArray + dt.fboIndex;
+	cmd.target.glBinding = dt.glBinding;
+	cmd.target.targetIndex = 0;
+	addCommand(cmd);
+}
+
+void RenderPass::addTableRead(FBOIndex i)
+{
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_TABLE_READ;
+	cmd.target.fbo = mFBOArray + i;
+	cmd.target.glBinding = 0;
+	cmd.target.targetIndex = 0;
+	addCommand(cmd);
 }
 
 void RenderPass::addTexture(const RenderPassTextureData& t)
 {
-	mTextures.push_back(t);
+	RenderCommand cmd;
+	cmd.type = RENDER_COMMAND_TEXTURE;
+	cmd.texture.unit = t.textureLane - GL_TEXTURE0;
+	cmd.texture.target = t.textureType;
+	cmd.texture.handle = t.textureHandle;
+	addCommand(cmd);
 }
 
 void RenderPass::setVAO(egpVertexArrayObjectDescriptor* vao)
@@ -55,30 +151,20 @@ void RenderPass::setPipelineStage(FBOIndex i)
 
 void RenderPass::sendData() const
 {
-	//Loop through all of our data and send it to OpenGL using the appropriate EGP helper functions.
-
-	for (auto target : mColorTargets)
-		egpfwBindColorTargetTexture(mFBOArray + target.fboIndex, target.glBinding, target.targetIndex);
-
-	for (auto target : mDepthTargets)
-		egpfwBindDepthTargetTexture(mFBOArray + target.fboIndex, target.glBinding);
-
-	for (auto data : mIntUniforms)
-		egpSendUniformInt(data.location, data.type, data.count, data.values);
-	
-	for (auto data : mFloatUniforms)
-		egpSendUniformFloat(data.location, data.type, data.count, data.values);
-
-	for (auto data : mComplexFloatUniforms)
-		egpSendUniformFloat(data.location, data.type, data.count, fetchVals(data.values).data());
-
-	for (auto data : mFloatMatrixUniforms)
-		egpSendUniformFloatMatrix(data.location, UNIF_MAT4, data.count, data.transpose, data.value->m);
+	//Our data is stored as commands already; run them, gathering complex uniforms into space on the stack.
+	float gatherScratch[render_pass_uniform_float_complex::maxValues];
 
-	for (auto data : mTextures)
+	for (auto& cmd : mCommands)
 	{
-		glActiveTexture(data.textureLane);
-		glBindTexture(data.textureType, data.textureHandle);
+		if (cmd.type != RENDER_COMMAND_UNIFORM_FLOAT_GATHER)
+		{
+			executeRenderCommand(cmd, nullptr, nullptr);
+			continue;
+		}
+
+		RenderCommand gather = cmd;
+		gather.uniformGather.first = 0;
+		executeRenderCommand(gather, mGatherSources.data() + cmd.uniformGather.first, gatherScratch);
 	}
 }
 
@@ -86,7 +172,7 @@ void RenderPass::activate() const
 {
 	//Activate our program (if we have one)
 	if (mProgram != GLSLProgramCount)
-		egpActivateProgram(mProgramArray + mProgram);
+		egpfwActivateProgram(mProgramArray + mProgram);
 
 	//Activate our target FBO (if we have one)
 	if (mPipelineStage != fboCount)
@@ -94,5 +180,54 @@ void RenderPass::activate() const
 
 	//Activate our target VAO (if we have one)
 	if (mAssociatedVAO != nullptr)
-		egpActivateVAO(mAssociatedVAO);
+		egpfwActivateVAO(mAssociatedVAO);
+}
+
+void RenderPass::bake(std::vector<RenderCommand>& commands, std::vector<const float*>& gatherSources) const
+{
+	RenderCommand cmd;
+
+	if (mProgram != GLSLProgramCount)
+	{
+		cmd.type = RENDER_COMMAND_PROGRAM;
+		cmd.program = mProgramArray + mProgram;
+		commands.push_back(cmd);
+	}
+
+	if (mPipelineStage != fboCount)
+	{
+		cmd.type = RENDER_COMMAND_FBO;
+		cmd.fbo = mFBOArray + mPipelineStage;
+		commands.push_back(cmd);
+	}
+
+	if (mAssociatedVAO != nullptr)
+	{
+		cmd.type = RENDER_COMMAND_VAO;
+		cmd.vao = mAssociatedVAO;
+		commands.push_back(cmd);
+	}
+
+	//The rest is already baked; gather commands just move to where our sources land in the shared array.
+	const unsigned int gatherBase = (unsigned int)gatherSources.size();
+	gatherSources.insert(gatherSources.end(), mGatherSources.begin(), mGatherSources.end());
+
+	for (auto& data : mCommands)
+	{
+		if (data.type == RENDER_COMMAND_TABLE_READ)
+			continue;
+
+		commands.push_back(data);
+		if (data.type == RENDER_COMMAND_UNIFORM_FLOAT_GATHER)
+			commands.back().uniformGather.first += gatherBase;
+	}
+
+	if (mQueue)
+	{
+		cmd.type = RENDER_COMMAND_QUEUE;
+		cmd.queue = mQueue;
+	}
+	else
+		cmd.type = RENDER_COMMAND_DRAW;
+	commands.push_back(cmd);
 }
@@ -1,9 +1,20 @@
 #pragma once
 #include "render_enums.h"
 #include "egpfw/egpfw/egpfwFrameBuffer.h"
-#include <egpfw/egpfw/utils/egpfwVertexBufferUtils.h>
+#include "egpfw/egpfw/egpfwVertexBuffer.h"
+#include "egpfw/egpfw/egpfwShaderProgram.h"
+#include "egpfw/egpfw/egpfwStateCache.h"
 #include "RenderPassData.h"
+#include "RenderCommand.h"
+#include "SmallBuffer.h"
 
+/**
+ * \brief Index of a pass in the RenderPath or FrameGraph that owns it. */
+typedef unsigned int RenderPassHandle;
+
+/**
+ * \brief Everything needed to draw one thing: program, target FBO, VAO, textures and uniforms.
+ * Move-only: passes are handed to a RenderPath or FrameGraph with std::move, and clone() makes the rare real copy. */
 class RenderPass
 {
 	public:
@@ -13,20 +24,17 @@ class RenderPass
 		int mPipelineStage;
 		egpFrameBufferObjectDescriptor* mFBOArray;
 		egpProgram* mProgramArray;
-
-		std::vector<render_pass_uniform_int> mIntUniforms;
-		std::vector<render_pass_uniform_float> mFloatUniforms;
-		std::vector<render_pass_uniform_float_complex> mComplexFloatUniforms;
-		std::vector<render_pass_uniform_float_matrix> mFloatMatrixUniforms;
-
-		std::vector<FBOTargetColorTexture> mColorTargets;
-		std::vector<FBOTargetDepthTexture> mDepthTargets;
-
-		std::vector<RenderPassTextureData> mTextures;
 		egpVertexArrayObjectDescriptor* mAssociatedVAO;
+		const RenderQueue* mQueue;
+		const char* mName;
+
+		//Everything else the pass sets, already in the form it is baked to. Kept sorted by type (stable), which is the
+		//order it is sent in. Inline storage covers the passes this project builds without touching the heap.
+		SmallBuffer<RenderCommand, 12> mCommands;
+		//Addresses that complex uniforms gather from; their commands index into this.
+		SmallBuffer<const float*, 8> mGatherSources;
 
-		template <typename T>
-		static std::vector<T> fetchVals(std::vector<T*>& refs);
+		void addCommand(const RenderCommand& cmd);
 
 	public:
 		/**
@@ -34,8 +42,15 @@ class RenderPass
 		* \param fbos Pointer to the global FBO array.
 		* \param programs Pointer to the global GLSLProgram array. */
 		RenderPass(egpFrameBufferObjectDescriptor* fbos, egpProgram* programs);
+		RenderPass(RenderPass&& other) = default;
+		RenderPass(const RenderPass&) = delete;
 		~RenderPass() = default;
 
+		RenderPass& operator=(RenderPass&& other) = default;
+		RenderPass& operator=(const RenderPass&) = delete;
+
+		RenderPass clone() const;
+
 		/**
 		 * \brief Set the VAO that this RenderPass should activate.
 		 * \param vao Pointer to the appropriate VAO. If set to nullptr, the RenderPass will use whatever VAO was last active. */
@@ -48,34 +63,57 @@ class RenderPass
 		* \brief Set the FBO that this RenderPass should use.
 		* \param i Index of the FBO to use. If set to fboCount, the RenderPass will use whatever FBO was last active. */
 		void setPipelineStage(FBOIndex i);
+		/**
+		 * \brief Label used when printing and drawing timings. Not copied, so pass a string literal. */
+		void setName(const char* name) { mName = name; }
+		/**
+		 * \brief Run a queue's draws instead of drawing the VAO. The queue is read when the pass runs; it must outlive the
+		 * pass and every path the pass is copied into. Null goes back to drawing the VAO. */
+		void setQueue(const RenderQueue* queue) { mQueue = queue; }
 
 		void addUniform(const render_pass_uniform_int& i);
 		void addUniform(const render_pass_uniform_float& f);
 		void addUniform(const render_pass_uniform_float_complex& f);
 		void addUniform(const render_pass_uniform_float_matrix& fm);
+		/**
+		 * \brief Bind a uniform buffer range when this pass runs. Blocks are bound before any single uniforms are sent. */
+		void addUniformBlock(const RenderPassUniformBlockData& b);
 
-		void addColorTarget(const FBOTargetColorTexture& ct) { mColorTargets.push_back(ct); }
-		void addDepthTarget(const FBOTargetDepthTexture& dt) { mDepthTargets.push_back(dt); }
+		void addColorTarget(const FBOTargetColorTexture& ct);
+		void addDepthTarget(const FBOTargetDepthTexture& dt);
+		/**
+		 * \brief Note that this pass reads an FBO's targets through the texture table. Binds nothing; it only tells the
+		 * FrameGraph the pass depends on whoever draws to that FBO. The shader picks the slot with an index uniform. */
+		void addTableRead(FBOIndex i);
 		void addTexture(const RenderPassTextureData& t);
 
+		egpVertexArrayObjectDescriptor* getVAO() const { return mAssociatedVAO; }
+		int getProgram() const { return mProgram; }
+		int getPipelineStage() const { return mPipelineStage; }
+		const RenderQueue* getQueue() const { return mQueue; }
+		const char* getName() const { return mName; }
+		/**
+		 * \brief Call f(fboIndex) for every color and depth target this pass reads, bound or through the texture table. */
+		template <typename F>
+		void forEachTargetFBO(F f) const;
+
 		/**
 		 * \brief Prepare to render by sending all of this RenderPass's data to OpenGL using the egp helper functions. */
 		void sendData() const;
 		/**
 		 * \brief Prepare to render by activating our GLSL Program, FBO, and VAO. */
 		void activate() const;
+		/**
+		 * \brief Append the commands that activate(), sendData() and a draw would perform, in the same order.
+		 * \param commands Command stream to append to.
+		 * \param gatherSources Addresses that complex uniforms pull from; gather commands index into this array. */
+		void bake(std::vector<RenderCommand>& commands, std::vector<const float*>& gatherSources) const;
 };
 
-/**
- * \brief Used with complex pass data. Fetches simple data at arbitrary memory addresses and builds them into one final buffer. */
-template <typename T>
-inline std::vector<T> RenderPass::fetchVals(std::vector<T*>& refs)
+template <typename F>
+inline void RenderPass::forEachTargetFBO(F f) const
 {
-	std::vector<T> result;
-	result.reserve(refs.size());
-
-	for (auto iter : refs)
-		result.push_back(*iter);
-
-	return result;
+	for (auto& cmd : mCommands)
+		if (cmd.type == RENDER_COMMAND_COLOR_TARGET || cmd.type == RENDER_COMMAND_DEPTH_TARGET || cmd.type == RENDER_COMMAND_TABLE_READ)
+			f((int)(cmd.target.fbo - mFBOArray));
 }
@@ -1,6 +1,7 @@
 ﻿#pragma once
-#include <vector>
-#include "egpfw/egpfw/utils/egpfwShaderProgramUtils.h"
+#include <initializer_list>
+#include <stdexcept>
+#include "egpfw/egpfw/egpfwShaderProgram.h"
 #include <GL/glew.h>
 #include <cbmath/cbtkMatrix.h>
 
@@ -26,22 +27,33 @@ struct UniformDataSimple
 
 /**
  * \brief Template struct used for sending data that is not contiguous in memory.
+ * Addresses are stored in place, so there is room for one mat4 worth of values at most.
  * \tparam E Our type enum (i.e. egpIntType, egpFloatType, etc.)
  * \tparam T Our actual data storage type (i.e. int, float, etc.) */
 template <typename E, typename T>
 struct UniformDataComplex
 {
+	static const unsigned int maxValues = 16;
+
 	int location;
 	E type;
 	unsigned int count;
-	std::vector<T*> values;
+	unsigned int numValues;
+	T* values[maxValues];
 
 	/**
 	 * \param l Location
 	 * \param t Type
 	 * \param c Count
 	 * \param v std::initializer_list of addresses where the data will be pulled and combined from. */
-	UniformDataComplex(int l, E t, unsigned int c, std::initializer_list<T*> v) : location(l), type(t), count(c), values(v) {}
+	UniformDataComplex(int l, E t, unsigned int c, std::initializer_list<T*> v) : location(l), type(t), count(c), numValues(0)
+	{
+		if (v.size() > maxValues)
+			throw std::out_of_range("Too many values for a complex uniform!");
+
+		for (auto iter = v.begin(); iter != v.end(); ++iter)
+			values[numValues++] = *iter;
+	}
 };
 
 /**
@@ -104,6 +116,23 @@ struct RenderPassTextureData
 	RenderPassTextureData(GLenum type, GLuint lane, GLuint handle) : textureType(type), textureLane(lane), textureHandle(handle) {}
 };
 
+/**
+ * \brief Struct used for binding a range of a uniform buffer to a block binding point. */
+struct RenderPassUniformBlockData
+{
+	unsigned int binding;
+	const egpUniformBufferObjectDescriptor* ubo;
+	unsigned int offset;
+	unsigned int size;
+
+	/**
+	 * \param b Binding point the program's block is connected to.
+	 * \param u Address of the UBO (read when the pass runs, so it can be recreated).
+	 * \param o Offset of the range; must be a multiple of egpfwGetUBOOffsetAlignment().
+	 * \param s Size of the range. */
+	RenderPassUniformBlockData(unsigned int b, const egpUniformBufferObjectDescriptor* u, unsigned int o, unsigned int s) : binding(b), ubo(u), offset(o), size(s) {}
+};
+
 //Some typedefs to make everything look cleaner.
 typedef UniformDataSimple<egpUniformIntType, int> render_pass_uniform_int;
 typedef UniformDataSimple<egpUniformFloatType, float> render_pass_uniform_float;
@@ -1,43 +1,142 @@
 ﻿#include "RenderPath.h"
 #include "egpfw/egpfw.h"
+#include <stdio.h>
+
+//Fewer passes than this per buffer aren't worth waking a worker for.
+static const unsigned int minPassesPerBuffer = 16;
 
 RenderPath::RenderPath()
 {
+	mDirty = true;
+	mJobs = nullptr;
+	mProfiling = false;
 }
 
 RenderPath::~RenderPath()
 {
 }
 
-void RenderPath::addRenderPass(const RenderPass& pass)
-{
-	mPasses.push_back(pass);
-}
-
-void RenderPath::addRenderPass(RenderPass&& pass)
+RenderPassHandle RenderPath::addRenderPass(RenderPass&& pass)
 {
 	mPasses.push_back(std::move(pass));
+	mDirty = true;
+	return (RenderPassHandle)mPasses.size() - 1;
 }
 
-void RenderPath::addRenderPasses(std::initializer_list<RenderPass> passes)
+RenderPass& RenderPath::getRenderPass(RenderPassHandle handle)
 {
-	for (auto iter = passes.begin(); iter != passes.end(); ++iter)
-		mPasses.push_back(*iter);
+	mDirty = true;
+	return mPasses[handle];
 }
 
 void RenderPath::clearAllPasses()
 {
 	mPasses.clear();
+	mDirty = true;
+}
+
+void RenderPath::bake()
+{
+	//Split the passes into contiguous runs, one buffer each, so replaying the buffers in order replays the passes in order.
+	const unsigned int numPasses = (unsigned int)mPasses.size();
+	unsigned int numBuffers = (numPasses + minPassesPerBuffer - 1) / minPassesPerBuffer;
+	if (!mJobs || numBuffers < 1)
+		numBuffers = 1;
+	else if (numBuffers > mJobs->getNumThreads())
+		numBuffers = mJobs->getNumThreads();
+	mBuffers.resize(numBuffers);
+
+	//Passes only read their own data while baking, and each job writes only its own buffer.
+	auto record = [this, numPasses, numBuffers](unsigned int b)
+	{
+		RenderCommandBuffer& buffer = mBuffers[b];
+		buffer.commands.clear();
+		buffer.gatherSources.clear();
+
+		RenderCommand marker;
+		marker.type = RENDER_COMMAND_PASS_BEGIN;
+
+		const unsigned int first = numPasses * b / numBuffers, last = numPasses * (b + 1) / numBuffers;
+		for (unsigned int i = first; i < last; ++i)
+		{
+			marker.passIndex = i;
+			buffer.commands.push_back(marker);
+			mPasses[i].bake(buffer.commands, buffer.gatherSources);
+		}
+
+		buffer.gatherScratch.resize(buffer.gatherSources.size());
+	};
+
+	if (numBuffers > 1)
+		mJobs->run(numBuffers, record);
+	else
+		record(0);
+
+	mDirty = false;
 }
 
 void RenderPath::render()
 {
-	//Activate and draw each of our passes.
+	if (mDirty)
+		bake();
+
+	if (mProfiling)
+	{
+		mTimer.resize((unsigned int)mPasses.size());
+		mTimer.beginFrame();
+	}
+
+	//Submit in pass order on this (the GL) thread.
+	for (auto& buffer : mBuffers)
+		replay(buffer);
+
+	if (mProfiling)
+		mTimer.endFrame();
+}
+
+void RenderPath::setProfiling(bool enabled)
+{
+	if (!enabled)
+		mTimer.release();
+	mProfiling = enabled;
+}
+
+void RenderPath::printTimings() const
+{
+	const std::vector<PassTiming>& timings = mTimer.getTimings();
+	float gpuTotal = 0.0f, cpuTotal = 0.0f;
+
+	printf("\n-------------------------------------------------------");
+	printf("\n PASS TIMINGS (ms): gpu / cpu \n");
+	for (unsigned int i = 0; i < timings.size(); ++i)
+	{
+		const char* name = mPasses[i].getName();
+		printf("\n %2u %-16s %7.3f / %.3f", i, name ? name : "", timings[i].gpuMs, timings[i].cpuMs);
+		gpuTotal += timings[i].gpuMs;
+		cpuTotal += timings[i].cpuMs;
+	}
+	printf("\n    %-16s %7.3f / %.3f", "total", gpuTotal, cpuTotal);
+	printf("\n-------------------------------------------------------");
+}
+
+void RenderPath::replay(RenderCommandBuffer& buffer)
+{
+	//Replay the baked passes. Nothing here allocates; complex uniforms are gathered into scratch space sized at bake time.
+	const float* const* gatherSources = buffer.gatherSources.data();
+	float* gatherScratch = buffer.gatherScratch.data();
+
+	if (!mProfiling)
+	{
+		for (auto& cmd : buffer.commands)
+			executeRenderCommand(cmd, gatherSources, gatherScratch);
+		return;
+	}
 
-	for (auto pass : mPasses)
+	for (auto& cmd : buffer.commands)
 	{
-		pass.activate();
-		pass.sendData();
-		egpDrawActiveVAO();
+		if (cmd.type == RENDER_COMMAND_PASS_BEGIN)
+			mTimer.beginPass(cmd.passIndex);
+		else
+			executeRenderCommand(cmd, gatherSources, gatherScratch);
 	}
 }
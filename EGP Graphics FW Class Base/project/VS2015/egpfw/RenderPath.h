@@ -1,22 +1,68 @@
 ﻿#pragma once
 #include <vector>
 #include "RenderPass.h"
+#include "JobSystem.h"
+#include "PassTimer.h"
 
 class RenderPath
 {
 	private:
 		std::vector<RenderPass> mPasses;
 
+		//Baked form of mPasses, rebuilt only when the passes change. Each buffer holds a contiguous run of passes.
+		std::vector<RenderCommandBuffer> mBuffers;
+		bool mDirty;
+
+		JobSystem* mJobs;
+
+		bool mProfiling;
+		PassTimer mTimer;
+
+		void bake();
+		void replay(RenderCommandBuffer& buffer);
+
 	public:
 		RenderPath();
 		~RenderPath();
 
-		void addRenderPass(const RenderPass& pass);
-		void addRenderPass(RenderPass&& pass);
-		void addRenderPasses(std::initializer_list<RenderPass> passes);
+		/**
+		 * \brief Take ownership of a pass. Passes are move-only, so hand them over with std::move.
+		 * \return Handle that stays valid until clearAllPasses(). */
+		RenderPassHandle addRenderPass(RenderPass&& pass);
+		template <typename... Passes>
+		void addRenderPasses(Passes&&... passes);
+		/**
+		 * \brief Edit a pass in place; the path is baked again before it next renders. */
+		RenderPass& getRenderPass(RenderPassHandle handle);
+		unsigned int getPassCount() const { return (unsigned int)mPasses.size(); }
+		/**
+		 * \brief Remove every pass. Storage is kept, so building the path again doesn't allocate. */
 		void clearAllPasses();
 
 		/**
-		 * \brief Activates and renders every pass in our collection. */
+		 * \brief Record passes on these threads when baking. Null (the default) records everything on the calling thread. */
+		void setJobSystem(JobSystem* jobs) { mJobs = jobs; }
+
+		/**
+		 * \brief Activates and renders every pass in our collection.
+		 * Replays the baked command stream, baking it first if passes were added or cleared since the last call. */
 		void render();
+
+		/**
+		 * \brief Time every pass on the GPU and CPU while rendering. Turning it off deletes the queries. */
+		void setProfiling(bool enabled);
+		bool isProfiling() const { return mProfiling; }
+		/**
+		 * \brief Smoothed timings, one per pass in path order; empty unless profiling. */
+		const std::vector<PassTiming>& getPassTimings() const { return mTimer.getTimings(); }
+		const char* getPassName(RenderPassHandle handle) const { return mPasses[handle].getName(); }
+		void printTimings() const;
 };
+
+template <typename... Passes>
+inline void RenderPath::addRenderPasses(Passes&&... passes)
+{
+	//Expands to one addRenderPass() per argument, in order. Only rvalues compile, since passes can't be copied.
+	int expand[] = { 0, ((void)addRenderPass(std::forward<Passes>(passes)), 0)... };
+	(void)expand;
+}
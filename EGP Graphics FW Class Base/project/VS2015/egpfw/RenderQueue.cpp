@@ -0,0 +1,302 @@
+#include "RenderQueue.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+//Fewer items than this per job aren't worth waking a worker for: an item costs about 80 ns to sort and record, and a
+//sort hands out up to 18 rounds of jobs at about 5 us each.
+static const unsigned int minItemsPerBatch = 2048;
+
+//Weight of the newest frame in the smoothed sort time.
+static const float smoothing = 0.1f;
+
+uint64_t RenderQueue::makeKey(unsigned int target, unsigned int program, unsigned int material, unsigned int vao, float depth)
+{
+	//Depth is clamped, so anything behind the far plane sorts last instead of wrapping around.
+	const float clamped = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+	const uint64_t depthBits = (uint64_t)(clamped * (float)0xFFFFFF);
+
+	return ((uint64_t)(target & 0x3F) << 58) | ((uint64_t)(program & 0x3F) << 52) | ((uint64_t)(material & 0xFFF) << 40) |
+		((uint64_t)(vao & 0xFFFF) << 24) | depthBits;
+}
+
+RenderQueue::RenderQueue(egpFrameBufferObjectDescriptor* fbos, egpProgram* programs)
+{
+	mFBOArray = fbos;
+	mProgramArray = programs;
+
+	//Material 0 binds nothing.
+	mMaterials.push_back(RenderQueueMaterial());
+
+	mIndirectBuffer = egpIndirectBufferDescriptor();
+	mJobs = nullptr;
+	mNumTargets = mNumPrograms = mNumMaterials = mNumVAOs = mNumBlocks = mNumDraws = mNumBatches = 0;
+	mSortMs = 0.0f;
+}
+
+unsigned int RenderQueue::addMaterial(const RenderQueueMaterial& material)
+{
+	mMaterials.push_back(material);
+	return (unsigned int)mMaterials.size() - 1;
+}
+
+void RenderQueue::submit(FBOIndex target, GLSLProgramIndex program, unsigned int material, const egpVertexArrayObjectDescriptor* vao, float depth, const RenderPassUniformBlockData& object)
+{
+	Item item = { makeKey(target, program, material, vao ? vao->glhandle : 0, depth), target, program, material, vao, object, nullptr, {}, 0 };
+	mItems.push_back(item);
+}
+
+void RenderQueue::submit(FBOIndex target, GLSLProgramIndex program, unsigned int material, const egpMeshPoolDescriptor* pool, const egpMeshPoolMesh& mesh, float depth, const RenderPassUniformBlockData& objects, unsigned int drawIndex)
+{
+	//The page's VAO goes in the key, so a page's meshes sort next to each other.
+	const egpVertexArrayObjectDescriptor* vao = &pool->page[mesh.page].vao;
+	Item item = { makeKey(target, program, material, vao->glhandle, depth), target, program, material, vao, objects, pool, mesh, drawIndex };
+	mItems.push_back(item);
+}
+
+void RenderQueue::sort()
+{
+	const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	const unsigned int numItems = (unsigned int)mItems.size();
+
+	//Contiguous runs of items, one per job, for every step, so replaying the runs in order gives the same commands as one
+	//thread would.
+	unsigned int numBatches = (numItems + minItemsPerBatch - 1) / minItemsPerBatch;
+	if (!mJobs || numBatches < 1)
+		numBatches = 1;
+	else if (numBatches > mJobs->getNumThreads())
+		numBatches = mJobs->getNumThreads();
+	if (mBatches.size() < numBatches)
+		mBatches.resize(numBatches);
+	mNumBatches = numBatches;
+
+	//Sorting moves (key, index) pairs around instead of whole items.
+	mOrder.resize(numItems);
+	runBatches([this, numItems, numBatches](unsigned int b)
+	{
+		for (unsigned int i = numItems * b / numBatches, last = numItems * (b + 1) / numBatches; i < last; ++i)
+		{
+			mOrder[i].key = mItems[i].key;
+			mOrder[i].item = i;
+		}
+	});
+
+	radixSort();
+
+	//Items only read the sorted order while recording, and each job writes only its own batch and its own draw commands.
+	mDrawCommands.resize(numItems);
+	runBatches([this, numItems, numBatches](unsigned int b)
+	{
+		record(numItems * b / numBatches, numItems * (b + 1) / numBatches, mBatches[b]);
+	});
+	joinBatches();
+
+	if (!mDrawCommands.empty())
+	{
+		if (!mIndirectBuffer.commands)
+			egpfwCreateIndirectBuffer(&mIndirectBuffer, (unsigned int)mDrawCommands.size());
+		egpfwUploadIndirectBuffer(&mIndirectBuffer, mDrawCommands.data(), (unsigned int)mDrawCommands.size());
+	}
+
+	const std::chrono::duration<float, std::milli> cpu = std::chrono::high_resolution_clock::now() - start;
+	mSortMs += (cpu.count() - mSortMs) * smoothing;
+}
+
+void RenderQueue::runBatches(const std::function<void(unsigned int)>& job)
+{
+	if (mNumBatches > 1)
+		mJobs->run(mNumBatches, job);
+	else
+		job(0);
+}
+
+void RenderQueue::radixSort()
+{
+	const unsigned int numEntries = (unsigned int)mOrder.size(), numBatches = mNumBatches;
+	mScratch.resize(numEntries);
+	mCounts.resize(numBatches * 256);
+
+	//Least significant byte first, stable at every step. A byte every key shares doesn't change the order, so it is
+	//skipped: with few programs and materials most of the high bytes are.
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		runBatches([this, shift, numEntries, numBatches](unsigned int b)
+		{
+			unsigned int* count = &mCounts[b * 256];
+			memset(count, 0, 256 * sizeof(unsigned int));
+			for (unsigned int i = numEntries * b / numBatches, last = numEntries * (b + 1) / numBatches; i < last; ++i)
+				++count[(mOrder[i].key >> shift) & 0xFF];
+		});
+
+		const unsigned int shared = (unsigned int)((mOrder.empty() ? 0 : mOrder[0].key >> shift) & 0xFF);
+		unsigned int numShared = 0;
+		for (unsigned int b = 0; b < numBatches; ++b)
+			numShared += mCounts[b * 256 + shared];
+		if (numShared == numEntries)
+			continue;
+
+		//Within a bucket, each batch's entries go after those of the batches before it, which keeps the step stable.
+		unsigned int offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; ++bucket)
+			for (unsigned int b = 0; b < numBatches; ++b)
+			{
+				unsigned int& c = mCounts[b * 256 + bucket];
+				const unsigned int n = c;
+				c = offset;
+				offset += n;
+			}
+
+		runBatches([this, shift, numEntries, numBatches](unsigned int b)
+		{
+			unsigned int* count = &mCounts[b * 256];
+			for (unsigned int i = numEntries * b / numBatches, last = numEntries * (b + 1) / numBatches; i < last; ++i)
+				mScratch[count[(mOrder[i].key >> shift) & 0xFF]++] = mOrder[i];
+		});
+		mOrder.swap(mScratch);
+	}
+}
+
+void RenderQueue::record(unsigned int first, unsigned int last, Batch& batch)
+{
+	//The first item diffs against the last one of the batch before, as if one thread had recorded both.
+	const Item* previous = first > 0 ? &mItems[mOrder[first - 1].item] : nullptr;
+	std::vector<RenderCommand>& commands = batch.buffer.commands;
+
+	commands.clear();
+	batch.numTargets = batch.numPrograms = batch.numMaterials = batch.numVAOs = batch.numBlocks = batch.numDraws = 0;
+
+	for (unsigned int i = first; i < last; ++i)
+	{
+		const Item& item = mItems[mOrder[i].item];
+		RenderCommand cmd;
+
+		//Everything is compared by value, not by key, so items that only share a key field still get their own state.
+		if (!previous || item.target != previous->target)
+		{
+			cmd.type = RENDER_COMMAND_FBO;
+			cmd.fbo = mFBOArray + item.target;
+			commands.push_back(cmd);
+			++batch.numTargets;
+		}
+
+		if (!previous || item.program != previous->program)
+		{
+			cmd.type = RENDER_COMMAND_PROGRAM;
+			cmd.program = mProgramArray + item.program;
+			commands.push_back(cmd);
+			++batch.numPrograms;
+		}
+
+		if (!previous || item.material != previous->material)
+		{
+			if (item.material < mMaterials.size())
+				for (auto& t : mMaterials[item.material].textures)
+				{
+					cmd.type = RENDER_COMMAND_TEXTURE;
+					cmd.texture.unit = t.textureLane - GL_TEXTURE0;
+					cmd.texture.target = t.textureType;
+					cmd.texture.handle = t.textureHandle;
+					commands.push_back(cmd);
+				}
+			++batch.numMaterials;
+		}
+
+		if (!previous || item.vao != previous->vao)
+		{
+			cmd.type = RENDER_COMMAND_VAO;
+			cmd.vao = item.vao;
+			commands.push_back(cmd);
+			++batch.numVAOs;
+		}
+
+		if (!previous || item.object.ubo != previous->object.ubo || item.object.binding != previous->object.binding ||
+			item.object.offset != previous->object.offset || item.object.size != previous->object.size)
+		{
+			cmd.type = RENDER_COMMAND_UNIFORM_BLOCK;
+			cmd.uniformBlock.binding = item.object.binding;
+			cmd.uniformBlock.ubo = item.object.ubo;
+			cmd.uniformBlock.offset = item.object.offset;
+			cmd.uniformBlock.size = item.object.size;
+			commands.push_back(cmd);
+			++batch.numBlocks;
+		}
+
+		if (item.pool)
+		{
+			//Nothing was recorded since the last multi-draw if it is still the last command, so this item can join it.
+			//A batch can start with nothing recorded; joinBatches() joins its first multi-draw to the batch before.
+			RenderCommand* end = commands.empty() ? nullptr : &commands.back();
+			if (!end || end->type != RENDER_COMMAND_MULTI_DRAW || end->multiDraw.pool != item.pool || end->multiDraw.page != item.mesh.page)
+			{
+				cmd.type = RENDER_COMMAND_MULTI_DRAW;
+				cmd.multiDraw.pool = item.pool;
+				cmd.multiDraw.indirect = &mIndirectBuffer;
+				cmd.multiDraw.page = item.mesh.page;
+				cmd.multiDraw.first = i;
+				cmd.multiDraw.count = 0;
+				commands.push_back(cmd);
+				end = &commands.back();
+				++batch.numDraws;
+			}
+			++end->multiDraw.count;
+			mDrawCommands[i] = egpfwMeshPoolCommand(&item.mesh, item.drawIndex);
+		}
+		else
+		{
+			cmd.type = RENDER_COMMAND_DRAW;
+			commands.push_back(cmd);
+			++batch.numDraws;
+			mDrawCommands[i] = egpDrawIndirectCommand();
+		}
+		previous = &item;
+	}
+}
+
+void RenderQueue::joinBatches()
+{
+	RenderCommand* end = nullptr;
+
+	mNumTargets = mNumPrograms = mNumMaterials = mNumVAOs = mNumBlocks = mNumDraws = 0;
+	for (unsigned int b = 0; b < mNumBatches; ++b)
+	{
+		Batch& batch = mBatches[b];
+		std::vector<RenderCommand>& commands = batch.buffer.commands;
+		mNumTargets += batch.numTargets;
+		mNumPrograms += batch.numPrograms;
+		mNumMaterials += batch.numMaterials;
+		mNumVAOs += batch.numVAOs;
+		mNumBlocks += batch.numBlocks;
+		mNumDraws += batch.numDraws;
+
+		//A batch that starts with a multi-draw on the page the batch before ended on changed no state in between, so one
+		//thread would have drawn both runs at once. Draw commands are by sorted position, so the runs are contiguous.
+		if (end && !commands.empty() && commands.front().type == RENDER_COMMAND_MULTI_DRAW && end->type == RENDER_COMMAND_MULTI_DRAW &&
+			commands.front().multiDraw.pool == end->multiDraw.pool && commands.front().multiDraw.page == end->multiDraw.page)
+		{
+			end->multiDraw.count += commands.front().multiDraw.count;
+			commands.erase(commands.begin());
+			--mNumDraws;
+		}
+
+		if (!commands.empty())
+			end = &commands.back();
+	}
+}
+
+void RenderQueue::execute() const
+{
+	for (unsigned int b = 0; b < mNumBatches; ++b)
+		for (auto& cmd : mBatches[b].buffer.commands)
+			executeRenderCommand(cmd, nullptr, nullptr);
+}
+
+void RenderQueue::printStats() const
+{
+	printf("\n Render queue: %u items in %u draw calls, %u target, %u program, %u material, %u VAO and %u uniform block changes; sorted in %.3f ms over %u jobs\n",
+		(unsigned int)mItems.size(), mNumDraws, mNumTargets, mNumPrograms, mNumMaterials, mNumVAOs, mNumBlocks, mSortMs, mNumBatches);
+}
+
+void RenderQueue::release()
+{
+	egpfwReleaseIndirectBuffer(&mIndirectBuffer);
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include "render_enums.h"
+#include "RenderPassData.h"
+#include "RenderCommand.h"
+#include "JobSystem.h"
+
+/**
+ * \brief Textures an item draws with. Items with the same material share the binds. */
+struct RenderQueueMaterial
+{
+	std::vector<RenderPassTextureData> textures;
+
+	RenderQueueMaterial() {}
+	/**
+	 * \param t Textures and the units they go to. */
+	RenderQueueMaterial(std::initializer_list<RenderPassTextureData> t) : textures(t) {}
+};
+
+/**
+ * \brief Draws sorted by state: target, program, material, VAO, then depth front to back.
+ * Items are submitted into the queue each frame (or whenever they change), sorted with a radix sort on a 64-bit key, and
+ * turned into a command list that only changes what differs from the item before. A RenderPass runs the whole queue in
+ * place of its draw (see RenderPass::setQueue), so the list can change every frame without baking the path again.
+ * Set the pass's pipeline stage to the target the items draw to, since that is what the FrameGraph sees.
+ * Items from a mesh pool don't get a draw each: a run of them from the same page with no state change in between becomes
+ * one multi-draw over the queue's indirect buffer, so a scene in one pool goes out in a call per page.
+ * With a JobSystem, sorting and recording are split into contiguous runs of items, one job each. */
+class RenderQueue
+{
+	public:
+		/**
+		 * \brief Key layout, most significant first: target (6 bits), program (6), material (12), VAO (16), depth (24).
+		 * Only the order of keys matters; the state itself comes from the item, so a clipped VAO name costs batching, not
+		 * correctness. */
+		static uint64_t makeKey(unsigned int target, unsigned int program, unsigned int material, unsigned int vao, float depth);
+
+	private:
+		struct Item
+		{
+			uint64_t key;
+			int target;
+			int program;
+			unsigned int material;
+			const egpVertexArrayObjectDescriptor* vao;
+			RenderPassUniformBlockData object;
+
+			//Pool items only.
+			const egpMeshPoolDescriptor* pool;
+			egpMeshPoolMesh mesh;
+			unsigned int drawIndex;
+		};
+
+		struct SortEntry
+		{
+			uint64_t key;
+			unsigned int item;
+		};
+
+		egpFrameBufferObjectDescriptor* mFBOArray;
+		egpProgram* mProgramArray;
+
+		std::vector<RenderQueueMaterial> mMaterials;
+		std::vector<Item> mItems;
+		std::vector<SortEntry> mOrder, mScratch;
+
+		//Commands of one run of sorted items, and the state changes it recorded.
+		struct Batch
+		{
+			RenderCommandBuffer buffer;
+			unsigned int numTargets, numPrograms, numMaterials, numVAOs, numBlocks, numDraws;
+		};
+		std::vector<Batch> mBatches;
+
+		//Radix sort buckets of every batch, 256 each.
+		std::vector<unsigned int> mCounts;
+
+		//Commands of the pool items by sorted position, uploaded after every sort. Other items leave an empty command.
+		std::vector<egpDrawIndirectCommand> mDrawCommands;
+		egpIndirectBufferDescriptor mIndirectBuffer;
+
+		JobSystem* mJobs;
+
+		//State changes and GL draw calls in the last sort, for printStats().
+		unsigned int mNumTargets, mNumPrograms, mNumMaterials, mNumVAOs, mNumBlocks, mNumDraws, mNumBatches;
+		float mSortMs;
+
+		void runBatches(const std::function<void(unsigned int)>& job);
+		void radixSort();
+		void record(unsigned int first, unsigned int last, Batch& batch);
+		void joinBatches();
+
+	public:
+		/**
+		 * \param fbos Pointer to the global FBO array.
+		 * \param programs Pointer to the global GLSLProgram array. */
+		RenderQueue(egpFrameBufferObjectDescriptor* fbos, egpProgram* programs);
+
+		/**
+		 * \brief Register a material. Materials stay until clearMaterials().
+		 * \return Id to submit items with; never 0, which is the material with no textures. */
+		unsigned int addMaterial(const RenderQueueMaterial& material);
+		void clearMaterials() { mMaterials.resize(1); }
+
+		/**
+		 * \brief Sort and record runs of items on these threads. Null (the default) does everything on the calling thread. */
+		void setJobSystem(JobSystem* jobs) { mJobs = jobs; }
+
+		/**
+		 * \brief Queue a draw.
+		 * \param target FBO it draws to.
+		 * \param program Program it draws with.
+		 * \param material Id from addMaterial(), or 0 to bind no textures.
+		 * \param vao What it draws.
+		 * \param depth Distance from the camera over the far plane, [0, 1]; nearer items draw first.
+		 * \param object Uniform block range with the item's own data. */
+		void submit(FBOIndex target, GLSLProgramIndex program, unsigned int material, const egpVertexArrayObjectDescriptor* vao, float depth, const RenderPassUniformBlockData& object);
+		/**
+		 * \brief Queue a mesh from a pool. The program reads the item's data by draw index (see egpfwVertexBuffer.h).
+		 * \param pool Pool the mesh is in; must outlive the queue's commands.
+		 * \param mesh What it draws.
+		 * \param objects Uniform block range the program indexes into; the same for every item of a batch.
+		 * \param drawIndex Index of the item's data in that range. */
+		void submit(FBOIndex target, GLSLProgramIndex program, unsigned int material, const egpMeshPoolDescriptor* pool, const egpMeshPoolMesh& mesh, float depth, const RenderPassUniformBlockData& objects, unsigned int drawIndex);
+		/**
+		 * \brief Remove every item. Storage is kept, so filling the queue again doesn't allocate. */
+		void clear() { mItems.clear(); }
+		unsigned int size() const { return (unsigned int)mItems.size(); }
+
+		/**
+		 * \brief Sort what was submitted and build the command list execute() runs. */
+		void sort();
+		/**
+		 * \brief Run the commands built by the last sort(). */
+		void execute() const;
+
+		/**
+		 * \brief Print how many state changes the last sort() left for its draws, and how long it took. */
+		void printStats() const;
+
+		/**
+		 * \brief Delete the indirect buffer. Needs the GL context, so it can't wait for the destructor. */
+		void release();
+};
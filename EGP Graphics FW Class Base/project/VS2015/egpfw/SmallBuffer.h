@@ -0,0 +1,123 @@
+#pragma once
+#include <string.h>
+#include <type_traits>
+
+/**
+ * \brief Array of plain data stored inside its owner until it outgrows N elements, then in a single heap block.
+ * Move-only; use copyFrom() where a copy is really wanted. clear() keeps the heap block for the next fill.
+ * \tparam T Element type. Must be trivially copyable, since elements are moved around with memcpy.
+ * \tparam N Number of elements that fit without allocating. */
+template <typename T, unsigned int N>
+class SmallBuffer
+{
+	static_assert(std::is_trivially_copyable<T>::value, "SmallBuffer only holds plain data");
+
+	private:
+		T mInline[N];
+		T* mHeap;
+		unsigned int mSize, mCapacity;
+
+		void reserve(unsigned int capacity);
+		void takeFrom(SmallBuffer& other);
+
+	public:
+		SmallBuffer() : mHeap(nullptr), mSize(0), mCapacity(N) {}
+		SmallBuffer(SmallBuffer&& other) : mHeap(nullptr), mSize(0), mCapacity(N) { takeFrom(other); }
+		SmallBuffer(const SmallBuffer&) = delete;
+		~SmallBuffer() { delete[] mHeap; }
+
+		SmallBuffer& operator=(SmallBuffer&& other);
+		SmallBuffer& operator=(const SmallBuffer&) = delete;
+
+		void copyFrom(const SmallBuffer& other);
+
+		void push_back(const T& value) { insert(mSize, value); }
+		/**
+		 * \brief Insert before position i, shifting everything after it up one. */
+		void insert(unsigned int i, const T& value);
+		void clear() { mSize = 0; }
+
+		unsigned int size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		bool isInline() const { return mHeap == nullptr; }
+
+		T* data() { return mHeap ? mHeap : mInline; }
+		const T* data() const { return mHeap ? mHeap : mInline; }
+		T* begin() { return data(); }
+		T* end() { return data() + mSize; }
+		const T* begin() const { return data(); }
+		const T* end() const { return data() + mSize; }
+		T& operator[](unsigned int i) { return data()[i]; }
+		const T& operator[](unsigned int i) const { return data()[i]; }
+};
+
+template <typename T, unsigned int N>
+SmallBuffer<T, N>& SmallBuffer<T, N>::operator=(SmallBuffer&& other)
+{
+	if (this != &other)
+	{
+		delete[] mHeap;
+		mHeap = nullptr;
+		mSize = 0;
+		mCapacity = N;
+		takeFrom(other);
+	}
+	return *this;
+}
+
+template <typename T, unsigned int N>
+void SmallBuffer<T, N>::copyFrom(const SmallBuffer& other)
+{
+	if (this == &other)
+		return;
+
+	mSize = 0;
+	reserve(other.mSize);
+	memcpy(data(), other.data(), other.mSize * sizeof(T));
+	mSize = other.mSize;
+}
+
+template <typename T, unsigned int N>
+void SmallBuffer<T, N>::insert(unsigned int i, const T& value)
+{
+	//The value may be one of our own elements, which growing frees and shifting moves, so take it first.
+	const T copy = value;
+	if (mSize == mCapacity)
+		reserve(mCapacity * 2);
+
+	T* elements = data();
+	memmove(elements + i + 1, elements + i, (mSize - i) * sizeof(T));
+	elements[i] = copy;
+	++mSize;
+}
+
+template <typename T, unsigned int N>
+void SmallBuffer<T, N>::reserve(unsigned int capacity)
+{
+	if (capacity <= mCapacity)
+		return;
+
+	T* block = new T[capacity];
+	memcpy(block, data(), mSize * sizeof(T));
+	delete[] mHeap;
+	mHeap = block;
+	mCapacity = capacity;
+}
+
+template <typename T, unsigned int N>
+void SmallBuffer<T, N>::takeFrom(SmallBuffer& other)
+{
+	//A heap block changes hands; inline elements have to be copied over.
+	if (other.mHeap)
+	{
+		mHeap = other.mHeap;
+		mCapacity = other.mCapacity;
+	}
+	else
+		memcpy(mInline, other.mInline, other.mSize * sizeof(T));
+	mSize = other.mSize;
+
+	other.mHeap = nullptr;
+	other.mSize = 0;
+	other.mCapacity = N;
+}
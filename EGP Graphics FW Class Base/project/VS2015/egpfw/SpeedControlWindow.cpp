@@ -328,28 +328,28 @@ void SpeedControlWindow::renderToFBO(int* curveUniformSet, int* solidColorUnifor
 	for (size_t i = 0; i < mWaypointChannels.size(); ++i)
 	{
 		// draw curve
-		egpActivateProgram(mProgramList + drawCurveProgram);
-		egpSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
+		egpfwActivateProgram(mProgramList + drawCurveProgram);
+		egpfwSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
 
 		vecSize = mWaypointChannels[i].size();
 
 		// ship waypoint data to program, where it will be received by GS
-		egpSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, mWaypointChannels[i].data()->v);
-		egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
-		egpSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &vecSize);
+		egpfwSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, mWaypointChannels[i].data()->v);
+		egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
+		egpfwSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &vecSize);
 		int curvemode = (int)mCurrentCurve;
-		egpSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &curvemode); //is this how i set the curve in teh shader?
-		egpSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
+		egpfwSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &curvemode); //is this how i set the curve in teh shader?
+		egpfwSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
 
-		egpActivateVAO(mVAOList + pointModel);
-		egpDrawActiveVAO();
+		egpfwActivateVAO(mVAOList + pointModel);
+		egpfwDrawActiveVAO();
 
 		// draw waypoints using solid color program and sphere model
 		cbmath::mat4 waypointModelMatrix = cbmath::makeScale4(4.0f);
-		egpActivateProgram(mProgramList + testSolidColorProgramIndex);
-		egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
+		egpfwActivateProgram(mProgramList + testSolidColorProgramIndex);
+		egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[i].v);
 
-		egpActivateVAO(mVAOList + sphere8x6Model);
+		egpfwActivateVAO(mVAOList + sphere8x6Model);
 
 		// draw waypoints
 		for (j = 0, waypointPtr = mWaypointChannels[i].data(); j < mWaypointChannels[i].size(); ++j, ++waypointPtr)
@@ -357,39 +357,39 @@ void SpeedControlWindow::renderToFBO(int* curveUniformSet, int* solidColorUnifor
 			// set position, update MVP for this waypoint and draw
 			waypointModelMatrix.c3 = *waypointPtr;
 			waypointMVP = mLittleBoxWindowMatrix * waypointModelMatrix;
-			egpSendUniformFloatMatrix(solidColorUniformSet[unif_mvp], UNIF_MAT4, 1, 0, waypointMVP.m);
-			egpDrawActiveVAO();
+			egpfwSendUniformFloatMatrix(solidColorUniformSet[unif_mvp], UNIF_MAT4, 1, 0, waypointMVP.m);
+			egpfwDrawActiveVAO();
 		}
 	}
 
 	//Draw the moving vertical line
 	cbmath::vec4 points[2] = { cbmath::vec4(mCurrentTime / 2.0f * mWindowSize.x, 0.0f, 0.0f, 1.0f), cbmath::vec4(mCurrentTime / 2.0f * mWindowSize.x, mWindowSize.y, 0.0f, 1.0f) };
-	egpActivateProgram(mProgramList + drawCurveProgram);
-	egpSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
+	egpfwActivateProgram(mProgramList + drawCurveProgram);
+	egpfwSendUniformFloatMatrix(curveUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mLittleBoxWindowMatrix.m);
 
-	egpSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, points[0].v);
-	egpSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[NUM_CHANNELS].v);
-	egpSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &twoTest);
-	egpSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
-	egpSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
+	egpfwSendUniformFloat(curveUniformSet[unif_waypoint], UNIF_VEC4, vecSize, points[0].v);
+	egpfwSendUniformFloat(solidColorUniformSet[unif_color], UNIF_VEC4, 1, COLORS[NUM_CHANNELS].v);
+	egpfwSendUniformInt(curveUniformSet[unif_waypointCount], UNIF_INT, 1, &twoTest);
+	egpfwSendUniformInt(curveUniformSet[unif_curveMode], UNIF_INT, 1, &zeroTest);
+	egpfwSendUniformInt(curveUniformSet[unif_useWaypoints], UNIF_INT, 1, &trueTest);
 
-	egpActivateVAO(mVAOList + pointModel);
-	egpDrawActiveVAO();
+	egpfwActivateVAO(mVAOList + pointModel);
+	egpfwDrawActiveVAO();
 }
 
 void SpeedControlWindow::renderToBackbuffer(int* textureUniformSet)
 {
 	//Draw our FBO to the backbuffer
-	egpActivateProgram(mProgramList + testTextureProgramIndex);
-	egpActivateVAO(mVAOList + fsqModel);
+	egpfwActivateProgram(mProgramList + testTextureProgramIndex);
+	egpfwActivateVAO(mVAOList + fsqModel);
 	egpfwBindColorTargetTexture(mFBOList + speedControlFBO, 0, 0);
-	egpSendUniformFloatMatrix(textureUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mOnScreenMatrix.m);
-	egpDrawActiveVAO();
+	egpfwSendUniformFloatMatrix(textureUniformSet[unif_mvp], UNIF_MAT4, 1, 0, mOnScreenMatrix.m);
+	egpfwDrawActiveVAO();
 
 
 	//display which curve mode we're currently on
 	glBegin(GL_BITMAP); 
-	egpActivateProgram(0);
+	egpfwActivateProgram(0);
 	glDisable(GL_TEXTURE_2D);
 
 	auto color = cbmath::vec4(0.6, 0.5, 1, 1);
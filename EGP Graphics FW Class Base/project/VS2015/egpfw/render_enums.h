@@ -17,6 +17,8 @@ enum GLSLProgramIndex
 	bloomBrightProgramIndex,
 	bloomBlurProgramIndex,
 	bloomBlendProgramIndex,
+	blurDualDownProgramIndex,
+	blurDualUpProgramIndex,
 
 	// shadow mapping and projective texturing
 	projectiveTextureProgram,
@@ -52,6 +54,8 @@ enum GLSLCommonUniformIndex
 	unif_sm,
 
 	unif_pixelSizeInv,
+	unif_blurKernel,
+	unif_blurTapCount,
 	unif_img,
 	unif_img1,
 	unif_img2,
@@ -76,11 +80,63 @@ enum GLSLCommonUniformIndex
 	unif_useWaypoints,
 	unif_color,
 
+	unif_tableIndex,
+
+	// clustered lights
+	unif_lightLists,
+
 	//-----------------------------
 	GLSLCommonUniformCount
 };
 
 
+// uniform block binding points, the same in every program
+enum UniformBlockBinding
+{
+	frameBlockBinding,		// FrameUniforms: camera and lights
+	objectBlockBinding,		// ObjectUniforms: one range per object
+	textureTableBlockBinding,	// TextureTable: bindless handles of pass inputs
+
+	//-----------------------------
+	uniformBlockBindingCount
+};
+
+// objects with a range in the object uniform buffer
+// the deferred scene shader indexes them as an array (NUM_OBJECTS must match)
+enum ObjectUniformIndex
+{
+	skyboxObject,
+	earthObject,
+	moonObject,
+	marsObject,
+	groundObject,
+
+	//-----------------------------
+	objectUniformCount
+};
+
+
+// texture table slots: render targets that passes read by index
+//	(see egpfwTextureTable.h); at most EGP_TEXTURE_TABLE_SIZE
+enum TextureTableSlot
+{
+	table_scene,
+	table_brightD2,
+	table_hblurD2,
+	table_vblurD2,
+	table_hblurD4,
+	table_vblurD4,
+	table_hblurD8,
+	table_vblurD8,
+	table_gbufferDepth,
+	table_gbufferNormal,
+	table_gbufferSurface,
+
+	//-----------------------------
+	textureTableSlotCount
+};
+
+
 // framebuffer objects (FBOs)
 enum FBOIndex
 {
@@ -143,4 +199,15 @@ enum ModelIndex
 
 	//-----------------------------
 	modelCount
+};
+
+// meshes packed into the scene's mesh pool
+enum PoolMeshIndex
+{
+	sphereLowResPoolMesh,
+	sphereHiResPoolMesh,
+	groundPoolMesh,
+
+	//-----------------------------
+	poolMeshCount
 };
\ No newline at end of file
@@ -0,0 +1,79 @@
+/*
+	Dual Filter Blur (Down)
+	Fragment shader that blurs an image into a target of the same size or 
+	half of it: the first pass of a dual filter level (see BlurChain.h).
+*/
+
+// version
+#version 410
+#ifdef EGP_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif	// EGP_BINDLESS
+
+
+// ****
+// varyings
+in vec2 passTexcoord;
+
+
+// ****
+// uniforms
+uniform vec2 pixelSizeInv;	// one texel of the image
+uniform ivec4 tableIndex;	// x: slot of the image to blur
+
+// pass inputs, looked up by slot (see egpfwTextureTable.h); the program
+//	defines EGP_BINDLESS when the table holds bindless handles
+#define TEXTURE_TABLE_SIZE 12
+#ifdef EGP_BINDLESS
+layout (std140) uniform TextureTable
+{
+	sampler2D textureTable[TEXTURE_TABLE_SIZE];
+};
+#else	// !EGP_BINDLESS
+uniform sampler2D textureTable[TEXTURE_TABLE_SIZE];
+#endif	// EGP_BINDLESS
+
+// per-frame data, uploaded once and shared by every program
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+};
+
+
+// ****
+// target
+layout (location = 0) out vec4 fragColor;
+
+
+// the frame covers only part of each target (see FrameGraph.h), so taps 
+//	past its far edge are pulled back in, as clamping to the edge would
+vec4 sampleFrame(in sampler2D image, in vec2 coord)
+{
+	return texture(image, min(coord, targetScale.xy - 0.5 * pixelSizeInv));
+}
+
+
+// the center, and four fetches one texel out on the diagonals: at half 
+//	size the center lands between four texels, so every fetch averages 
+//	four and together they cover a 4x4 block with a peak in the middle
+vec4 dualDown(in vec2 center, in vec2 texel, in sampler2D image)
+{
+	vec4 result = texture(image, center) * 4.0;
+	result += sampleFrame(image, center - texel);
+	result += sampleFrame(image, center + texel);
+	result += sampleFrame(image, center + vec2(texel.x, -texel.y));
+	result += sampleFrame(image, center - vec2(texel.x, -texel.y));
+	return result / 8.0;
+}
+
+
+// shader function
+void main()
+{
+	fragColor = dualDown(passTexcoord, pixelSizeInv, textureTable[tableIndex.x]);
+}
\ No newline at end of file
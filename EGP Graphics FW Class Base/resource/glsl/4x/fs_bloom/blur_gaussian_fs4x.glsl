@@ -8,6 +8,9 @@
 
 // version
 #version 410
+#ifdef EGP_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif	// EGP_BINDLESS
 
 
 // ****
@@ -17,8 +20,37 @@ in vec2 passTexcoord;
 
 // ****
 // uniforms
-uniform vec2 pixelSizeInv;
-uniform sampler2D img;
+uniform vec2 pixelSizeInv;	// one texel of the image along the axis
+uniform ivec4 tableIndex;	// x: slot of the image to blur
+
+// x: offset in texels, y: weight; [0] is the center, the rest are fetched 
+//	on both sides (see BlurChain.h, maxTaps must match)
+#define BLUR_MAX_TAPS 5
+uniform vec2 blurKernel[BLUR_MAX_TAPS];
+uniform int blurTapCount;
+
+// pass inputs, looked up by slot (see egpfwTextureTable.h); the program
+//	defines EGP_BINDLESS when the table holds bindless handles
+#define TEXTURE_TABLE_SIZE 12
+#ifdef EGP_BINDLESS
+layout (std140) uniform TextureTable
+{
+	sampler2D textureTable[TEXTURE_TABLE_SIZE];
+};
+#else	// !EGP_BINDLESS
+uniform sampler2D textureTable[TEXTURE_TABLE_SIZE];
+#endif	// EGP_BINDLESS
+
+// per-frame data, uploaded once and shared by every program
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+};
 
 
 // ****
@@ -27,42 +59,29 @@ layout (location = 0) out vec4 fragColor;
 
 
 // Gaussian blurring, using a 1D kernel along the provided axis 
-// if using Pascal's triangle for the kernel, odd rows should be used: 
-//	2^0:	1
-//	2^1:	1	1
-//	2^2:	1	2	1
-//	2^3:	1	3	3	1
+// the kernel is a row of Pascal's triangle (4, 8, 10 or 16), e.g.: 
 //	2^4:	1	4	6	4	1
-//	2^5:	1	5	10	10	5	1
-//	2^6:	1	6	15	20	15	6	1
-//	2^7:	1	7	21	35	35	21	7	1
 //	2^8:	1	8	28	56	70	56	28	8	1
-//	2^9:	1	9	36	84	126	126	84	36	9	1
 //	2^10:	1	10	45	120	210	252	210	120	45	10	1
-vec4 Gaussian8(in vec2 center, in vec2 axis, in sampler2D image)
+// neighbouring weights are folded into one fetch between their texels, 
+//	placed so linear filtering blends them in the right proportion, so 
+//	the 11 taps of row 10 take 7 fetches
+// the frame covers only part of each target (see FrameGraph.h), so taps 
+//	past its far edge are pulled back in, as clamping to the edge would
+vec4 sampleFrame(in sampler2D image, in vec2 coord, in vec2 axis)
 {
-	vec4 result = texture(image, center) * 70.0;
-	vec2 axis_n = -axis;
-	vec2 samplingCoord = center;	// sampling positive direction
-	vec2 samplingCoord_n = center;	// sampling negative direction
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 56.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 28.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 8.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n));
-	return result / 256.0;
+	return texture(image, min(coord, targetScale.xy - 0.5 * axis));
 }
-vec4 Gaussian10(in vec2 center, in vec2 axis, in sampler2D image)
+
+vec4 Gaussian(in vec2 center, in vec2 axis, in sampler2D image)
 {
-	vec4 result = texture(image, center) * 252.0;
-	vec2 axis_n = -axis;
-	vec2 samplingCoord = center;	// sampling positive direction
-	vec2 samplingCoord_n = center;	// sampling negative direction
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 210.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 120.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 45.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n)) * 10.0;
-	result += (texture(image, samplingCoord += axis) + texture(image, samplingCoord_n += axis_n));
-	return result / 1024.0;
+	vec4 result = texture(image, center) * blurKernel[0].y;
+	for (int i = 1; i < blurTapCount; ++i)
+	{
+		vec2 offset = axis * blurKernel[i].x;
+		result += (sampleFrame(image, center + offset, axis) + sampleFrame(image, center - offset, axis)) * blurKernel[i].y;
+	}
+	return result;
 }
 
 
@@ -71,10 +90,10 @@ void main()
 {
 	// ****
 	// output: Gaussian blur on an arbitrary axis
-	fragColor = Gaussian10(passTexcoord, pixelSizeInv, img);
+	fragColor = Gaussian(passTexcoord, pixelSizeInv, textureTable[tableIndex.x]);
 	
 	//fragColor = vec4(passTexcoord.xy, 0, 0);
 	//fragColor = vec4(pixelSizeInv.xy, 0, 1) * 100;
 
-	//fragColor = texture(img, passTexcoord);
+	//fragColor = texture(textureTable[tableIndex.x], passTexcoord);
 }
\ No newline at end of file
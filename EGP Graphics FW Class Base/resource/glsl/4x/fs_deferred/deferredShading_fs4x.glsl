@@ -8,6 +8,9 @@
 
 // version
 #version 410
+#ifdef EGP_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif	// EGP_BINDLESS
 
 
 // ****
@@ -19,15 +22,37 @@ in vec2 passTexcoord;
 // uniforms
 uniform sampler2D tex_dm;
 uniform sampler2D tex_sm;
-uniform sampler2D img_position;
-uniform sampler2D img_normal;
-uniform sampler2D img_depth;
-uniform sampler2D img_texcoord;
-
-#define NUM_LIGHTS 4
-uniform vec4 lightColor[NUM_LIGHTS];
-uniform vec4 lightPos[NUM_LIGHTS];
-uniform vec4 eyePos;
+uniform ivec4 tableIndex;	// xyz: slots of depth, normal and surface
+
+// lights sorted into clusters over the frustum, all in one buffer so the 
+//	texture table still fits in 16 samplers (see LightClusters.h): 
+//	per cluster, where its run of indices starts (in uints) and its count; 
+//	two texels per light, position and radius then color, as float bits; 
+//	then the indices, four to a texel, each the texel of a light
+uniform usamplerBuffer lightLists;
+
+// pass inputs, looked up by slot (see egpfwTextureTable.h); the program
+//	defines EGP_BINDLESS when the table holds bindless handles
+#define TEXTURE_TABLE_SIZE 12
+#ifdef EGP_BINDLESS
+layout (std140) uniform TextureTable
+{
+	sampler2D textureTable[TEXTURE_TABLE_SIZE];
+};
+#else	// !EGP_BINDLESS
+uniform sampler2D textureTable[TEXTURE_TABLE_SIZE];
+#endif	// EGP_BINDLESS
+
+// per-frame data, uploaded once and shared by every program
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+};
 
 
 // ****
@@ -41,11 +66,39 @@ float calculateAttenuation(float distSq, float maxDistSq)
 	return (1.0 - max(0.0, min(1.0, atten)));
 }
 
+// g-buffer decoding (see drawGBuffers)
+vec2 signNotZero(in vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec4 decodeNormal(in vec2 e)
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return vec4(normalize(n), 0.0);
+}
+
+// texcoord covers the drawn part of the target, screen space the frame
+vec4 decodePosition(in vec2 texcoord, in float depth)
+{
+	vec4 position = viewprojMatInv * vec4(vec3(texcoord / targetScale.xy, depth) * 2.0 - 1.0, 1.0);
+	return position / position.w;
+}
+
+uint decodeMaterial(in float packed)
+{
+	return uint(packed * 65535.0 + 0.5);
+}
+
 float evaluateLight(int i, in vec4 position, out vec4 lightVec, out vec4 lightCol)
 {
-	float maxDistSq = lightColor[i].w*lightColor[i].w;
-	lightCol = lightColor[i];
-	lightVec = lightPos[i] - position;
+	vec4 lightPos = uintBitsToFloat(texelFetch(lightLists, i));
+	float maxDistSq = lightPos.w*lightPos.w;
+	lightCol = uintBitsToFloat(texelFetch(lightLists, i + 1));
+	lightVec = vec4(lightPos.xyz, 1.0) - position;
 	float distSq = dot(lightVec, lightVec);
 	lightVec = normalize(lightVec);
 	return calculateAttenuation(distSq, maxDistSq);
@@ -76,9 +129,19 @@ void main()
 	// ****
 	// output: calculate lighting for each light by reading in 
 	//	attribute data from g-buffers
-	vec4 position = texture(img_position, passTexcoord);
-	vec4 normal = normalize(texture(img_normal, passTexcoord));
-	vec4 texcoord = texture(img_texcoord, passTexcoord);
+	vec4 surface = texture(textureTable[tableIndex.z], passTexcoord);
+
+	// material 0 is nothing drawn
+	if (decodeMaterial(surface.z) == 0u)
+	{
+		fragColor = vec4(0.0);
+		return;
+	}
+
+	float depth = texture(textureTable[tableIndex.x], passTexcoord).x;
+	vec4 position = decodePosition(passTexcoord, depth);
+	vec4 normal = decodeNormal(texture(textureTable[tableIndex.y], passTexcoord).xy);
+	vec4 texcoord = vec4(surface.xy, 0.0, 1.0);
 
 	vec4 diffuseSample = texture(tex_dm, texcoord.xy);
 	vec4 specularSample = texture(tex_sm, texcoord.xy);
@@ -87,17 +150,18 @@ void main()
 	vec4 lightVec, lightCol, lighting = vec4(0.0);
 	float atten;
 
-	atten = evaluateLight(0, position, lightVec, lightCol);
-	lighting += phong(atten, normal, lightVec, eyeVec, lightCol, diffuseSample, specularSample);
-	
-	atten = evaluateLight(1, position, lightVec, lightCol);
-	lighting += phong(atten, normal, lightVec, eyeVec, lightCol, diffuseSample, specularSample);
-
-	atten = evaluateLight(2, position, lightVec, lightCol);
-	lighting += phong(atten, normal, lightVec, eyeVec, lightCol, diffuseSample, specularSample);
-
-	atten = evaluateLight(3, position, lightVec, lightCol);
-	lighting += phong(atten, normal, lightVec, eyeVec, lightCol, diffuseSample, specularSample);
+	// only the lights of this pixel's cluster: its screen tile, then the 
+	//	slice of its view depth
+	float viewDepth = clusterDepth.y / (depth * 2.0 - 1.0 + clusterDepth.x);
+	vec3 cell = vec3(passTexcoord / targetScale.xy * clusterGrid.xy, log(viewDepth) * clusterDepth.z + clusterDepth.w);
+	ivec3 c = ivec3(clamp(cell, vec3(0.0), clusterGrid.xyz - 1.0));
+	uvec2 cluster = texelFetch(lightLists, (c.z * int(clusterGrid.y) + c.y) * int(clusterGrid.x) + c.x).xy;
+
+	for (uint i = cluster.x; i < cluster.x + cluster.y; ++i)
+	{
+		atten = evaluateLight(int(texelFetch(lightLists, int(i >> 2u))[int(i & 3u)]), position, lightVec, lightCol);
+		lighting += phong(atten, normal, lightVec, eyeVec, lightCol, diffuseSample, specularSample);
+	}
 
 	fragColor = lighting;
 }
\ No newline at end of file
@@ -23,6 +23,17 @@ uniform sampler2D img2;
 uniform sampler2D img3;
 uniform sampler2D img4;
 
+// per-frame data, uploaded once and shared by every program
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+};
+
 
 // ****
 // target
@@ -61,7 +72,7 @@ void main()
 	vec4 blur4Sample = texture(img3, passTexcoord);
 	vec4 blur8Sample = texture(img4, passTexcoord);
 
-	float focusDepth = texture(img_depth_sample, vec2(0.5, 0.5)).x;
+	float focusDepth = texture(img_depth_sample, 0.5 * targetScale.xy).x;
 
 	float depthDiff = abs(depthVal - focusDepth);
 
@@ -2,6 +2,9 @@
 	Draw G-Buffers
 	By Dan Buckstein
 	Fragment shader that outputs incoming geometric attributes as color.
+	Compact layout: position comes back from depth, so only the normal 
+		(octahedral, RG16) and surface (atlas texcoord and material id, 
+		RGBA16) are written.
 	
 	Modified by: ______________________________________________________________
 */
@@ -14,33 +17,46 @@
 // varyings
 in vertexdata
 {
-	vec4 position_world;
 	vec4 normal_world;
 	vec4 texcoord_atlas;
+	flat uint materialId;
 } pass;
 
 
 // ****
 // target
-layout (location = 0) out vec4 gbuffer_position;
-layout (location = 1) out vec4 gbuffer_normal;
-layout (location = 2) out vec4 gbuffer_texcoord;
+layout (location = 0) out vec2 gbuffer_normal;
+layout (location = 1) out vec4 gbuffer_surface;	// xy: atlas texcoord, z: material id
 
 
 // debugging
 uniform sampler2D tex_dm;
 
 
+// octahedral normal encoding: the unit sphere is folded onto a square so 
+//	two unsigned 16-bit channels hold it evenly (decoded in deferred shading)
+vec2 signNotZero(in vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeNormal(in vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return e * 0.5 + 0.5;
+}
+
+
 // shader function
 void main()
 {
 	// ****
 	// copy inbound values to their respective g-buffer
-	gbuffer_position = pass.position_world;
-	gbuffer_texcoord = pass.texcoord_atlas;
-	gbuffer_normal = pass.normal_world;
+	// material ids are stored as 16-bit normalized, so they come back exactly
+	gbuffer_normal = encodeNormal(normalize(pass.normal_world.xyz));
+	gbuffer_surface = vec4(pass.texcoord_atlas.xy, float(pass.materialId) / 65535.0, 1.0);
 
 	// debugging
-//	gbuffer_normal = 0.5 + 0.5*gbuffer_normal;	// works
-//	gbuffer_texcoord = texture(tex_dm, gbuffer_texcoord.xy);	// works
+//	gbuffer_surface = texture(tex_dm, gbuffer_surface.xy);	// works
 }
\ No newline at end of file
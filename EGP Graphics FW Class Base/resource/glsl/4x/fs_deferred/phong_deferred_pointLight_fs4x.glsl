@@ -18,14 +18,25 @@ in vec4 passPositionClip;
 
 // ****
 // uniforms
-uniform sampler2D img_position;
-uniform sampler2D img_normal;
+uniform sampler2D img_normal;	// octahedral normal
+uniform sampler2D img_texcoord;	// surface: xy: atlas texcoord, z: material id
 uniform sampler2D img_depth;
 
 uniform vec4 lightColor;
 uniform vec4 lightPos;
 uniform vec4 eyePos;
 
+// per-frame data, named so its eye position doesn't clash with this pass's own
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+} frame;
+
 
 // ****
 // target
@@ -39,6 +50,33 @@ float calculateAttenuation(float distSq, float maxDistSq)
 	return (1.0 - max(0.0, min(1.0, atten)));
 }
 
+// g-buffer decoding (see drawGBuffers)
+vec2 signNotZero(in vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec4 decodeNormal(in vec2 e)
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return vec4(normalize(n), 0.0);
+}
+
+// texcoord covers the drawn part of the target, screen space the frame
+vec4 decodePosition(in vec2 texcoord, in float depth)
+{
+	vec4 position = frame.viewprojMatInv * vec4(vec3(texcoord / frame.targetScale.xy, depth) * 2.0 - 1.0, 1.0);
+	return position / position.w;
+}
+
+uint decodeMaterial(in float packed)
+{
+	return uint(packed * 65535.0 + 0.5);
+}
+
 void phong(float atten, in vec4 N, in vec4 L, in vec4 V, in vec4 lightColor, out vec4 diffuseShading, out vec4 specularShading)
 {
 	float kd = dot(N, L);
@@ -68,13 +106,22 @@ void main()
 	// ****
 	// since we did not generate this fragment using FSQ, 
 	//	need to figure out where we are in screen space...
-	vec2 screenspace = passPositionClip.xy * (0.5 / passPositionClip.w) + 0.5;
-	//vec2 screenspace = gl_FragCoord.xy;
+	// (the g-buffers are bigger than the frame and drawn to from the 
+	//	corner, so the fragment's pixel over their size gives where)
+	//vec2 screenspace = passPositionClip.xy * (0.5 / passPositionClip.w) + 0.5;
+	vec2 screenspace = gl_FragCoord.xy / vec2(textureSize(img_depth, 0));
 
 	// ****
 	// output: calculate lighting for this light
-	vec4 position = texture(img_position, screenspace);
-	vec4 normal = normalize(texture(img_normal, screenspace));
+	// material 0 is nothing drawn
+	if (decodeMaterial(texture(img_texcoord, screenspace).z) == 0u)
+	{
+		light_diffuse = light_specular = vec4(0.0);
+		return;
+	}
+
+	vec4 position = decodePosition(screenspace, texture(img_depth, screenspace).x);
+	vec4 normal = decodeNormal(texture(img_normal, screenspace).xy);
 	vec4 eyeVec = normalize(eyePos - position);
 	vec4 lightVec = lightPos - position;
 
@@ -16,6 +16,20 @@ layout (location = 0) in vec4 position;
 layout (location = 8) in vec4 texcoord;
 
 
+// ****
+// uniforms
+// per-frame data, uploaded once and shared by every program
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+};
+
+
 // ****
 // varyings
 out vec2 passTexcoord;
@@ -30,5 +44,7 @@ void main()
 
 	// ****
 	// pass data
-	passTexcoord = texcoord.xy;
+	// render targets are bigger than the frame and drawn to from the 
+	//	corner, so the quad only covers that part of them
+	passTexcoord = texcoord.xy * targetScale.xy;
 }
\ No newline at end of file
@@ -19,9 +19,16 @@ layout (location = 8) in vec4 texcoord;
 
 // ****
 // uniforms
-uniform mat4 mvp;
-uniform vec4 lightPos;
-uniform vec4 eyePos;
+// per-object data, one range of a shared buffer per draw
+layout (std140) uniform ObjectUniforms
+{
+	mat4 modelMat;
+	mat4 atlasMat;
+	mat4 mvp;
+	vec4 lightPos_object;
+	vec4 eyePos_object;
+	float normalScale;
+};
 
 
 // ****
@@ -45,7 +52,7 @@ void main()
 	// ****
 	// pass data
 	pass.normal = vec4(normal.xyz, 0.0);
-	pass.lightVec = lightPos - position;
-	pass.eyeVec = eyePos - position;
+	pass.lightVec = lightPos_object - position;
+	pass.eyeVec = eyePos_object - position;
 	pass.texcoord = texcoord;
 }
\ No newline at end of file
@@ -16,22 +16,51 @@ layout (location = 0) in vec4 position;
 layout (location = 2) in vec4 normal;
 layout (location = 8) in vec4 texcoord;
 
+// which object this draw is; set per draw, or per command by multi-draw
+layout (location = 15) in int drawIndex;
+
 
 // ****
 // uniforms
-uniform mat4 modelMat;
-uniform mat4 viewprojMat;
-uniform mat4 atlasMat;
-uniform float normalScale;
+// per-frame data, uploaded once and shared by every program
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewprojMat;
+	vec4 eyePos;
+	vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	vec4 targetScale;	// xy: part of each render target the frame covers
+	mat4 viewprojMatInv;
+};
+
+// per-object data: the whole shared buffer, indexed by draw
+// objects are 256 bytes apart, the largest offset alignment GL allows
+#define NUM_OBJECTS 5
+struct ObjectData
+{
+	mat4 modelMat;
+	mat4 atlasMat;
+	mat4 mvp;
+	vec4 lightPos_object;
+	vec4 eyePos_object;
+	float normalScale;
+	uint materialId;
+	vec4 pad;
+};
+
+layout (std140) uniform ObjectUniforms
+{
+	ObjectData objectData[NUM_OBJECTS];
+};
 
 
 // ****
 // varyings
 out vertexdata
 {
-	vec4 position_world;
 	vec4 normal_world;
 	vec4 texcoord_atlas;
+	flat uint materialId;
 } pass;
 
 
@@ -40,10 +69,11 @@ void main()
 {
 	// ****
 	// set proper clip position
-	vec4 worldPos = modelMat * position;
-	pass.position_world = worldPos;
-	pass.normal_world = modelMat * vec4(normal.xyz*normalScale, 0.0);
-	pass.texcoord_atlas = atlasMat * texcoord;
+	ObjectData object = objectData[drawIndex];
+	vec4 worldPos = object.modelMat * position;
+	pass.normal_world = object.modelMat * vec4(normal.xyz*object.normalScale, 0.0);
+	pass.texcoord_atlas = object.atlasMat * texcoord;
+	pass.materialId = object.materialId;
 	//pass.texcoord_atlas = texcoord;
 	gl_Position = viewprojMat * worldPos;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 // By Dan Buckstein
 // Modified by: _______________________________________________________________
 #include "egpfw/egpfw/egpfwFrameBuffer.h"
+#include "egpfw/egpfw/egpfwStateCache.h"
 
 
 // OpenGL
@@ -27,12 +28,12 @@ const unsigned int egpfwTargetName[] = {
 
 // color formats
 const unsigned int egpfwInternalColorFormat[] = {
-	0, GL_RGB8, GL_RGB16, GL_RGB32F, GL_RGBA8, GL_RGBA16, GL_RGBA32F,
+	0, GL_RGB8, GL_RGB16, GL_RGB32F, GL_RGBA8, GL_RGBA16, GL_RGBA32F, GL_RG16,
 };
 
 // color storage type
 const unsigned int egpfwInternalColorStorage[] = {
-	0, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT
+	0, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, GL_UNSIGNED_SHORT
 };
 
 // depth formats
@@ -50,6 +51,22 @@ const unsigned int egpfwInternalDepthStorage[] = {
 
 // ****
 egpFrameBufferObjectDescriptor egpfwCreateFBO(const unsigned int frameWidth, const unsigned int frameHeight, const unsigned int numColorTargets, const egpColorFormat colorFormat, const egpDepthFormat depthFormat, const egpWrapSmoothFormat wrapSmoothFormat)
+{
+  egpColorFormat colorFormats[16];
+  egpFrameBufferObjectDescriptor fbo;
+  unsigned int i, n = (colorFormat != COLOR_DISABLE && numColorTargets <= 16) ? numColorTargets : 0;
+
+  for (i = 0; i < n; ++i)
+    colorFormats[i] = colorFormat;
+
+  fbo = egpfwCreateFBOFormats(frameWidth, frameHeight, n, colorFormats, depthFormat, wrapSmoothFormat);
+  fbo.colorFormat = colorFormat;
+  return fbo;
+}
+
+
+// ****
+egpFrameBufferObjectDescriptor egpfwCreateFBOFormats(const unsigned int frameWidth, const unsigned int frameHeight, const unsigned int numColorTargets, const egpColorFormat *colorFormats, const egpDepthFormat depthFormat, const egpWrapSmoothFormat wrapSmoothFormat)
 {
   egpFrameBufferObjectDescriptor fbo = { 0 };
 
@@ -66,19 +83,23 @@ egpFrameBufferObjectDescriptor egpfwCreateFBO(const unsigned int frameWidth, con
   if (fbo.glhandle) {
     fbo.frameWidth = frameWidth;
     fbo.frameHeight = frameHeight;
+    fbo.textureWidth = frameWidth;
+    fbo.textureHeight = frameHeight;
     fbo.numColorTargets = numColorTargets;
     fbo.depthFormat = depthFormat;
     fbo.wrapSmoothFormat = wrapSmoothFormat;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo.glhandle);
+    // through the state cache, so it still knows what is bound afterwards
+    egpfwStateBindFramebuffer(fbo.glhandle);
 
     format = GL_RGBA;
-    internalFormat = egpfwInternalColorFormat[colorFormat];
-    internalStorage = egpfwInternalColorStorage[colorFormat];
 
     glGenTextures(fbo.numColorTargets, fbo.colorTargetHandle);
     for (unsigned int i = 0; i < fbo.numColorTargets; ++i) {
-      glBindTexture(GL_TEXTURE_2D, fbo.colorTargetHandle[i]);
+      internalFormat = egpfwInternalColorFormat[colorFormats[i]];
+      internalStorage = egpfwInternalColorStorage[colorFormats[i]];
+
+      egpfwStateSelectTexture(0, GL_TEXTURE_2D, fbo.colorTargetHandle[i]);
       glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, frameWidth, frameHeight, 0, format, internalStorage, 0);
 
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, smooth);
@@ -100,7 +121,7 @@ egpFrameBufferObjectDescriptor egpfwCreateFBO(const unsigned int frameWidth, con
       attachmentType = fbo.hasStencilTarget ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
 
       glGenTextures(1, &fbo.depthTargetHandle[0]);
-      glBindTexture(GL_TEXTURE_2D, fbo.depthTargetHandle[0]);
+      egpfwStateSelectTexture(0, GL_TEXTURE_2D, fbo.depthTargetHandle[0]);
       glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, frameWidth, frameHeight, 0, format, internalStorage, 0);
 
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, smooth);
@@ -118,8 +139,8 @@ egpFrameBufferObjectDescriptor egpfwCreateFBO(const unsigned int frameWidth, con
       egpfwReleaseFBO(&fbo);
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    egpfwStateBindFramebuffer(0);
+    egpfwStateBindTexture(0, GL_TEXTURE_2D, 0);
   }
 
   return fbo;
@@ -130,28 +151,29 @@ egpFrameBufferObjectDescriptor egpfwCreateFBO(const unsigned int frameWidth, con
 void egpfwActivateFBO(const egpFrameBufferObjectDescriptor *fbo)
 {
 
+  // all through the state cache: activating the same FBO again is free
   if (!fbo || !fbo->glhandle) {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    egpfwStateBindFramebuffer(0);
     return;
   }
 
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo->glhandle);
+  egpfwStateBindFramebuffer(fbo->glhandle);
   if (fbo->numColorTargets) {
-    glDrawBuffers(fbo->numColorTargets, egpfwTargetName);
+    egpfwStateDrawBuffers(fbo->numColorTargets, egpfwTargetName);
   }
 
   if (fbo->hasDepthTarget) {
-    glEnable(GL_DEPTH_TEST);
+    egpfwStateSetCapability(GL_DEPTH_TEST, 1);
     if (fbo->hasStencilTarget) {
-      glEnable(GL_STENCIL_TEST);
+      egpfwStateSetCapability(GL_STENCIL_TEST, 1);
     }
   } else {
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
+    egpfwStateSetCapability(GL_DEPTH_TEST, 0);
+    egpfwStateSetCapability(GL_STENCIL_TEST, 0);
   }
 
 
-  glViewport(0, 0, fbo->frameWidth, fbo->frameHeight);
+  egpfwStateViewport(0, 0, fbo->frameWidth, fbo->frameHeight);
 
 }
 
@@ -160,16 +182,21 @@ void egpfwActivateFBO(const egpFrameBufferObjectDescriptor *fbo)
 int egpfwReleaseFBO(egpFrameBufferObjectDescriptor *fbo)
 {
 	//...
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  unsigned int i;
+  egpfwStateBindFramebuffer(0);
 
   glDeleteFramebuffers(1, &fbo->glhandle);
+  egpfwStateForget(STATE_FRAMEBUFFER, fbo->glhandle);
 
   if (fbo->numColorTargets) {
     glDeleteTextures(fbo->numColorTargets, fbo->colorTargetHandle);
+    for (i = 0; i < fbo->numColorTargets; ++i)
+      egpfwStateForget(STATE_TEXTURE, fbo->colorTargetHandle[i]);
   }
 
   if (fbo->hasDepthTarget) {
     glDeleteTextures(1, fbo->depthTargetHandle);
+    egpfwStateForget(STATE_TEXTURE, fbo->depthTargetHandle[0]);
   }
 
 	return 0;
@@ -180,8 +207,7 @@ int egpfwReleaseFBO(egpFrameBufferObjectDescriptor *fbo)
 int egpfwBindColorTargetTexture(const egpFrameBufferObjectDescriptor *fbo, const unsigned int glBinding, const unsigned int targetIndex)
 {
   if (fbo && fbo->numColorTargets && targetIndex < 16) {
-    glActiveTexture(GL_TEXTURE0 + glBinding);
-    glBindTexture(GL_TEXTURE_2D, fbo->colorTargetHandle[targetIndex]);
+    egpfwStateBindTexture(glBinding, GL_TEXTURE_2D, fbo->colorTargetHandle[targetIndex]);
     return 1;
   }
 	return 0;
@@ -191,8 +217,7 @@ int egpfwBindColorTargetTexture(const egpFrameBufferObjectDescriptor *fbo, const
 int egpfwBindDepthTargetTexture(const egpFrameBufferObjectDescriptor *fbo, const unsigned int glBinding)
 {
   if (fbo && fbo->hasDepthTarget) {
-    glActiveTexture(GL_TEXTURE0 + glBinding);
-    glBindTexture(GL_TEXTURE_2D, fbo->depthTargetHandle[0]);
+    egpfwStateBindTexture(glBinding, GL_TEXTURE_2D, fbo->depthTargetHandle[0]);
     return 1;
   }
   return 0;
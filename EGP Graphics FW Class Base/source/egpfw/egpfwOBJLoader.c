@@ -10,6 +10,18 @@
 #include <math.h>
 #include <GL/glew.h>
 
+// file mapping for binary load, threads for the parallel passes
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else	// !_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#endif	// _WIN32
+
 
 #define BUFFER_OFFSET_BYTE(p,n) ((char *)(p) + n)
 
@@ -41,10 +53,18 @@ union face
 	struct { unsigned int v[3], vt[3], vn[3]; };
 };
 
-struct uniqueTriFace;
-struct uniqueVertex;
-struct uniqueTexcoord;
-struct uniqueNormal;
+// one welded vertex: the (v, vt, vn) triple it came from and where it ended up
+struct uniqueVertex
+{
+	unsigned int v, vt, vn, index;
+};
+
+// first bytes of every OBJ data block
+// egpfwGetOBJNumVertices relies on the vertex count coming first
+struct objDataHeader
+{
+	unsigned int vertexCount, indexCount, indexSize, reserved;
+};
 
 #ifndef __cplusplus
 typedef union float2			float2;
@@ -52,330 +72,1658 @@ typedef union float3			float3;
 typedef union float4			float4;
 typedef union int4				int4;
 typedef union face				face;
-typedef struct uniqueTriFace	uniqueTriFace;
 typedef struct uniqueVertex		uniqueVertex;
-typedef struct uniqueTexcoord	uniqueTexcoord;
-typedef struct uniqueNormal		uniqueNormal;
+typedef struct objDataHeader	objDataHeader;
 #endif	// __cplusplus
 
-struct interleave
+
+//-----------------------------------------------------------------------------
+
+
+// initial sizes for the parser's growable buffers
+// nothing is fixed-size anymore; these just keep small files from reallocating
+#define OBJ_BLOCK_SIZE 65536
+#define OBJ_ARENA_SIZE 1024
+
+// marks a face corner that had no texcoord or normal index in the file
+#define OBJ_INDEX_MISSING 0xFFFFFFFFu
+
+
+// growable array used while parsing
+// doubles its capacity whenever it runs out of room
+struct objArena
+{
+	char *data;
+	unsigned int count, capacity, elemSize;
+};
+
+// a face index that came from a negative OBJ index
+// those count back from the newest element, which a parser working on one 
+//	chunk of the file only knows relative to its own chunk; the face holds 
+//	that relative value until objRebaseIndices makes it absolute
+// 'entry' is 0-8 into the face's v, vt, vn
+struct objRelativeIndex
+{
+	unsigned int face, entry;
+};
+
+// everything the parser has read so far
+// lines can come in any order, so each attribute gets its own arena
+// tangents and bitangents are only filled by the tangent normal modes and 
+//	share the normals' indices
+struct objParseState
 {
-	float3 pos, nor;
-	float2 texcoord;
+	struct objArena positions, texcoords, normals, tangents, bitangents, faces, relative;
+	float scale;
+	int failed;
 };
 
-typedef struct interleave interleave;
+#ifndef __cplusplus
+typedef struct objArena			objArena;
+typedef struct objRelativeIndex	objRelativeIndex;
+typedef struct objParseState	objParseState;
+#endif	// __cplusplus
+
+
+static void objArenaInit(objArena *arena, const unsigned int elemSize)
+{
+	arena->data = 0;
+	arena->count = arena->capacity = 0;
+	arena->elemSize = elemSize;
+}
+
+// returns pointer to a new element at the end of the arena, or null if out of memory
+static void *objArenaPush(objArena *arena)
+{
+	char *data;
+	if (arena->count == arena->capacity)
+	{
+		unsigned int capacity = arena->capacity ? arena->capacity * 2 : OBJ_ARENA_SIZE;
+		data = (char *)realloc(arena->data, (size_t)capacity * arena->elemSize);
+		if (!data)
+			return 0;
+		arena->data = data;
+		arena->capacity = capacity;
+	}
+	return arena->data + (size_t)(arena->count++) * arena->elemSize;
+}
+
+static void objArenaRelease(objArena *arena)
+{
+	free(arena->data);
+	arena->data = 0;
+	arena->count = arena->capacity = 0;
+}
+
+// append everything in 'src' to 'dst'; both must have the same element size
+// returns 1 if successful, 0 if out of memory
+static int objArenaAppend(objArena *dst, const objArena *src)
+{
+	char *data;
+	unsigned int capacity = dst->capacity ? dst->capacity : OBJ_ARENA_SIZE;
+	while (capacity < dst->count + src->count)
+		capacity *= 2;
+	if (capacity != dst->capacity)
+	{
+		data = (char *)realloc(dst->data, (size_t)capacity * dst->elemSize);
+		if (!data)
+			return 0;
+		dst->data = data;
+		dst->capacity = capacity;
+	}
+	memcpy(dst->data + (size_t)dst->count * dst->elemSize, src->data, (size_t)src->count * src->elemSize);
+	dst->count += src->count;
+	return 1;
+}
+
+static void objParseStateInit(objParseState *state, const float scale)
+{
+	objArenaInit(&state->positions, sizeof(float3));
+	objArenaInit(&state->texcoords, sizeof(float2));
+	objArenaInit(&state->normals, sizeof(float3));
+	objArenaInit(&state->tangents, sizeof(float3));
+	objArenaInit(&state->bitangents, sizeof(float3));
+	objArenaInit(&state->faces, sizeof(face));
+	objArenaInit(&state->relative, sizeof(objRelativeIndex));
+	state->scale = scale;
+	state->failed = 0;
+}
+
+static void objParseStateRelease(objParseState *state)
+{
+	objArenaRelease(&state->positions);
+	objArenaRelease(&state->texcoords);
+	objArenaRelease(&state->normals);
+	objArenaRelease(&state->tangents);
+	objArenaRelease(&state->bitangents);
+	objArenaRelease(&state->faces);
+	objArenaRelease(&state->relative);
+}
 
 
 //-----------------------------------------------------------------------------
+// file mapping
 
+// map a whole file copy-on-write: it reads like memory and can be written 
+//	to without touching the file
+// returns base address and sets 'size_out', or returns null if failed
+// empty files can't be mapped, so they fail too
+static void *objMapFile(const char *path, unsigned long long *size_out)
+{
+	void *base = 0;
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER size;
 
-#define BUFFER_SIZE 2048
-#define LINE_SIZE 64
+	*size_out = 0;
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
 
-// ****
-// load triangulated OBJ file
-egpTriOBJDescriptor egpfwLoadTriangleOBJ(const char *objPath, const egpMeshNormalMode normalMode, const double globalScale)
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if (mapping)
+		{
+			base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);
+			if (base)
+				*size_out = (unsigned long long)size.QuadPart;
+		}
+	}
+	CloseHandle(file);
+#else	// !_WIN32
+	struct stat info;
+	int file = open(path, O_RDONLY);
+
+	*size_out = 0;
+	if (file < 0)
+		return 0;
+
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		base = mmap(0, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		if (base != MAP_FAILED)
+			*size_out = (unsigned long long)info.st_size;
+		else
+			base = 0;
+	}
+	close(file);
+#endif	// _WIN32
+
+	return base;
+}
+
+static void objUnmapFile(void *base, const unsigned long long size)
 {
-	egpTriOBJDescriptor obj = { 0 };
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else	// !_WIN32
+	munmap(base, (size_t)size);
+#endif	// _WIN32
+}
 
-	unsigned int numVerticies, numTexcoords, numNormals, numFaces;
-	float3 vertexBuffer[BUFFER_SIZE]; //load a (relatively) large buffer for the verticies
-	float2 vertexTexBuffer[BUFFER_SIZE]; //load a (relatively) large buffer for the verticies
-	float3 vertexNorBuffer[BUFFER_SIZE]; //load a (relatively) large buffer for the verticies
-	face faceBuffer[BUFFER_SIZE]; //load a (relatively) large buffer for the faces
-	
-	FILE* objFile;
-	char lineBuffer[LINE_SIZE];
-	float3 currentF3 = { 0 };
-	float2 currentF2 = { 0 };
-	face f = { 0 };
 
-	int i = 0;
+//-----------------------------------------------------------------------------
+// tokenizer
+// hand-written because sscanf is by far the slowest part of loading big files
+// every function stops at the end of the line or the end of the range
 
-	//Load our file handle
-	objFile = fopen(objPath, "r");
-	if (objFile == NULL)
+static const char *objSkipSpace(const char *c, const char *end)
+{
+	while (c < end && (*c == ' ' || *c == '\t' || *c == '\r'))
+		++c;
+	return c;
+}
+
+static const char *objSkipLine(const char *c, const char *end)
+{
+	while (c < end && *c != '\n')
+		++c;
+	return (c < end) ? c + 1 : end;
+}
+
+static const char *objParseInt(const char *c, const char *end, int *i_out)
+{
+	int value = 0, negative = 0;
+	if (c < end && (*c == '-' || *c == '+'))
+		negative = (*c++ == '-');
+	while (c < end && *c >= '0' && *c <= '9')
+		value = value * 10 + (*c++ - '0');
+	*i_out = negative ? -value : value;
+	return c;
+}
+
+static const char *objParseFloat(const char *c, const char *end, float *f_out)
+{
+	// exact powers of ten, anything bigger falls back on pow
+	static const double objPow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	unsigned long long mantissa = 0;
+	int negative = 0, exponent = 0, digits = 0, e;
+	double value;
+
+	c = objSkipSpace(c, end);
+	if (c < end && (*c == '-' || *c == '+'))
+		negative = (*c++ == '-');
+
+	// integer part, then fraction; digits past what fits in 64 bits are dropped
+	for (; c < end && *c >= '0' && *c <= '9'; ++c)
 	{
-		printf("Unable to open file %s.\n", objPath);
-		return obj;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*c - '0');
+			++digits;
+		}
+		else
+			++exponent;
+	}
+	if (c < end && *c == '.')
+	{
+		for (++c; c < end && *c >= '0' && *c <= '9'; ++c)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*c - '0');
+				++digits;
+				--exponent;
+			}
+		}
 	}
 
-	//Skip the junk, go to the first line that has a vertex.
-	while (lineBuffer[0] != 'v' && fgets(lineBuffer, 64, objFile) != NULL) {}
+	if (c < end && (*c == 'e' || *c == 'E'))
+	{
+		c = objParseInt(c + 1, end, &e);
+		exponent += e;
+	}
+
+	value = (double)mantissa;
+	if (exponent < 0)
+		value = (exponent >= -22) ? value / objPow10[-exponent] : value * pow(10.0, exponent);
+	else if (exponent > 0)
+		value = (exponent <= 22) ? value * objPow10[exponent] : value * pow(10.0, exponent);
 
-	//Load all the verticies into vertexBuffer
-	while (lineBuffer[0] == 'v' && lineBuffer[1] == ' ')
+	*f_out = (float)(negative ? -value : value);
+	return c;
+}
+
+// OBJ indices start at 1; negative indices count back from the newest element
+// a negative index comes back as a signed offset from the start of this 
+//	parse state's data and sets 'relativeBit' in 'relative_out'
+static unsigned int objResolveIndex(const int index, const unsigned int count, unsigned int *relative_out, const unsigned int relativeBit)
+{
+	if (index > 0)
+		return (unsigned int)(index - 1);
+	if (index < 0)
 	{
-		//Scan the line data into currentF3 then put that in the buffer.
-		sscanf(lineBuffer, "%*s %f %f %f", &currentF3.f0, &currentF3.f1, &currentF3.f2);
-		vertexBuffer[i] = currentF3;
-		i++;
+		*relative_out |= relativeBit;
+		return (unsigned int)((int)count + index);
+	}
+	return OBJ_INDEX_MISSING;
+}
 
-		if (i >= BUFFER_SIZE)
+// parse one face corner: v, v/vt, v//vn or v/vt/vn
+// 'relative_out' gets bit 0, 1 or 2 set if v, vt or vn was negative
+static const char *objParseCorner(const char *c, const char *end, const objParseState *state, unsigned int *v, unsigned int *vt, unsigned int *vn, unsigned int *relative_out)
+{
+	int index;
+	*vt = *vn = OBJ_INDEX_MISSING;
+	*relative_out = 0;
+
+	c = objParseInt(c, end, &index);
+	*v = objResolveIndex(index, state->positions.count, relative_out, 1);
+	if (c < end && *c == '/')
+	{
+		if (++c < end && *c != '/')
+		{
+			c = objParseInt(c, end, &index);
+			*vt = objResolveIndex(index, state->texcoords.count, relative_out, 2);
+		}
+		if (c < end && *c == '/')
+		{
+			c = objParseInt(c + 1, end, &index);
+			*vn = objResolveIndex(index, state->normals.count, relative_out, 4);
+		}
+	}
+	return c;
+}
+
+// parse a face line, fanning polygons with more than three corners into triangles
+static const char *objParseFace(const char *c, const char *end, objParseState *state)
+{
+	unsigned int v[3], vt[3], vn[3], relative[3], corner = 0, i;
+	objRelativeIndex *r;
+	face *f;
+
+	for (c = objSkipSpace(c, end); c < end && *c != '\n'; c = objSkipSpace(c, end))
+	{
+		// first corner stays put, the last two slide along the polygon
+		const unsigned int slot = (corner < 3) ? corner : 2;
+		if (corner >= 3)
+		{
+			v[1] = v[2];
+			vt[1] = vt[2];
+			vn[1] = vn[2];
+			relative[1] = relative[2];
+		}
+
+		c = objParseCorner(c, end, state, v + slot, vt + slot, vn + slot, relative + slot);
+		if (v[slot] == OBJ_INDEX_MISSING && !(relative[slot] & 1))
+			return c;
+
+		if (++corner >= 3)
+		{
+			f = (face *)objArenaPush(&state->faces);
+			if (!f)
+			{
+				state->failed = 1;
+				return end;
+			}
+			memcpy(f->v, v, sizeof(v));
+			memcpy(f->vt, vt, sizeof(vt));
+			memcpy(f->vn, vn, sizeof(vn));
+
+			//Remember which entries still need rebasing.
+			for (i = 0; i < 9; ++i)
+				if (relative[i % 3] & (1u << (i / 3)))
+				{
+					if (!(r = (objRelativeIndex *)objArenaPush(&state->relative)))
+					{
+						state->failed = 1;
+						return end;
+					}
+					r->face = state->faces.count - 1;
+					r->entry = i;
+				}
+		}
+	}
+	return c;
+}
+
+// parse every line in a range of text
+// the range must end on a line break or at the end of the file
+static void objParseRange(const char *c, const char *end, objParseState *state)
+{
+	float *f;
+	while (c < end && !state->failed)
+	{
+		c = objSkipSpace(c, end);
+		if (end - c > 2 && c[0] == 'v' && (c[1] == ' ' || c[1] == '\t'))
+		{
+			if ((f = (float *)objArenaPush(&state->positions)) != 0)
+			{
+				c = objParseFloat(c + 2, end, f + 0);
+				c = objParseFloat(c, end, f + 1);
+				c = objParseFloat(c, end, f + 2);
+				f[0] *= state->scale;
+				f[1] *= state->scale;
+				f[2] *= state->scale;
+			}
+			else
+				state->failed = 1;
+		}
+		else if (end - c > 3 && c[0] == 'v' && c[1] == 't' && (c[2] == ' ' || c[2] == '\t'))
+		{
+			if ((f = (float *)objArenaPush(&state->texcoords)) != 0)
+			{
+				c = objParseFloat(c + 3, end, f + 0);
+				c = objParseFloat(c, end, f + 1);
+			}
+			else
+				state->failed = 1;
+		}
+		else if (end - c > 3 && c[0] == 'v' && c[1] == 'n' && (c[2] == ' ' || c[2] == '\t'))
 		{
-			printf("Number of verticies in .obj overflowed buffer: %s", objPath);
-			return obj;
+			if ((f = (float *)objArenaPush(&state->normals)) != 0)
+			{
+				c = objParseFloat(c + 3, end, f + 0);
+				c = objParseFloat(c, end, f + 1);
+				c = objParseFloat(c, end, f + 2);
+			}
+			else
+				state->failed = 1;
 		}
+		else if (end - c > 2 && c[0] == 'f' && (c[1] == ' ' || c[1] == '\t'))
+			c = objParseFace(c + 2, end, state);
+
+		// anything else (comments, groups, materials) is ignored
+		c = objSkipLine(c, end);
+	}
+}
 
-		if (fgets(lineBuffer, LINE_SIZE, objFile) == NULL)
-			break; //hit the end of the file early
+// turn a parse state's relative indices into absolute ones
+// 'faces' is where that state's faces ended up, 'base' is how many 
+//	positions, texcoords and normals came before its own
+// anything that counts back past the first element becomes missing
+static void objRebaseIndices(face *faces, const objArena *relative, const unsigned int base[3])
+{
+	const objRelativeIndex *r = (const objRelativeIndex *)relative->data, *const rEnd = r + relative->count;
+	unsigned int *entry;
+	int index;
+	for (; r < rEnd; ++r)
+	{
+		entry = (unsigned int *)(faces + r->face) + r->entry;
+		index = (int)*entry + (int)base[r->entry / 3];
+		*entry = (index >= 0) ? (unsigned int)index : OBJ_INDEX_MISSING;
 	}
+}
+
+// make sure every face corner points at real data
+// corners without a texcoord or normal share one default element appended to that arena
+// returns 1 if all indices are valid, 0 if not
+static int objValidateFaces(objParseState *state)
+{
+	face *f = (face *)state->faces.data, *const fEnd = f + state->faces.count;
+	unsigned int i, defaultTexcoord = OBJ_INDEX_MISSING, defaultNormal = OBJ_INDEX_MISSING;
+	float *element;
+
+	for (; f < fEnd; ++f)
+		for (i = 0; i < 3; ++i)
+		{
+			if (f->v[i] >= state->positions.count)
+				return 0;
+
+			if (f->vt[i] == OBJ_INDEX_MISSING)
+			{
+				if (defaultTexcoord == OBJ_INDEX_MISSING)
+				{
+					if (!(element = (float *)objArenaPush(&state->texcoords)))
+						return 0;
+					element[0] = element[1] = 0.0f;
+					defaultTexcoord = state->texcoords.count - 1;
+				}
+				f->vt[i] = defaultTexcoord;
+			}
+			else if (f->vt[i] >= state->texcoords.count)
+				return 0;
+
+			if (f->vn[i] == OBJ_INDEX_MISSING)
+			{
+				if (defaultNormal == OBJ_INDEX_MISSING)
+				{
+					if (!(element = (float *)objArenaPush(&state->normals)))
+						return 0;
+					element[0] = element[1] = 0.0f;
+					element[2] = 1.0f;
+					defaultNormal = state->normals.count - 1;
+				}
+				f->vn[i] = defaultNormal;
+			}
+			else if (f->vn[i] >= state->normals.count)
+				return 0;
+		}
+	return 1;
+}
 
-	numVerticies = i;
-	i = 0;
 
-	//Load all the texcoords into vertexTexBuffer
-	while (lineBuffer[0] == 'v' && lineBuffer[1] == 't')
+//-----------------------------------------------------------------------------
+// jobs
+// a fixed batch of jobs: the caller runs the first, one thread runs each of 
+//	the rest, and everything is joined before returning
+// if a thread can't be started its job just runs on the caller
+
+// upper bound on worker threads, and the least work worth giving one
+#define OBJ_MAX_THREADS			8
+#define OBJ_FACES_PER_THREAD	16384
+
+typedef void(*objJobFunc)(void *job);
+
+struct objThread
+{
+	objJobFunc func;
+	void *job;
+#ifdef _WIN32
+	HANDLE handle;
+#else	// !_WIN32
+	pthread_t handle;
+#endif	// _WIN32
+	int started;
+};
+
+#ifndef __cplusplus
+typedef struct objThread objThread;
+#endif	// __cplusplus
+
+
+#ifdef _WIN32
+static DWORD WINAPI objThreadEntry(LPVOID param)
+{
+	objThread *thread = (objThread *)param;
+	thread->func(thread->job);
+	return 0;
+}
+#else	// !_WIN32
+static void *objThreadEntry(void *param)
+{
+	objThread *thread = (objThread *)param;
+	thread->func(thread->job);
+	return 0;
+}
+#endif	// _WIN32
+
+// how many threads to split 'workCount' items across
+static unsigned int objThreadCount(const unsigned int workCount, const unsigned int workPerThread)
+{
+	unsigned int cores, count = workCount / workPerThread;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	cores = (unsigned int)info.dwNumberOfProcessors;
+#else	// !_WIN32
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	cores = (online > 0) ? (unsigned int)online : 1;
+#endif	// _WIN32
+	if (count > cores)
+		count = cores;
+	if (count > OBJ_MAX_THREADS)
+		count = OBJ_MAX_THREADS;
+	return count ? count : 1;
+}
+
+// run 'numJobs' jobs of 'jobSize' bytes each, laid out contiguously
+static void objRunJobs(const objJobFunc func, void *jobs, const unsigned int jobSize, const unsigned int numJobs)
+{
+	objThread threads[OBJ_MAX_THREADS];
+	unsigned int i;
+
+	for (i = 1; i < numJobs; ++i)
 	{
-		//Scan the line data into currentF2 then put that in the buffer.
-		sscanf(lineBuffer, "%*s %f %f", &currentF2.f0, &currentF2.f1);
-		vertexTexBuffer[i] = currentF2;
-		i++;
+		threads[i].func = func;
+		threads[i].job = (char *)jobs + jobSize * i;
+#ifdef _WIN32
+		threads[i].handle = CreateThread(0, 0, objThreadEntry, threads + i, 0, 0);
+		threads[i].started = (threads[i].handle != 0);
+#else	// !_WIN32
+		threads[i].started = (pthread_create(&threads[i].handle, 0, objThreadEntry, threads + i) == 0);
+#endif	// _WIN32
+		if (!threads[i].started)
+			func(threads[i].job);
+	}
+
+	func(jobs);
 
-		if (i >= BUFFER_SIZE)
+	for (i = 1; i < numJobs; ++i)
+		if (threads[i].started)
 		{
-			printf("Number of texcoords in .obj overflowed buffer: %s", objPath);
-			return obj;
+#ifdef _WIN32
+			WaitForSingleObject(threads[i].handle, INFINITE);
+			CloseHandle(threads[i].handle);
+#else	// !_WIN32
+			pthread_join(threads[i].handle, 0);
+#endif	// _WIN32
 		}
-		
-		if (fgets(lineBuffer, LINE_SIZE, objFile) == NULL)
-			break; //hit the end of the file early
+}
+
+
+//-----------------------------------------------------------------------------
+// chunked parsing
+// a mapped file is cut into one chunk per thread, each ending on a line break
+// every chunk is parsed into its own state, then the states are appended in 
+//	file order; positive indices are absolute already, so only the negative 
+//	ones recorded by each chunk need rebasing onto what came before it
+
+// the least text worth giving a thread
+#define OBJ_BYTES_PER_THREAD	(1 << 20)
+
+struct objParseJob
+{
+	const char *begin, *end;
+	objParseState state;
+};
+
+#ifndef __cplusplus
+typedef struct objParseJob objParseJob;
+#endif	// __cplusplus
+
+
+static void objParseJobFunc(void *param)
+{
+	objParseJob *job = (objParseJob *)param;
+	objParseRange(job->begin, job->end, &job->state);
+}
+
+// parse a whole file that is already in memory
+// 'state' must be initialized and empty; it receives the stitched result
+static void objParseText(const char *text, const unsigned long long size, objParseState *state)
+{
+	const char *const end = text + size;
+	objParseJob jobs[OBJ_MAX_THREADS];
+	unsigned int numJobs = objThreadCount((size > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (unsigned int)size, OBJ_BYTES_PER_THREAD);
+	unsigned int base[3] = { 0 }, faceBase, i;
+
+	//Cut at even intervals, then push each cut past the end of its line.
+	for (i = 0; i < numJobs; ++i)
+	{
+		jobs[i].begin = i ? jobs[i - 1].end : text;
+		jobs[i].end = (i + 1 < numJobs) ? text + size * (i + 1) / numJobs : end;
+		if (jobs[i].end < jobs[i].begin)
+			jobs[i].end = jobs[i].begin;
+		while (jobs[i].end < end && jobs[i].end > jobs[i].begin && jobs[i].end[-1] != '\n')
+			++jobs[i].end;
+		if (i)
+			objParseStateInit(&jobs[i].state, state->scale);
 	}
+	jobs[0].state = *state;
 
-	numTexcoords = i;
-	i = 0;
-	
-	//Load all the normals into vertexNorBuffer
-	while (lineBuffer[0] == 'v' && lineBuffer[1] == 'n')
+	objRunJobs(objParseJobFunc, jobs, sizeof(objParseJob), numJobs);
+
+	//The first chunk's data stays where it is; the rest is appended after it.
+	*state = jobs[0].state;
+	objRebaseIndices((face *)state->faces.data, &state->relative, base);
+	for (i = 1; i < numJobs; ++i)
 	{
-		//Scan the line data into currentF3 then put that in the buffer.
-		sscanf(lineBuffer, "%*s %f %f %f", &currentF3.f0, &currentF3.f1, &currentF3.f2);
-		vertexNorBuffer[i] = currentF3;
-		i++;
+		base[0] = state->positions.count;
+		base[1] = state->texcoords.count;
+		base[2] = state->normals.count;
+		faceBase = state->faces.count;
+
+		if (!state->failed && !jobs[i].state.failed &&
+			objArenaAppend(&state->positions, &jobs[i].state.positions) &&
+			objArenaAppend(&state->texcoords, &jobs[i].state.texcoords) &&
+			objArenaAppend(&state->normals, &jobs[i].state.normals) &&
+			objArenaAppend(&state->faces, &jobs[i].state.faces))
+			objRebaseIndices((face *)state->faces.data + faceBase, &jobs[i].state.relative, base);
+		else
+			state->failed = 1;
+
+		objParseStateRelease(&jobs[i].state);
+	}
+	state->relative.count = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// normal and tangent generation
+// runs on the parsed data before welding: the computed vectors replace the 
+//	file's normals and every face corner's normal index is pointed at them, 
+//	so welding splits or merges vertices exactly as the mode requires
+// face modes produce one vector per face, vertex modes one per position
+// positions and texcoords are copied to SoA arrays first; the face pass then 
+//	splits faces across threads, and in vertex modes each thread sums into 
+//	its own set of per-position arrays so no atomics are needed; a second 
+//	pass splits the outputs across threads to add up those sets and 
+//	normalize (and orthogonalize tangents)
+
+// one set of SoA vectors; tangent and bitangent are null if not needed
+struct objBasisArrays
+{
+	float *nx, *ny, *nz, *tx, *ty, *tz, *bx, *by, *bz;
+};
+
+struct objBasisJob
+{
+	// face pass
+	const face *faces;
+	unsigned int faceStart, faceEnd;
+	const float *px, *py, *pz, *u, *v;
+	int perVertex;
+
+	// resolve pass sums 'numSets' sets into the first one
+	const struct objBasisArrays *sets;
+	unsigned int numSets, elemStart, elemEnd;
+
+	// accumulation target for the face pass
+	struct objBasisArrays out;
+};
+
+#ifndef __cplusplus
+typedef struct objBasisArrays	objBasisArrays;
+typedef struct objBasisJob		objBasisJob;
+#endif	// __cplusplus
+
 
-		if (i >= BUFFER_SIZE)
+// face pass
+// per face: area-weighted normal (the raw cross product), tangent and 
+//	bitangent from the texcoord gradient
+// in face mode the result is written at the face's index; in vertex mode it 
+//	is added to each of the face's positions
+static void objBasisFaceJob(void *param)
+{
+	const objBasisJob *job = (const objBasisJob *)param;
+	const objBasisArrays *out = &job->out;
+	const face *f;
+	unsigned int i, c, k, i0, i1, i2;
+	float e1x, e1y, e1z, e2x, e2y, e2z, du1, dv1, du2, dv2, r;
+	float nx, ny, nz, tx = 0.0f, ty = 0.0f, tz = 0.0f, bx = 0.0f, by = 0.0f, bz = 0.0f;
+
+	for (i = job->faceStart; i < job->faceEnd; ++i)
+	{
+		f = job->faces + i;
+		i0 = f->v0;
+		i1 = f->v1;
+		i2 = f->v2;
+		e1x = job->px[i1] - job->px[i0];	e1y = job->py[i1] - job->py[i0];	e1z = job->pz[i1] - job->pz[i0];
+		e2x = job->px[i2] - job->px[i0];	e2y = job->py[i2] - job->py[i0];	e2z = job->pz[i2] - job->pz[i0];
+		nx = e1y * e2z - e1z * e2y;
+		ny = e1z * e2x - e1x * e2z;
+		nz = e1x * e2y - e1y * e2x;
+
+		if (out->tx)
 		{
-			printf("Number of normals in .obj overflowed buffer: %s", objPath);
-			return obj;
+			//Lengyel's method; faces with no texcoord area add nothing.
+			du1 = job->u[f->vt1] - job->u[f->vt0];	dv1 = job->v[f->vt1] - job->v[f->vt0];
+			du2 = job->u[f->vt2] - job->u[f->vt0];	dv2 = job->v[f->vt2] - job->v[f->vt0];
+			r = du1 * dv2 - du2 * dv1;
+			r = (r > 1e-12f || r < -1e-12f) ? 1.0f / r : 0.0f;
+			tx = (e1x * dv2 - e2x * dv1) * r;	ty = (e1y * dv2 - e2y * dv1) * r;	tz = (e1z * dv2 - e2z * dv1) * r;
+			bx = (e2x * du1 - e1x * du2) * r;	by = (e2y * du1 - e1y * du2) * r;	bz = (e2z * du1 - e1z * du2) * r;
 		}
 
-		if (fgets(lineBuffer, LINE_SIZE, objFile) == NULL)
-			break; //hit the end of the file early
+		for (c = 0; c < (job->perVertex ? 3u : 1u); ++c)
+		{
+			k = job->perVertex ? f->v[c] : i;
+			out->nx[k] += nx;	out->ny[k] += ny;	out->nz[k] += nz;
+			if (out->tx)
+			{
+				out->tx[k] += tx;	out->ty[k] += ty;	out->tz[k] += tz;
+				out->bx[k] += bx;	out->by[k] += by;	out->bz[k] += bz;
+			}
+		}
 	}
+}
 
-	numNormals = i;
-	i = 0;
+// resolve pass
+// sum every set into the first, then normalize; tangents are made 
+//	orthogonal to the normal and the bitangent is rebuilt from both, keeping 
+//	the handedness of the accumulated one
+static void objBasisResolveJob(void *param)
+{
+	const objBasisJob *job = (const objBasisJob *)param;
+	const objBasisArrays *sum = job->sets, *set;
+	unsigned int i, s;
+	float nx, ny, nz, tx, ty, tz, bx, by, bz, d, len;
 
-	//skip the junk in the middle and go to the faces
-	while (lineBuffer[0] != 'f' && fgets(lineBuffer, 64, objFile) != NULL) {}
+	for (s = 1; s < job->numSets; ++s)
+	{
+		set = job->sets + s;
+		for (i = job->elemStart; i < job->elemEnd; ++i)
+		{
+			sum->nx[i] += set->nx[i];	sum->ny[i] += set->ny[i];	sum->nz[i] += set->nz[i];
+		}
+		if (sum->tx)
+			for (i = job->elemStart; i < job->elemEnd; ++i)
+			{
+				sum->tx[i] += set->tx[i];	sum->ty[i] += set->ty[i];	sum->tz[i] += set->tz[i];
+				sum->bx[i] += set->bx[i];	sum->by[i] += set->by[i];	sum->bz[i] += set->bz[i];
+			}
+	}
 
-	//Load all the faces into faceBuffer
-	while (lineBuffer[0] == 'f' && lineBuffer[1] == ' ')
+	for (i = job->elemStart; i < job->elemEnd; ++i)
 	{
-		//Scan the line data into temporary face then put that in the buffer.
-		sscanf(lineBuffer,
-			"%*s %i %*c %i %*c %i %i %*c %i %*c %i %i %*c %i %*c %i",
-			&f.v0, &f.vt0, &f.vn0,
-			&f.v1, &f.vt1, &f.vn1,
-			&f.v2, &f.vt2, &f.vn2);
+		//Unused positions and degenerate faces get +Z.
+		nx = sum->nx[i];	ny = sum->ny[i];	nz = sum->nz[i];
+		len = nx * nx + ny * ny + nz * nz;
+		len = (len > 0.0f) ? 1.0f / sqrtf(len) : 0.0f;
+		nx *= len;	ny *= len;	nz = (len > 0.0f) ? nz * len : 1.0f;
+		sum->nx[i] = nx;	sum->ny[i] = ny;	sum->nz[i] = nz;
+	}
 
-		//For some stupid reason, the faces are 1-indexed.
-		//Decrement everything so that they're 0-indexed.
-		--f.v0; --f.vt0; --f.vn0;
-		--f.v1; --f.vt1; --f.vn1;
-		--f.v2; --f.vt2; --f.vn2;
+	if (sum->tx)
+		for (i = job->elemStart; i < job->elemEnd; ++i)
+		{
+			nx = sum->nx[i];	ny = sum->ny[i];	nz = sum->nz[i];
+			tx = sum->tx[i];	ty = sum->ty[i];	tz = sum->tz[i];
+			d = nx * tx + ny * ty + nz * tz;
+			tx -= nx * d;	ty -= ny * d;	tz -= nz * d;
+			len = tx * tx + ty * ty + tz * tz;
+			if (len < 1e-20f)
+			{
+				//No usable texcoords: project X (or Y if the normal is close to X) onto the surface.
+				bx = (nx > 0.9f || nx < -0.9f) ? 0.0f : 1.0f;
+				by = 1.0f - bx;
+				d = nx * bx + ny * by;
+				tx = bx - nx * d;	ty = by - ny * d;	tz = -nz * d;
+				len = tx * tx + ty * ty + tz * tz;
+			}
+			len = 1.0f / sqrtf(len);
+			tx *= len;	ty *= len;	tz *= len;
+
+			bx = ny * tz - nz * ty;
+			by = nz * tx - nx * tz;
+			bz = nx * ty - ny * tx;
+			d = (bx * sum->bx[i] + by * sum->by[i] + bz * sum->bz[i] < 0.0f) ? -1.0f : 1.0f;
+
+			sum->tx[i] = tx;	sum->ty[i] = ty;	sum->tz[i] = tz;
+			sum->bx[i] = bx * d;	sum->by[i] = by * d;	sum->bz[i] = bz * d;
+		}
+}
 
-		faceBuffer[i] = f;
-		i++;
+// replace the parsed normals with computed ones, adding tangents if asked
+// returns 1 if successful, 0 if out of memory
+static int objComputeBasis(objParseState *state, const egpMeshNormalMode normalMode)
+{
+	const int perVertex = (normalMode == NORMAL_COMPUTE_VERTEX || normalMode == NORMAL_COMPUTE_TANGENT_VERTEX);
+	const int tangents = (normalMode == NORMAL_COMPUTE_TANGENT_FACE || normalMode == NORMAL_COMPUTE_TANGENT_VERTEX);
+	const unsigned int faceCount = state->faces.count, positionCount = state->positions.count, texcoordCount = state->texcoords.count;
+	const unsigned int elemCount = perVertex ? positionCount : faceCount, numVectors = tangents ? 9 : 3;
+	const float3 *positions = (const float3 *)state->positions.data;
+	const float2 *texcoords = (const float2 *)state->texcoords.data;
+	objBasisArrays sets[OBJ_MAX_THREADS];
+	objBasisJob jobs[OBJ_MAX_THREADS];
+	unsigned int numThreads, numSets, i, s;
+	float *soa, *next, *vector;
+	face *f;
+
+	//Vertex modes need one accumulation set per thread; face modes write disjoint faces into one set.
+	numThreads = objThreadCount(faceCount, OBJ_FACES_PER_THREAD);
+	numSets = perVertex ? numThreads : 1;
+
+	soa = (float *)calloc((size_t)positionCount * 3 + (size_t)texcoordCount * 2 + (size_t)elemCount * numVectors * numSets, sizeof(float));
+	if (!soa)
+		return 0;
+
+	memset(jobs, 0, sizeof(jobs));
+	jobs[0].px = soa;
+	jobs[0].py = jobs[0].px + positionCount;
+	jobs[0].pz = jobs[0].py + positionCount;
+	jobs[0].u = jobs[0].pz + positionCount;
+	jobs[0].v = jobs[0].u + texcoordCount;
+	for (i = 0; i < positionCount; ++i)
+	{
+		soa[i] = positions[i].f0;
+		soa[i + positionCount] = positions[i].f1;
+		soa[i + positionCount * 2] = positions[i].f2;
+	}
+	for (i = 0, next = soa + positionCount * 3; i < texcoordCount; ++i)
+	{
+		next[i] = texcoords[i].f0;
+		next[i + texcoordCount] = texcoords[i].f1;
+	}
 
-		if (i >= BUFFER_SIZE)
+	for (s = 0, next = soa + positionCount * 3 + texcoordCount * 2; s < numSets; ++s)
+	{
+		sets[s].nx = next;	sets[s].ny = next + elemCount;	sets[s].nz = next + elemCount * 2;
+		next += elemCount * 3;
+		if (tangents)
 		{
-			printf("Number of faces in .obj overflowed buffer: %s", objPath);
-			return obj;
+			sets[s].tx = next;	sets[s].ty = next + elemCount;	sets[s].tz = next + elemCount * 2;
+			sets[s].bx = next + elemCount * 3;	sets[s].by = next + elemCount * 4;	sets[s].bz = next + elemCount * 5;
+			next += elemCount * 6;
 		}
+		else
+			sets[s].tx = sets[s].ty = sets[s].tz = sets[s].bx = sets[s].by = sets[s].bz = 0;
+	}
 
-		if (fgets(lineBuffer, LINE_SIZE, objFile) == NULL)
+	for (i = 0; i < numThreads; ++i)
+	{
+		jobs[i] = jobs[0];
+		jobs[i].faces = (const face *)state->faces.data;
+		jobs[i].faceStart = (unsigned int)((unsigned long long)faceCount * i / numThreads);
+		jobs[i].faceEnd = (unsigned int)((unsigned long long)faceCount * (i + 1) / numThreads);
+		jobs[i].perVertex = perVertex;
+		jobs[i].out = sets[perVertex ? i : 0];
+		jobs[i].sets = sets;
+		jobs[i].numSets = numSets;
+		jobs[i].elemStart = (unsigned int)((unsigned long long)elemCount * i / numThreads);
+		jobs[i].elemEnd = (unsigned int)((unsigned long long)elemCount * (i + 1) / numThreads);
+	}
+	objRunJobs(objBasisFaceJob, jobs, sizeof(objBasisJob), numThreads);
+	objRunJobs(objBasisResolveJob, jobs, sizeof(objBasisJob), numThreads);
+
+	//Swap the results in for the file's normals, back in AoS.
+	state->normals.count = 0;
+	for (i = 0; i < elemCount; ++i)
+	{
+		if (!(vector = (float *)objArenaPush(&state->normals)))
 			break;
+		vector[0] = sets[0].nx[i];	vector[1] = sets[0].ny[i];	vector[2] = sets[0].nz[i];
+		if (tangents)
+		{
+			if (!(vector = (float *)objArenaPush(&state->tangents)))
+				break;
+			vector[0] = sets[0].tx[i];	vector[1] = sets[0].ty[i];	vector[2] = sets[0].tz[i];
+			if (!(vector = (float *)objArenaPush(&state->bitangents)))
+				break;
+			vector[0] = sets[0].bx[i];	vector[1] = sets[0].by[i];	vector[2] = sets[0].bz[i];
+		}
 	}
+	free(soa);
+	if (i < elemCount)
+		return 0;
 
-	numFaces = i;
-	i = 0;
+	for (i = 0, f = (face *)state->faces.data; i < faceCount; ++i, ++f)
+	{
+		f->vn0 = perVertex ? f->v0 : i;
+		f->vn1 = perVertex ? f->v1 : i;
+		f->vn2 = perVertex ? f->v2 : i;
+	}
+	return 1;
+}
+
+
+// hash a face corner for welding
+static unsigned int objHashCorner(const unsigned int v, const unsigned int vt, const unsigned int vn)
+{
+	unsigned int h = (v * 0x9E3779B1u) ^ (vt * 0x85EBCA77u) ^ (vn * 0xC2B2AE3Du);
+	return h ^ (h >> 15);
+}
+
+// put a unique vertex in the first free slot of its hash chain
+static void objHashInsert(unsigned int *table, const unsigned int mask, const uniqueVertex *u)
+{
+	unsigned int h = objHashCorner(u->v, u->vt, u->vn) & mask;
+	while (table[h] != OBJ_INDEX_MISSING)
+		h = (h + 1) & mask;
+	table[h] = u->index;
+}
+
+// weld every face corner into unique vertices
+// 'vertices' receives one entry per unique (v, vt, vn) triple in order of 
+//	first use, 'indices' receives three entries per face
+// returns 1 if successful, 0 if out of memory
+static int objWeld(const objParseState *state, objArena *vertices, unsigned int *indices)
+{
+	const face *f = (const face *)state->faces.data, *const fEnd = f + state->faces.count;
+	unsigned int *table, *resized, capacity, mask, h, i, c;
+	uniqueVertex *u;
+
+	//Open addressing, kept at most half full. Most meshes weld down to about as many
+	//vertices as they have positions, so start there and grow if needed.
+	for (capacity = OBJ_ARENA_SIZE; capacity < state->positions.count * 2; capacity *= 2);
+	table = (unsigned int *)malloc(sizeof(unsigned int) * capacity);
+	if (!table)
+		return 0;
+	memset(table, 0xFF, sizeof(unsigned int) * capacity);
+	mask = capacity - 1;
+
+	for (; f < fEnd; ++f)
+		for (c = 0; c < 3; ++c)
+		{
+			h = objHashCorner(f->v[c], f->vt[c], f->vn[c]) & mask;
+			for (; table[h] != OBJ_INDEX_MISSING; h = (h + 1) & mask)
+			{
+				u = (uniqueVertex *)vertices->data + table[h];
+				if (u->v == f->v[c] && u->vt == f->vt[c] && u->vn == f->vn[c])
+					break;
+			}
+
+			if (table[h] == OBJ_INDEX_MISSING)
+			{
+				//New vertex. Grow the table first if this would make it more than half full.
+				if ((vertices->count + 1) * 2 > capacity)
+				{
+					resized = (unsigned int *)malloc(sizeof(unsigned int) * capacity * 2);
+					if (!resized)
+					{
+						free(table);
+						return 0;
+					}
+					free(table);
+					table = resized;
+					capacity *= 2;
+					mask = capacity - 1;
+					memset(table, 0xFF, sizeof(unsigned int) * capacity);
+					for (i = 0; i < vertices->count; ++i)
+						objHashInsert(table, mask, (uniqueVertex *)vertices->data + i);
+				}
+
+				if (!(u = (uniqueVertex *)objArenaPush(vertices)))
+				{
+					free(table);
+					return 0;
+				}
+				u->v = f->v[c];
+				u->vt = f->vt[c];
+				u->vn = f->vn[c];
+				u->index = vertices->count - 1;
+				objHashInsert(table, mask, u);
+			}
+			else
+				u = (uniqueVertex *)vertices->data + table[h];
+
+			*(indices++) = u->index;
+		}
+
+	free(table);
+	return 1;
+}
+
+// weld the parsed data and pack it into the descriptor
+// layout: [objDataHeader][indices][positions][texcoords][normals][tangents][bitangents]
+// tangents and bitangents are only there if the parse state has them
+// indices are 16-bit if every vertex can be addressed with 16 bits, 32-bit otherwise
+// returns 1 if successful, 0 if out of memory
+static int objBuildDescriptor(const objParseState *state, egpTriOBJDescriptor *obj)
+{
+	const float3 *positions = (const float3 *)state->positions.data, *normals = (const float3 *)state->normals.data;
+	const float3 *tangents = (const float3 *)state->tangents.data, *bitangents = (const float3 *)state->bitangents.data;
+	const float2 *texcoords = (const float2 *)state->texcoords.data;
+	const uniqueVertex *u;
+	objDataHeader *header;
+	objArena vertices;
+	unsigned int *indices, indexCount = state->faces.count * 3, vertexCount, indexSize, i;
+	float3 *pos, *nor, *tan = 0, *bit = 0;
+	float2 *tex;
+	unsigned short *index16;
+
+	indices = (unsigned int *)malloc(sizeof(unsigned int) * indexCount);
+	if (!indices)
+		return 0;
+
+	objArenaInit(&vertices, sizeof(uniqueVertex));
+	if (!objWeld(state, &vertices, indices))
+	{
+		objArenaRelease(&vertices);
+		free(indices);
+		return 0;
+	}
 
 	//Alright, we finally have all of our data. What's our total size?
-	obj.dataSize = 
-		sizeof(float3) * numVerticies +
-		sizeof(float2) * numTexcoords +
-		sizeof(float3) * numNormals +
-		sizeof(face) * numFaces;
-	
-	obj.data = (void*)malloc(obj.dataSize);
-
-	//We'll put the faces at 0 since they don't have an enum. Where do the chunks after that go?
-	obj.attribOffset[ATTRIB_POSITION] =	sizeof(face) * numFaces;
-	obj.attribOffset[ATTRIB_TEXCOORD] =	obj.attribOffset[ATTRIB_POSITION] + sizeof(float3) * numVerticies;
-	obj.attribOffset[ATTRIB_NORMAL] =	obj.attribOffset[ATTRIB_TEXCOORD] + sizeof(float2) * numTexcoords;
-
-	//Everything is set up. Now, copy our data directly into the buffer.
-	memcpy(obj.data, faceBuffer, sizeof(face) * numFaces);
-	memcpy(BUFFER_OFFSET_BYTE(obj.data, obj.attribOffset[ATTRIB_POSITION]), vertexBuffer, sizeof(float3) * numVerticies);
-	memcpy(BUFFER_OFFSET_BYTE(obj.data, obj.attribOffset[ATTRIB_TEXCOORD]), vertexTexBuffer, sizeof(float2) * numTexcoords);
-	memcpy(BUFFER_OFFSET_BYTE(obj.data, obj.attribOffset[ATTRIB_NORMAL]), vertexNorBuffer, sizeof(float3) * numNormals);
+	vertexCount = vertices.count;
+	indexSize = (vertexCount <= 0x10000) ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	obj->attribOffset[ATTRIB_POSITION] = sizeof(objDataHeader) + ((indexSize * indexCount + 3) & ~3u);
+	obj->attribOffset[ATTRIB_TEXCOORD] = obj->attribOffset[ATTRIB_POSITION] + sizeof(float3) * vertexCount;
+	obj->attribOffset[ATTRIB_NORMAL] = obj->attribOffset[ATTRIB_TEXCOORD] + sizeof(float2) * vertexCount;
+	obj->dataSize = obj->attribOffset[ATTRIB_NORMAL] + sizeof(float3) * vertexCount;
+	if (state->tangents.count)
+	{
+		obj->attribOffset[ATTRIB_TANGENT] = obj->dataSize;
+		obj->attribOffset[ATTRIB_BITANGENT] = obj->attribOffset[ATTRIB_TANGENT] + sizeof(float3) * vertexCount;
+		obj->dataSize = obj->attribOffset[ATTRIB_BITANGENT] + sizeof(float3) * vertexCount;
+	}
+	obj->data = calloc(obj->dataSize, 1);
+
+	if (obj->data)
+	{
+		header = (objDataHeader *)obj->data;
+		header->vertexCount = vertexCount;
+		header->indexCount = indexCount;
+		header->indexSize = indexSize;
+
+		if (indexSize == sizeof(unsigned short))
+			for (i = 0, index16 = (unsigned short *)(header + 1); i < indexCount; ++i)
+				index16[i] = (unsigned short)indices[i];
+		else
+			memcpy(header + 1, indices, sizeof(unsigned int) * indexCount);
+
+		//Gather each unique vertex's attributes.
+		pos = (float3 *)BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_POSITION]);
+		tex = (float2 *)BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_TEXCOORD]);
+		nor = (float3 *)BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_NORMAL]);
+		if (state->tangents.count)
+		{
+			tan = (float3 *)BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_TANGENT]);
+			bit = (float3 *)BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_BITANGENT]);
+		}
+		for (i = 0, u = (const uniqueVertex *)vertices.data; i < vertexCount; ++i, ++u)
+		{
+			pos[i] = positions[u->v];
+			tex[i] = texcoords[u->vt];
+			nor[i] = normals[u->vn];
+			if (tan)
+			{
+				tan[i] = tangents[u->vn];
+				bit[i] = bitangents[u->vn];
+			}
+		}
+	}
+	else
+	{
+		memset(obj->attribOffset, 0, sizeof(obj->attribOffset));
+		obj->dataSize = 0;
+	}
+
+	objArenaRelease(&vertices);
+	free(indices);
+	return obj->data != 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// mesh optimization
+// triangle order is chosen with Tipsify (Sander, Nehab & Barczak 2007): fan 
+//	around the vertex that is most likely still in the post-transform cache, 
+//	and jump somewhere new only at a dead end. each jump starts a cluster; 
+//	clusters are then sorted so the ones facing away from the middle of the 
+//	mesh draw first, which cuts overdraw without hurting the cache much
+// finally vertices are renumbered in order of first use so fetches walk 
+//	through the vertex buffer front to back
+
+// FIFO size assumed when ordering triangles and reporting stats
+#define OBJ_VERTEX_CACHE_SIZE 16
+
+
+// one run of triangles between two Tipsify jumps
+struct objCluster
+{
+	unsigned int start, count;
+	float sortKey;
+};
+
+#ifndef __cplusplus
+typedef struct objCluster objCluster;
+#endif	// __cplusplus
+
+
+// size of one element of an attribute, see egpfwGetOBJAttributeData
+static unsigned int objAttribSize(const egpAttributeName attrib)
+{
+	if (attrib >= ATTRIB_TEXCOORD0 && attrib <= ATTRIB_TEXCOORD7)
+		return sizeof(float2);
+	if (attrib == ATTRIB_BLEND_WEIGHTS || attrib == ATTRIB_BLEND_INDICES)
+		return sizeof(float4);
+	return sizeof(float3);
+}
+
+// copy the descriptor's indices out as 32-bit, or back in at its own size
+static void objGetIndices(const egpTriOBJDescriptor *obj, unsigned int *indices)
+{
+	const unsigned int count = egpfwGetOBJNumIndices(obj);
+	const unsigned short *index16 = (const unsigned short *)egpfwGetOBJIndexData(obj);
+	unsigned int i;
+	if (egpfwGetOBJIndexType(obj) == INDEX_USHORT)
+		for (i = 0; i < count; ++i)
+			indices[i] = index16[i];
+	else
+		memcpy(indices, index16, sizeof(unsigned int) * count);
+}
+
+static void objSetIndices(egpTriOBJDescriptor *obj, const unsigned int *indices)
+{
+	const unsigned int count = egpfwGetOBJNumIndices(obj);
+	unsigned short *index16 = (unsigned short *)egpfwGetOBJIndexData(obj);
+	unsigned int i;
+	if (egpfwGetOBJIndexType(obj) == INDEX_USHORT)
+		for (i = 0; i < count; ++i)
+			index16[i] = (unsigned short)indices[i];
+	else
+		memcpy(index16, indices, sizeof(unsigned int) * count);
+}
+
+// count vertex shader invocations for a FIFO post-transform cache
+// 'cacheTime' must have one entry per vertex and is used as scratch
+static unsigned int objCountTransforms(const unsigned int *indices, const unsigned int indexCount, const unsigned int vertexCount, const unsigned int cacheSize, unsigned int *cacheTime)
+{
+	unsigned int i, misses = 0;
+
+	//A vertex is still cached if fewer than 'cacheSize' misses happened since it was loaded.
+	//Load times are offset by 'cacheSize' so a zeroed entry always reads as evicted.
+	memset(cacheTime, 0, sizeof(unsigned int) * vertexCount);
+	for (i = 0; i < indexCount; ++i)
+		if (misses + cacheSize + 1 - cacheTime[indices[i]] > cacheSize)
+			cacheTime[indices[i]] = ++misses + cacheSize;
+	return misses;
+}
+
+// Tipsify triangle ordering
+// writes the new triangle order to 'order' and marks where each cluster 
+//	starts in 'clusterStart'; returns the number of clusters
+static unsigned int objTipsify(const unsigned int *indices, const unsigned int triCount, const unsigned int vertexCount, const unsigned int cacheSize, 
+	unsigned int *order, unsigned int *clusterStart, unsigned int *scratch)
+{
+	//Scratch is carved into: per-vertex live triangle count, cache time and 
+	//adjacency offset; the adjacency list itself; the dead-end stack; the candidate list.
+	unsigned int *live = scratch, *cacheTime = live + vertexCount, *adjStart = cacheTime + vertexCount;
+	unsigned int *adjacency = adjStart + vertexCount + 1, *deadEnd = adjacency + triCount * 3, *candidates = deadEnd + triCount * 3;
+	unsigned char *emitted;
+	unsigned int numDeadEnd = 0, numCandidates, numOrdered = 0, numClusters = 0, cursor, time = cacheSize + 1;
+	unsigned int i, t, v, best, priority, bestPriority;
+	int fanning, jumped = 1;
+
+	emitted = (unsigned char *)calloc(triCount, 1);
+	if (!emitted)
+		return 0;
+
+	//Build vertex to triangle adjacency.
+	memset(live, 0, sizeof(unsigned int) * vertexCount * 2);
+	for (i = 0; i < triCount * 3; ++i)
+		++live[indices[i]];
+	for (v = 0, adjStart[0] = 0; v < vertexCount; ++v)
+		adjStart[v + 1] = adjStart[v] + live[v];
+	memcpy(cacheTime, adjStart, sizeof(unsigned int) * vertexCount);
+	for (i = 0; i < triCount * 3; ++i)
+		adjacency[cacheTime[indices[i]]++] = i / 3;
+	memset(cacheTime, 0, sizeof(unsigned int) * vertexCount);
+
+	//Start at the first vertex a triangle uses, so every cluster gets at least 
+	//one triangle and there are never more clusters than triangles.
+	for (v = 0; v < vertexCount && !live[v]; ++v);
+	fanning = (v < vertexCount) ? (int)v : -1;
+	cursor = v + 1;
+
+	while (fanning >= 0)
+	{
+		if (jumped)
+			clusterStart[numClusters++] = numOrdered;
+
+		//Emit every triangle around the fanning vertex.
+		numCandidates = 0;
+		for (i = adjStart[fanning]; i < adjStart[fanning + 1]; ++i)
+		{
+			t = adjacency[i];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+			order[numOrdered++] = t;
+			for (v = t * 3; v < t * 3 + 3; ++v)
+			{
+				deadEnd[numDeadEnd++] = indices[v];
+				candidates[numCandidates++] = indices[v];
+				--live[indices[v]];
+				if (time - cacheTime[indices[v]] > cacheSize)
+					cacheTime[indices[v]] = time++;
+			}
+		}
+
+		//Next fan: the candidate that will still be in the cache after its own 
+		//triangles are drawn, preferring the oldest one.
+		best = OBJ_INDEX_MISSING;
+		bestPriority = 0;
+		for (i = 0; i < numCandidates; ++i)
+		{
+			v = candidates[i];
+			if (!live[v])
+				continue;
+			priority = (time - cacheTime[v] + 2 * live[v] <= cacheSize) ? time - cacheTime[v] : 0;
+			if (best == OBJ_INDEX_MISSING || priority > bestPriority)
+			{
+				best = v;
+				bestPriority = priority;
+			}
+		}
+
+		//Dead end: try recently used vertices first, then just scan for anything left.
+		jumped = (best == OBJ_INDEX_MISSING);
+		while (best == OBJ_INDEX_MISSING && numDeadEnd)
+			if (live[deadEnd[--numDeadEnd]])
+				best = deadEnd[numDeadEnd];
+		for (; best == OBJ_INDEX_MISSING && cursor < vertexCount; ++cursor)
+			if (live[cursor])
+				best = cursor;
+
+		fanning = (best == OBJ_INDEX_MISSING) ? -1 : (int)best;
+	}
+
+	free(emitted);
+	return numClusters;
+}
+
+static int objCompareClusters(const void *a, const void *b)
+{
+	const float ka = ((const objCluster *)a)->sortKey, kb = ((const objCluster *)b)->sortKey;
+	return (ka < kb) - (ka > kb);
+}
+
+// sort clusters for overdraw
+// a cluster whose average normal points away from the mesh centroid is on 
+//	the outside and likely to occlude the rest, so it should draw first
+// returns 1 if successful, 0 if out of memory
+static int objSortClusters(const float3 *positions, const unsigned int *indices, const unsigned int vertexCount, 
+	unsigned int *order, const unsigned int *clusterStart, const unsigned int numClusters, const unsigned int triCount)
+{
+	objCluster *clusters;
+	unsigned int *sorted, c, i, t;
+	float3 centroid = { 0 }, center, normal, cross, e0, e1;
+	const float3 *p0, *p1, *p2;
+	float area, areaSum;
+
+	clusters = (objCluster *)malloc(sizeof(objCluster) * numClusters);
+	sorted = (unsigned int *)malloc(sizeof(unsigned int) * triCount);
+	if (!clusters || !sorted)
+	{
+		free(clusters);
+		free(sorted);
+		return 0;
+	}
+
+	for (i = 0; i < vertexCount; ++i)
+	{
+		centroid.f0 += positions[i].f0;
+		centroid.f1 += positions[i].f1;
+		centroid.f2 += positions[i].f2;
+	}
+	centroid.f0 /= (float)vertexCount;
+	centroid.f1 /= (float)vertexCount;
+	centroid.f2 /= (float)vertexCount;
+
+	for (c = 0; c < numClusters; ++c)
+	{
+		clusters[c].start = clusterStart[c];
+		clusters[c].count = ((c + 1 < numClusters) ? clusterStart[c + 1] : triCount) - clusterStart[c];
+
+		//Area-weighted center and normal of the cluster.
+		//The cross product's length is twice the area, so summing it weights the normal for free.
+		center.f0 = center.f1 = center.f2 = 0.0f;
+		normal.f0 = normal.f1 = normal.f2 = 0.0f;
+		areaSum = 0.0f;
+		for (i = clusters[c].start; i < clusters[c].start + clusters[c].count; ++i)
+		{
+			t = order[i] * 3;
+			p0 = positions + indices[t];
+			p1 = positions + indices[t + 1];
+			p2 = positions + indices[t + 2];
+			e0.f0 = p1->f0 - p0->f0;	e0.f1 = p1->f1 - p0->f1;	e0.f2 = p1->f2 - p0->f2;
+			e1.f0 = p2->f0 - p0->f0;	e1.f1 = p2->f1 - p0->f1;	e1.f2 = p2->f2 - p0->f2;
+			cross.f0 = e0.f1 * e1.f2 - e0.f2 * e1.f1;
+			cross.f1 = e0.f2 * e1.f0 - e0.f0 * e1.f2;
+			cross.f2 = e0.f0 * e1.f1 - e0.f1 * e1.f0;
+			area = sqrtf(cross.f0 * cross.f0 + cross.f1 * cross.f1 + cross.f2 * cross.f2);
+			normal.f0 += cross.f0;
+			normal.f1 += cross.f1;
+			normal.f2 += cross.f2;
+			center.f0 += (p0->f0 + p1->f0 + p2->f0) * area;
+			center.f1 += (p0->f1 + p1->f1 + p2->f1) * area;
+			center.f2 += (p0->f2 + p1->f2 + p2->f2) * area;
+			areaSum += area;
+		}
+
+		//Degenerate clusters have no direction; let them go last.
+		area = sqrtf(normal.f0 * normal.f0 + normal.f1 * normal.f1 + normal.f2 * normal.f2);
+		if (areaSum > 0.0f && area > 0.0f)
+		{
+			areaSum *= 3.0f;
+			clusters[c].sortKey = ((center.f0 / areaSum - centroid.f0) * normal.f0 + (center.f1 / areaSum - centroid.f1) * normal.f1 + (center.f2 / areaSum - centroid.f2) * normal.f2) / area;
+		}
+		else
+			clusters[c].sortKey = -1e30f;
+	}
+
+	qsort(clusters, numClusters, sizeof(objCluster), objCompareClusters);
+	for (c = 0, t = 0; c < numClusters; ++c)
+		for (i = 0; i < clusters[c].count; ++i)
+			sorted[t++] = order[clusters[c].start + i];
+	memcpy(order, sorted, sizeof(unsigned int) * triCount);
+
+	free(sorted);
+	free(clusters);
+	return 1;
+}
+
+// renumber vertices in order of first use and move every attribute to match
+// 'remap' must have one entry per vertex
+// returns 1 if successful, 0 if out of memory
+static int objReorderVertices(egpTriOBJDescriptor *obj, unsigned int *indices, unsigned int *remap)
+{
+	const unsigned int vertexCount = egpfwGetOBJNumVertices(obj), indexCount = egpfwGetOBJNumIndices(obj);
+	unsigned int i, v, next = 0, elemSize;
+	char *attrib, *copy;
+
+	copy = (char *)malloc(sizeof(float4) * vertexCount);
+	if (!copy)
+		return 0;
+
+	memset(remap, 0xFF, sizeof(unsigned int) * vertexCount);
+	for (i = 0; i < indexCount; ++i)
+	{
+		if (remap[indices[i]] == OBJ_INDEX_MISSING)
+			remap[indices[i]] = next++;
+		indices[i] = remap[indices[i]];
+	}
+
+	//Anything the faces never touch goes at the end.
+	for (v = 0; v < vertexCount; ++v)
+		if (remap[v] == OBJ_INDEX_MISSING)
+			remap[v] = next++;
 
+	for (i = 0; i < 16; ++i)
+		if (obj->attribOffset[i])
+		{
+			elemSize = objAttribSize((egpAttributeName)i);
+			attrib = (char *)BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[i]);
+			memcpy(copy, attrib, (size_t)elemSize * vertexCount);
+			for (v = 0; v < vertexCount; ++v)
+				memcpy(attrib + (size_t)elemSize * remap[v], copy + (size_t)elemSize * v, elemSize);
+		}
+
+	free(copy);
+	return 1;
+}
+
+
+// ****
+// optimize mesh
+int egpfwOptimizeOBJ(egpTriOBJDescriptor *obj, const unsigned int flags)
+{
+	const unsigned int vertexCount = egpfwGetOBJNumVertices(obj), indexCount = egpfwGetOBJNumIndices(obj), triCount = indexCount / 3;
+	unsigned int *indices, *order, *clusterStart, *scratch, *reordered;
+	unsigned int numClusters, i, before = 0, after;
+	int result = 0;
+
+	if (!vertexCount || !indexCount)
+		return 0;
+
+	//One allocation for everything: indices, triangle order, cluster starts, then Tipsify's scratch.
+	indices = (unsigned int *)malloc(sizeof(unsigned int) * ((size_t)indexCount * 4 + triCount * 2 + vertexCount * 3 + 1));
+	if (!indices)
+		return 0;
+	order = indices + indexCount;
+	clusterStart = order + triCount;
+	scratch = clusterStart + triCount;
+	objGetIndices(obj, indices);
+
+	if (flags & OPTIMIZE_REPORT)
+		before = objCountTransforms(indices, indexCount, vertexCount, OBJ_VERTEX_CACHE_SIZE, scratch);
+
+	//Overdraw sorting works on Tipsify's clusters, so it needs the cache pass either way.
+	if (flags & (OPTIMIZE_VERTEX_CACHE | OPTIMIZE_OVERDRAW))
+	{
+		numClusters = objTipsify(indices, triCount, vertexCount, OBJ_VERTEX_CACHE_SIZE, order, clusterStart, scratch);
+		if (!numClusters)
+			goto done;
+		if ((flags & OPTIMIZE_OVERDRAW) && !objSortClusters((const float3 *)egpfwGetOBJAttributeData(obj, ATTRIB_POSITION), 
+			indices, vertexCount, order, clusterStart, numClusters, triCount))
+			goto done;
+
+		//Apply the new triangle order; the adjacency part of scratch is free again.
+		reordered = scratch;
+		for (i = 0; i < triCount; ++i)
+			memcpy(reordered + i * 3, indices + order[i] * 3, sizeof(unsigned int) * 3);
+		memcpy(indices, reordered, sizeof(unsigned int) * indexCount);
+	}
+
+	if ((flags & OPTIMIZE_VERTEX_FETCH) && !objReorderVertices(obj, indices, scratch))
+		goto done;
+
+	objSetIndices(obj, indices);
+	result = 1;
+
+	if (flags & OPTIMIZE_REPORT)
+	{
+		after = objCountTransforms(indices, indexCount, vertexCount, OBJ_VERTEX_CACHE_SIZE, scratch);
+		printf("OBJ optimized (%u-entry cache): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", OBJ_VERTEX_CACHE_SIZE, 
+			(float)before / (float)triCount, (float)after / (float)triCount, 
+			(float)before / (float)vertexCount, (float)after / (float)vertexCount);
+	}
+
+done:
+	free(indices);
+	return result;
+}
+
+// ****
+// get cache stats
+int egpfwGetOBJCacheStats(const egpTriOBJDescriptor *obj, const unsigned int cacheSize, float *acmr_out, float *atvr_out)
+{
+	const unsigned int vertexCount = egpfwGetOBJNumVertices(obj), indexCount = egpfwGetOBJNumIndices(obj);
+	unsigned int *indices, misses;
+
+	if (!vertexCount || !indexCount || !cacheSize)
+		return 0;
+
+	indices = (unsigned int *)malloc(sizeof(unsigned int) * ((size_t)indexCount + vertexCount));
+	if (!indices)
+		return 0;
+	objGetIndices(obj, indices);
+	misses = objCountTransforms(indices, indexCount, vertexCount, cacheSize, indices + indexCount);
+	free(indices);
+
+	if (acmr_out)
+		*acmr_out = (float)misses / (float)(indexCount / 3);
+	if (atvr_out)
+		*atvr_out = (float)misses / (float)vertexCount;
+	return 1;
+}
+
+
+// fallback for files that can't be mapped: stream through one block
+// 'state' must be initialized and empty
+// returns 0 if the file could not be opened, 1 otherwise
+static int objParseStream(const char *objPath, objParseState *state)
+{
+	const unsigned int base[3] = { 0 };
+	FILE* objFile;
+	char *block, *resized;
+	const char *end, *lineEnd;
+	size_t capacity = OBJ_BLOCK_SIZE, carry = 0, bytesRead;
+
+	//Binary mode so the tokenizer sees the raw bytes; '\r' is treated as whitespace.
+	objFile = fopen(objPath, "rb");
+	if (objFile == NULL)
+		return 0;
+
+	block = (char *)malloc(capacity);
+	if (!block)
+	{
+		fclose(objFile);
+		state->failed = 1;
+		return 1;
+	}
+
+	//Stream the file through one block. Only whole lines get parsed; 
+	//a partial line at the end of the block is carried over to the front of the next read.
+	while (!state->failed)
+	{
+		bytesRead = fread(block + carry, 1, capacity - carry, objFile);
+		end = block + carry + bytesRead;
+
+		if (bytesRead == 0)
+		{
+			//End of file: whatever is left is the last line.
+			objParseRange(block, end, state);
+			break;
+		}
+
+		lineEnd = end;
+		while (lineEnd > block && lineEnd[-1] != '\n')
+			--lineEnd;
+
+		if (lineEnd == block)
+		{
+			//No line break in the whole block, so the line is longer than the block. Make room and keep reading.
+			carry = end - block;
+			if (carry == capacity)
+			{
+				resized = (char *)realloc(block, capacity * 2);
+				if (!resized)
+				{
+					state->failed = 1;
+					break;
+				}
+				block = resized;
+				capacity *= 2;
+			}
+			continue;
+		}
+
+		objParseRange(block, lineEnd, state);
+		carry = end - lineEnd;
+		memmove(block, lineEnd, carry);
+	}
+
+	free(block);
+	fclose(objFile);
+
+	objRebaseIndices((face *)state->faces.data, &state->relative, base);
+	state->relative.count = 0;
+	return 1;
+}
+
+
+// ****
+// load triangulated OBJ file
+egpTriOBJDescriptor egpfwLoadTriangleOBJ(const char *objPath, const egpMeshNormalMode normalMode, const unsigned int optimizeFlags, const double globalScale)
+{
+	egpTriOBJDescriptor obj = { 0 };
+	objParseState state;
+	unsigned long long size;
+	char *text;
+
+	if (!objPath || !*objPath)
+		return obj;
+
+	objParseStateInit(&state, (globalScale > 0.0) ? (float)globalScale : 1.0f);
+
+	//Map the file and parse it in chunks across threads. If it can't be mapped (empty, 
+	//or too big for the address space), stream it instead.
+	text = (char *)objMapFile(objPath, &size);
+	if (text)
+	{
+		objParseText(text, size, &state);
+		objUnmapFile(text, size);
+	}
+	else if (!objParseStream(objPath, &state))
+	{
+		printf("Unable to open file %s.\n", objPath);
+		return obj;
+	}
+
+	if (state.failed)
+		printf("Ran out of memory loading .obj: %s\n", objPath);
+	else if (!state.faces.count)
+		printf("No faces found in .obj: %s\n", objPath);
+	else if (!objValidateFaces(&state))
+		printf("Face in .obj references data that does not exist: %s\n", objPath);
+	else if (normalMode != NORMAL_LOAD && !objComputeBasis(&state, normalMode))
+		printf("Ran out of memory computing normals for .obj: %s\n", objPath);
+	else if (!objBuildDescriptor(&state, &obj))
+		printf("Ran out of memory loading .obj: %s\n", objPath);
+	else if (optimizeFlags && !egpfwOptimizeOBJ(&obj, optimizeFlags))
+		printf("Unable to optimize .obj, keeping file order: %s\n", objPath);
+
+	objParseStateRelease(&state);
 	return obj;
 }
 
 
 // ****
 // convert OBJ to VAO & VBO
-int egpfwCreateVAOFromOBJ(const egpTriOBJDescriptor *obj, egpVertexArrayObjectDescriptor *vao_out, egpVertexBufferObjectDescriptor *vbo_out)
-{
-	//Get the start and end + 1 of the face data so that we can loop through it.
-	void* faceStart = obj->data;
-	void* faceEnd = BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_POSITION]);
-
-	//Find our positions, normals, and texcoords inside the data buffer.
-	float3* data_positions = (float3*)(BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_POSITION]));
-	float3* data_normals = (float3*)(BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_NORMAL]));
-	float2* data_texcoords = (float2*)(BUFFER_OFFSET_BYTE(obj->data, obj->attribOffset[ATTRIB_TEXCOORD]));
-
-	//number of faces is the distance between the start and end of the face part of the buffer.
-	unsigned int numberOfFaces = (unsigned int)((char*)faceEnd - (char*)faceStart) / sizeof(face);
-	unsigned int vertexCount = numberOfFaces * 3;
-	
-
-	/* This is the complicated way of doing it.
-	//Create a pre-interleaved buffer
-	unsigned int interleavedBufferSize = sizeof(interleave) * vertexCount;
-	interleave* interleavedBuffer = (interleave*)malloc(interleavedBufferSize);
-
-	face* fdata;
-	interleave idata;
-	int i = 0;
-
-	//Walk down the face part of the data buffer and grab the relevant data from the other parts.
-	for (void* walker = faceStart; walker != faceEnd; walker = BUFFER_OFFSET_BYTE(walker, sizeof(face)))
-	{
-		fdata = (face*)walker;
-		
-		//Grab the pos, normal, and texcoord for this vertex
-		idata.pos = data_positions[fdata->v0];
-		idata.nor = data_normals[fdata->vn0];
-		idata.texcoord = data_texcoords[fdata->vt0];
-
-		//Put it in the buffer
-		interleavedBuffer[i] = idata;
-		i++;
-
-		//Repeat 2 more times per face.
-
-		idata.pos = data_positions[fdata->v1];
-		idata.nor = data_normals[fdata->vn1];
-		idata.texcoord = data_texcoords[fdata->vt1];
-
-		interleavedBuffer[i] = idata;
-		i++;
-
-		idata.pos = data_positions[fdata->v2];
-		idata.nor = data_normals[fdata->vn2];
-		idata.texcoord = data_texcoords[fdata->vt2];
-
-		interleavedBuffer[i] = idata;
-		i++;
-	}
-
-	//generate a VBO using GL calls
-	glGenBuffers(1, &vbo_out->glhandle);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_out->glhandle);
-	glBufferData(GL_ARRAY_BUFFER, interleavedBufferSize, (void*)interleavedBuffer, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	//Set up the other vbo variables how I assume they're supposed to be used.
-	vbo_out->attribTypes[ATTRIB_NORMAL] = 1;
-	vbo_out->attribTypes[ATTRIB_TEXCOORD] = 1;
-	vbo_out->attribTypes[ATTRIB_POSITION] = 1;
-	vbo_out->vertexSize = sizeof(float3);
-	vbo_out->vertexCount = vertexCount;
-
-	//Bind the vbo to a vao using GL calls
-	glGenVertexArrays(1, &vao_out->glhandle);
-	glBindVertexArray(vao_out->glhandle);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_out->glhandle);
-	
-	glEnableVertexAttribArray(ATTRIB_POSITION);
-	glVertexAttribPointer(ATTRIB_POSITION,
-		3, GL_FLOAT, GL_FALSE, sizeof(float3) + sizeof(float3) + sizeof(float2), (void*)0);
-	
-	glEnableVertexAttribArray(ATTRIB_NORMAL);
-	glVertexAttribPointer(ATTRIB_NORMAL,
-		3, GL_FLOAT, GL_FALSE, sizeof(float3) + sizeof(float3) + sizeof(float2), (void*)sizeof(float3));
-
-	glEnableVertexAttribArray(ATTRIB_TEXCOORD);
-	glVertexAttribPointer(ATTRIB_TEXCOORD,
-		3, GL_FLOAT, GL_FALSE, sizeof(float3) + sizeof(float3) + sizeof(float2), (void*)(sizeof(float3) + sizeof(float3)));
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	//Set up the other vao variables how I assume they're supposed to be used.
-	vao_out->vbo = vbo_out;
-	vao_out->primType = PRIM_TRIANGLES;
-	vao_out->ibo = NULL;
-	
-	//Free the temporary buffer now that everything has been sent off to the GPU.
-	free(interleavedBuffer);
-	/**/
-
-	//* This is the "simple" way of doing it.
-	//Create three attribute buffers.
-	float3* posBuffer = malloc(sizeof(float3) * vertexCount);
-	float3* norBuffer = malloc(sizeof(float3) * vertexCount);
-	float2* texBuffer = malloc(sizeof(float2) * vertexCount);
-	face* fdata;
-	int i = 0;
-
-	//Walk down the face part of the data buffer and grab the relevant data from the other parts.
-	for (void* walker = faceStart; walker != faceEnd; walker = BUFFER_OFFSET_BYTE(walker, sizeof(face)))
-	{
-		//Grab the data from the walker's current position.
-		fdata = (face*)walker;
-
-		//put the face's first vertex in
-		posBuffer[i] = data_positions[fdata->v0];
-		norBuffer[i] = data_normals[fdata->vn0];
-		texBuffer[i] = data_texcoords[fdata->vt0];
-		i++;
-
-		//put the face's second vertex in
-		posBuffer[i] = data_positions[fdata->v1];
-		norBuffer[i] = data_normals[fdata->vn1];
-		texBuffer[i] = data_texcoords[fdata->vt1];
-		i++;
-
-		//put the face's third vertex in
-		posBuffer[i] = data_positions[fdata->v2];
-		norBuffer[i] = data_normals[fdata->vn2];
-		texBuffer[i] = data_texcoords[fdata->vt2];
-		i++;
-	}
-
-	//Create our attributes and bind them
-	egpAttributeDescriptor attribs[] = 
-	{
-		egpCreateAttributeDescriptor(ATTRIB_POSITION, ATTRIB_VEC3, posBuffer),
-		egpCreateAttributeDescriptor(ATTRIB_NORMAL, ATTRIB_VEC3, norBuffer),
-		egpCreateAttributeDescriptor(ATTRIB_TEXCOORD, ATTRIB_VEC2, texBuffer),
-	};
+int egpfwCreateVAOFromOBJ(const egpTriOBJDescriptor *obj, egpVertexArrayObjectDescriptor *vao_out, egpVertexBufferObjectDescriptor *vbo_out, egpIndexBufferObjectDescriptor *ibo_out, const int packed)
+{
+	const unsigned int vertexCount = egpfwGetOBJNumVertices(obj);
+	const float *texcoords = (const float *)egpfwGetOBJAttributeData(obj, ATTRIB_TEXCOORD);
+	egpAttributeType positionType = ATTRIB_VEC3, normalType = ATTRIB_VEC3, texcoordType = ATTRIB_VEC2;
+	unsigned int i;
 
-	*vbo_out = egpCreateVBOInterleaved(attribs, 3, vertexCount);
-	*vao_out = egpCreateVAO(PRIM_TRIANGLES, vbo_out, NULL);
+	if (!vertexCount || !vao_out || !vbo_out || !ibo_out)
+		return 0;
 
-	//Free our buffers. Presumably, the data has been sent off to the GPU so we don't need it anymore.
-	free(posBuffer);
-	free(norBuffer);
-	free(texBuffer);
-	/**/
+	if (packed)
+	{
+		positionType = (egpAttributeType)ATTRIB_VEC3_HALF;
+		normalType = (egpAttributeType)ATTRIB_VEC3_SNORM10;
 
-	return 0;
+		//Normalized 16-bit texcoords can't tile, so fall back to halves if any go past the edges.
+		texcoordType = (egpAttributeType)ATTRIB_VEC2_UNORM16;
+		for (i = 0; texcoords && i < vertexCount * 2; ++i)
+		{
+			if (texcoords[i] < 0.0f || texcoords[i] > 1.0f)
+			{
+				texcoordType = (egpAttributeType)ATTRIB_VEC2_HALF;
+				break;
+			}
+		}
+	}
+
+	//The OBJ is already welded and indexed, so its arrays go straight into the buffers.
+	//Tangents are last so meshes without them just use the first three.
+	egpAttributeDescriptor attribs[] =
+	{
+		egpfwCreateAttributeDescriptor(ATTRIB_POSITION, positionType, egpfwGetOBJAttributeData(obj, ATTRIB_POSITION)),
+		egpfwCreateAttributeDescriptor(ATTRIB_NORMAL, normalType, egpfwGetOBJAttributeData(obj, ATTRIB_NORMAL)),
+		egpfwCreateAttributeDescriptor(ATTRIB_TEXCOORD, texcoordType, texcoords),
+		egpfwCreateAttributeDescriptor(ATTRIB_TANGENT, normalType, egpfwGetOBJAttributeData(obj, ATTRIB_TANGENT)),
+		egpfwCreateAttributeDescriptor(ATTRIB_BITANGENT, normalType, egpfwGetOBJAttributeData(obj, ATTRIB_BITANGENT)),
+	};
+	const unsigned int numAttribs = egpfwGetOBJAttributeData(obj, ATTRIB_TANGENT) ? 5 : 3;
+
+	*vao_out = egpfwCreateVAOInterleavedIndexed(PRIM_TRIANGLES, attribs, numAttribs, vertexCount, vbo_out, 
+		egpfwGetOBJIndexType(obj), egpfwGetOBJNumIndices(obj), egpfwGetOBJIndexData(obj), ibo_out);
+
+	return vao_out->glhandle ? (int)numAttribs : 0;
 }
 
 
@@ -383,9 +1731,115 @@ int egpfwCreateVAOFromOBJ(const egpTriOBJDescriptor *obj, egpVertexArrayObjectDe
 // free obj data
 int egpfwReleaseOBJ(egpTriOBJDescriptor *obj)
 {
-	//...
-	free(obj->data);
-	return 0;
+	if (!obj || !obj->data)
+		return 0;
+
+	//Binary files are mapped, not allocated, so they have to be unmapped instead.
+	if (obj->mappedBase)
+		objUnmapFile(obj->mappedBase, obj->mappedSize);
+	else
+		free(obj->data);
+
+	memset(obj, 0, sizeof(*obj));
+	return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// binary format
+// [header][padding to OBJ_BINARY_ALIGN][data]
+// the data block is the descriptor's data with every section (indices and each 
+//	attribute) moved to an OBJ_BINARY_ALIGN boundary, so once the file is mapped 
+//	each attribute pointer can go straight to GL with no parsing or copying
+
+#define OBJ_BINARY_MAGIC	0x4F504745u		// "EGPO" as little-endian bytes
+#define OBJ_BINARY_VERSION	3
+#define OBJ_BINARY_ALIGN	64
+
+#define OBJ_ALIGN(n) (((n) + (OBJ_BINARY_ALIGN - 1)) & ~(OBJ_BINARY_ALIGN - 1))
+
+struct objBinaryHeader
+{
+	unsigned int magic, version;
+	unsigned int headerSize, dataOffset, dataSize;
+	unsigned int checksum;
+	unsigned int attribOffset[16];
+};
+
+#ifndef __cplusplus
+typedef struct objBinaryHeader objBinaryHeader;
+#endif	// __cplusplus
+
+
+// Fletcher-style sum over 32-bit words; cheap enough to run on every load
+// covers the header (with its checksum taken as 0) as well as the data, so
+//	offsets and sizes can't be damaged without the sum noticing
+static void objChecksumWords(const void *data, const unsigned int size, unsigned int *a, unsigned int *b)
+{
+	const unsigned int *word = (const unsigned int *)data, *const end = word + size / sizeof(unsigned int);
+	while (word < end)
+	{
+		*a += *(word++);
+		*b += *a;
+	}
+}
+
+static unsigned int objChecksum(const objBinaryHeader *header, const void *data)
+{
+	objBinaryHeader copy = *header;
+	unsigned int a = 1, b = 0;
+	copy.checksum = 0;
+	objChecksumWords(&copy, sizeof(copy), &a, &b);
+	objChecksumWords(data, header->dataSize, &a, &b);
+	return (b << 16) ^ a ^ (b >> 16);
+}
+
+// check that the counts and offsets in a data block stay inside it, and 
+//	that every index names a vertex, so nothing reading the descriptor (or 
+//	drawing it) can run off the end of the mapping or its buffers
+// the checksum isn't keyed, so this can't be left to it
+// returns 1 if they do, 0 if not
+static int objBinaryDataValid(const objBinaryHeader *header, const void *data)
+{
+	const objDataHeader *counts = (const objDataHeader *)data;
+	const unsigned long long dataSize = header->dataSize;
+	unsigned long long end;
+	unsigned int i;
+	const unsigned short *index16;
+	const unsigned int *index32;
+
+	if (dataSize < sizeof(objDataHeader))
+		return 0;
+	if (counts->indexSize != sizeof(unsigned short) && counts->indexSize != sizeof(unsigned int))
+		return 0;
+
+	end = sizeof(objDataHeader) + (unsigned long long)counts->indexCount * counts->indexSize;
+	if (end > dataSize)
+		return 0;
+
+	if (counts->indexSize == sizeof(unsigned short))
+	{
+		index16 = (const unsigned short *)(counts + 1);
+		for (i = 0; i < counts->indexCount; ++i)
+			if (index16[i] >= counts->vertexCount)
+				return 0;
+	}
+	else
+	{
+		index32 = (const unsigned int *)(counts + 1);
+		for (i = 0; i < counts->indexCount; ++i)
+			if (index32[i] >= counts->vertexCount)
+				return 0;
+	}
+
+	for (i = 0; i < 16; ++i)
+		if (header->attribOffset[i])
+		{
+			end = header->attribOffset[i] + (unsigned long long)counts->vertexCount * objAttribSize((egpAttributeName)i);
+			if (header->attribOffset[i] % sizeof(float) || header->attribOffset[i] < sizeof(objDataHeader) || end > dataSize)
+				return 0;
+		}
+	return 1;
 }
 
 
@@ -393,14 +1847,126 @@ int egpfwReleaseOBJ(egpTriOBJDescriptor *obj)
 // save/load binary
 int egpfwSaveBinaryOBJ(const egpTriOBJDescriptor *obj, const char *binPath)
 {
-	//...
-	return 0;
+	objBinaryHeader header = { 0 };
+	unsigned int sectionStart[17], numSections = 0, i, j, start, end, size, newStart;
+	char *data, padding[OBJ_BINARY_ALIGN] = { 0 };
+	FILE *binFile;
+	int written;
+
+	if (!obj || !obj->data || !binPath || !*binPath)
+		return 0;
+
+	//Find where every section starts: the counts and indices at 0 and each attribute in use.
+	sectionStart[numSections++] = 0;
+	for (i = 0; i < 16; ++i)
+		if (obj->attribOffset[i])
+		{
+			for (j = 0; j < numSections && sectionStart[j] != obj->attribOffset[i]; ++j);
+			if (j == numSections)
+				sectionStart[numSections++] = obj->attribOffset[i];
+		}
+
+	//Sort them so each section ends where the next one begins.
+	for (i = 1; i < numSections; ++i)
+		for (j = i; j > 0 && sectionStart[j - 1] > sectionStart[j]; --j)
+		{
+			start = sectionStart[j];
+			sectionStart[j] = sectionStart[j - 1];
+			sectionStart[j - 1] = start;
+		}
+
+	//Lay the sections out again on aligned boundaries.
+	size = 0;
+	for (i = 0; i < numSections; ++i)
+	{
+		end = (i + 1 < numSections) ? sectionStart[i + 1] : obj->dataSize;
+		size = OBJ_ALIGN(size) + end - sectionStart[i];
+	}
+	size = OBJ_ALIGN(size);
+
+	data = (char *)calloc(size, 1);
+	if (!data)
+		return 0;
+
+	for (i = 0, newStart = 0; i < numSections; ++i)
+	{
+		end = (i + 1 < numSections) ? sectionStart[i + 1] : obj->dataSize;
+		memcpy(data + newStart, BUFFER_OFFSET_BYTE(obj->data, sectionStart[i]), end - sectionStart[i]);
+
+		for (j = 0; j < 16; ++j)
+			if (obj->attribOffset[j] == sectionStart[i] && sectionStart[i])
+				header.attribOffset[j] = newStart;
+
+		newStart = OBJ_ALIGN(newStart + end - sectionStart[i]);
+	}
+
+	header.magic = OBJ_BINARY_MAGIC;
+	header.version = OBJ_BINARY_VERSION;
+	header.headerSize = sizeof(header);
+	header.dataOffset = OBJ_ALIGN(sizeof(header));
+	header.dataSize = size;
+	header.checksum = objChecksum(&header, data);
+
+	written = 0;
+	binFile = fopen(binPath, "wb");
+	if (binFile)
+	{
+		written = fwrite(&header, sizeof(header), 1, binFile) == 1 &&
+			fwrite(padding, header.dataOffset - sizeof(header), 1, binFile) == 1 &&
+			fwrite(data, size, 1, binFile) == 1;
+		fclose(binFile);
+
+		if (!written)
+			printf("Unable to write binary .obj: %s\n", binPath);
+	}
+
+	free(data);
+	return written;
 }
 
 egpTriOBJDescriptor egpfwLoadBinaryOBJ(const char *binPath)
 {
 	egpTriOBJDescriptor obj = { 0 };
-	//...
+	const objBinaryHeader *header;
+	unsigned long long fileSize = 0;
+	void *base = 0;
+
+	if (!binPath || !*binPath)
+		return obj;
+
+	//Map the whole file. Pages are copy-on-write, so the descriptor can be 
+	//treated like any other, but nothing is read until it's actually touched.
+	base = objMapFile(binPath, &fileSize);
+	if (base && fileSize < sizeof(objBinaryHeader))
+	{
+		objUnmapFile(base, fileSize);
+		base = 0;
+	}
+	if (!base)
+		return obj;
+
+	//Check that this is actually one of ours, that it's complete and that it's intact.
+	header = (const objBinaryHeader *)base;
+	if (header->magic != OBJ_BINARY_MAGIC || header->version != OBJ_BINARY_VERSION || header->headerSize != sizeof(objBinaryHeader) ||
+		header->dataOffset < sizeof(objBinaryHeader) || header->dataOffset % sizeof(unsigned int))
+		printf("Binary .obj has the wrong format or version: %s\n", binPath);
+	else if ((unsigned long long)header->dataOffset + header->dataSize > fileSize)
+		printf("Binary .obj is truncated: %s\n", binPath);
+	else if (objChecksum(header, BUFFER_OFFSET_BYTE(base, header->dataOffset)) != header->checksum)
+		printf("Binary .obj failed its checksum: %s\n", binPath);
+	else if (!objBinaryDataValid(header, BUFFER_OFFSET_BYTE(base, header->dataOffset)))
+		printf("Binary .obj has sections or indices out of range: %s\n", binPath);
+	else
+	{
+		memcpy(obj.attribOffset, header->attribOffset, sizeof(obj.attribOffset));
+		obj.dataSize = header->dataSize;
+		obj.data = BUFFER_OFFSET_BYTE(base, header->dataOffset);
+		obj.mappedBase = base;
+		obj.mappedSize = fileSize;
+		return obj;
+	}
+
+	objUnmapFile(base, fileSize);
 	return obj;
 }
 
@@ -420,3 +1986,24 @@ unsigned int egpfwGetOBJNumVertices(const egpTriOBJDescriptor *obj)
 		return *((unsigned int *)obj->data);
 	return 0;
 }
+
+unsigned int egpfwGetOBJNumIndices(const egpTriOBJDescriptor *obj)
+{
+	if (obj && obj->data)
+		return ((const objDataHeader *)obj->data)->indexCount;
+	return 0;
+}
+
+const void *egpfwGetOBJIndexData(const egpTriOBJDescriptor *obj)
+{
+	if (obj && obj->data)
+		return (const objDataHeader *)obj->data + 1;
+	return 0;
+}
+
+egpIndexType egpfwGetOBJIndexType(const egpTriOBJDescriptor *obj)
+{
+	if (obj && obj->data)
+		return (((const objDataHeader *)obj->data)->indexSize == sizeof(unsigned short)) ? INDEX_USHORT : INDEX_UINT;
+	return INDEX_DISABLE;
+}
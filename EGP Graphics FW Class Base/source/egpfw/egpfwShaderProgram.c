@@ -1,6 +1,7 @@
 // By Dan Buckstein
 // Modified by: _______________________________________________________________
 #include "egpfw/egpfw/egpfwShaderProgram.h"
+#include "egpfw/egpfw/egpfwStateCache.h"
 
 
 // OpenGL
@@ -28,6 +29,17 @@ const unsigned int egpfwShaderType[] =
 	GL_FRAGMENT_SHADER,
 };
 
+// values per element of each uniform type
+const unsigned int egpfwUniformElems[] =
+{
+	1, 2, 3, 4
+};
+
+const unsigned int egpfwUniformMatrixElems[] =
+{
+	4, 9, 16, 6, 8, 12
+};
+
 
 //-----------------------------------------------------------------------------
 // shader functions
@@ -88,7 +100,8 @@ int egpfwValidateProgram(egpProgram *program)
 
 void egpfwActivateProgram(const egpProgram *program)
 {
-	//...
+	// state cache skips the bind if the program is already active
+	egpfwStateUseProgram(program ? program->glhandle : 0);
 }
 
 int egpfwReleaseProgram(egpProgram *program)
@@ -99,23 +112,209 @@ int egpfwReleaseProgram(egpProgram *program)
 
 int egpfwGetUniformLocation(const egpProgram *program, const char *uniformName)
 {
-	//...
+	if (program && program->glhandle && uniformName)
+		return glGetUniformLocation(program->glhandle, uniformName);
 	return -1;
 }
 
 void egpfwSendUniformInt(int location, const egpUniformIntType type, const unsigned int count, const int *values)
 {
-	//...
+	// values already in the program are not sent again
+	if (egpfwStateUniformChanged(location, type, values, count * egpfwUniformElems[type] * sizeof(int)))
+	{
+		switch (type)
+		{
+		case UNIF_INT:		glUniform1iv(location, count, values);	break;
+		case UNIF_IVEC2:	glUniform2iv(location, count, values);	break;
+		case UNIF_IVEC3:	glUniform3iv(location, count, values);	break;
+		case UNIF_IVEC4:	glUniform4iv(location, count, values);	break;
+		}
+	}
 }
 
 void egpfwSendUniformFloat(int location, const egpUniformFloatType type, const unsigned int count, const float *values)
 {
-	//...
+	if (egpfwStateUniformChanged(location, 4 + type, values, count * egpfwUniformElems[type] * sizeof(float)))
+	{
+		switch (type)
+		{
+		case UNIF_FLOAT:	glUniform1fv(location, count, values);	break;
+		case UNIF_VEC2:		glUniform2fv(location, count, values);	break;
+		case UNIF_VEC3:		glUniform3fv(location, count, values);	break;
+		case UNIF_VEC4:		glUniform4fv(location, count, values);	break;
+		}
+	}
 }
 
 void egpfwSendUniformFloatMatrix(int location, const egpUniformFloatMatrixType type, const unsigned int count, const int transpose, const float *values)
 {
-	//...
+	const GLboolean t = transpose ? GL_TRUE : GL_FALSE;
+	if (egpfwStateUniformChanged(location, 8 + type * 2 + t, values, count * egpfwUniformMatrixElems[type] * sizeof(float)))
+	{
+		switch (type)
+		{
+		case UNIF_MAT2:		glUniformMatrix2fv(location, count, t, values);		break;
+		case UNIF_MAT3:		glUniformMatrix3fv(location, count, t, values);		break;
+		case UNIF_MAT4:		glUniformMatrix4fv(location, count, t, values);		break;
+		case UNIF_MAT3x2:	glUniformMatrix3x2fv(location, count, t, values);	break;
+		case UNIF_MAT4x2:	glUniformMatrix4x2fv(location, count, t, values);	break;
+		case UNIF_MAT4x3:	glUniformMatrix4x3fv(location, count, t, values);	break;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// uniform buffers
+
+egpUniformBufferObjectDescriptor egpfwCreateUBO(const unsigned int size, const void *data)
+{
+	egpUniformBufferObjectDescriptor ret = { 0 };
+	if (size)
+	{
+		glGenBuffers(1, &ret.glhandle);
+		if (ret.glhandle)
+		{
+			ret.size = size;
+			glBindBuffer(GL_UNIFORM_BUFFER, ret.glhandle);
+			glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+	}
+	return ret;
+}
+
+void egpfwUpdateUBO(const egpUniformBufferObjectDescriptor *ubo, const unsigned int offset, const unsigned int size, const void *data)
+{
+	if (ubo && ubo->glhandle && data && size && offset + size <= ubo->size)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo->glhandle);
+		if (offset == 0 && size == ubo->size)
+			glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		else
+			glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+}
+
+void egpfwBindUBO(const egpUniformBufferObjectDescriptor *ubo, const unsigned int binding)
+{
+	egpfwStateBindUniformBuffer(binding, ubo ? ubo->glhandle : 0, 0, 0);
+}
+
+void egpfwBindUBORange(const egpUniformBufferObjectDescriptor *ubo, const unsigned int binding, const unsigned int offset, const unsigned int size)
+{
+	if (ubo && ubo->glhandle && size && offset + size <= ubo->size)
+		egpfwStateBindUniformBuffer(binding, ubo->glhandle, offset, size);
+}
+
+unsigned int egpfwGetUBOOffsetAlignment()
+{
+	// doesn't change while the context lives
+	static int alignment = 0;
+	if (!alignment)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment <= 0)
+			alignment = 256;
+	}
+	return (unsigned int)alignment;
+}
+
+int egpfwReleaseUBO(egpUniformBufferObjectDescriptor *ubo)
+{
+	if (ubo && ubo->glhandle)
+	{
+		glDeleteBuffers(1, &ubo->glhandle);
+		egpfwStateForget(STATE_UNIFORM_BUFFER, ubo->glhandle);
+		ubo->glhandle = 0;
+		ubo->size = 0;
+		return 1;
+	}
+	return 0;
+}
+
+int egpfwBindUniformBlock(const egpProgram *program, const char *blockName, const unsigned int binding)
+{
+	unsigned int index;
+	if (program && program->glhandle && blockName)
+	{
+		index = glGetUniformBlockIndex(program->glhandle, blockName);
+		if (index != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(program->glhandle, index, binding);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+egpTextureBufferObjectDescriptor egpfwCreateTBO(const unsigned int format, const unsigned int size, const void *data)
+{
+	egpTextureBufferObjectDescriptor ret = { 0 };
+	if (size)
+	{
+		glGenBuffers(1, &ret.glhandle);
+		glGenTextures(1, &ret.texhandle);
+		if (ret.glhandle && ret.texhandle)
+		{
+			ret.format = format;
+			ret.size = size;
+			glBindBuffer(GL_TEXTURE_BUFFER, ret.glhandle);
+			glBufferData(GL_TEXTURE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+			// the texture refers to the buffer object, not its storage
+			egpfwStateSelectTexture(0, GL_TEXTURE_BUFFER, ret.texhandle);
+			glTexBuffer(GL_TEXTURE_BUFFER, format, ret.glhandle);
+			egpfwStateBindTexture(0, GL_TEXTURE_BUFFER, 0);
+		}
+		else
+			egpfwReleaseTBO(&ret);
+	}
+	return ret;
+}
+
+void egpfwUpdateTBO(egpTextureBufferObjectDescriptor *tbo, const unsigned int size, const void *data)
+{
+	if (tbo && tbo->glhandle && data && size)
+	{
+		if (size > tbo->size)
+			tbo->size = size;
+		glBindBuffer(GL_TEXTURE_BUFFER, tbo->glhandle);
+		if (size == tbo->size)
+			glBufferData(GL_TEXTURE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		else
+		{
+			glBufferData(GL_TEXTURE_BUFFER, tbo->size, 0, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+}
+
+void egpfwBindTBO(const egpTextureBufferObjectDescriptor *tbo, const unsigned int unit)
+{
+	egpfwStateBindTexture(unit, GL_TEXTURE_BUFFER, tbo ? tbo->texhandle : 0);
+}
+
+int egpfwReleaseTBO(egpTextureBufferObjectDescriptor *tbo)
+{
+	if (tbo && (tbo->glhandle || tbo->texhandle))
+	{
+		if (tbo->texhandle)
+		{
+			glDeleteTextures(1, &tbo->texhandle);
+			egpfwStateForget(STATE_TEXTURE, tbo->texhandle);
+		}
+		if (tbo->glhandle)
+			glDeleteBuffers(1, &tbo->glhandle);
+		tbo->glhandle = tbo->texhandle = 0;
+		tbo->format = tbo->size = 0;
+		return 1;
+	}
+	return 0;
 }
 
 
@@ -0,0 +1,467 @@
+// By Dan Buckstein
+// Modified by: _______________________________________________________________
+#include "egpfw/egpfw/egpfwStateCache.h"
+
+
+// OpenGL
+#ifdef _WIN32
+#include "GL/glew.h"
+#else	// !_WIN32
+#include <OpenGL/gl3.h>
+#endif	// _WIN32
+
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// every shadowed value is stored plus one so that zero (what static
+//	storage starts as) means "unknown, ask GL"
+#define STATE_KNOWN(v)		((v) + 1)
+
+#define STATE_TEXTURE_UNITS		32
+#define STATE_TEXTURE_TARGETS	5
+#define STATE_CAPABILITIES		4
+#define STATE_FRAMEBUFFERS		64
+#define STATE_BUFFER_BINDINGS	16
+#define STATE_UNIFORMS_START	256
+
+
+// tracked texture targets and capabilities
+const unsigned int egpfwStateTextureTarget[STATE_TEXTURE_TARGETS] =
+{
+	GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D, GL_TEXTURE_BUFFER
+};
+
+const unsigned int egpfwStateCapability[STATE_CAPABILITIES] =
+{
+	GL_DEPTH_TEST, GL_STENCIL_TEST, GL_BLEND, GL_CULL_FACE
+};
+
+
+// last values sent to one uniform location of one program
+typedef struct egpStateUniform
+{
+	unsigned int program;		// STATE_KNOWN(handle), 0 if slot is empty
+	int location;
+	unsigned int tag, size, capacity, offset;
+} egpStateUniform;
+
+// draw buffer count set on one framebuffer
+typedef struct egpStateDrawBuffers
+{
+	unsigned int framebuffer, count;
+} egpStateDrawBuffers;
+
+
+// buffer range bound to one block binding point
+typedef struct egpStateBufferRange
+{
+	unsigned int buffer, offset, size;
+} egpStateBufferRange;
+
+
+// everything GL is known to have
+static struct
+{
+	unsigned int program, framebuffer, vertexArray, activeUnit;
+	unsigned int texture[STATE_TEXTURE_UNITS][STATE_TEXTURE_TARGETS];
+	unsigned int capability[STATE_CAPABILITIES];
+	egpStateBufferRange uniformBuffer[STATE_BUFFER_BINDINGS];
+	int viewport[4], viewportKnown;
+
+	egpStateDrawBuffers drawBuffers[STATE_FRAMEBUFFERS];
+	unsigned int numDrawBuffers;
+
+	// open-addressed table keyed on program and location; values live in
+	//	one growing block
+	egpStateUniform *uniforms;
+	unsigned int uniformCapacity, uniformCount;
+	unsigned char *values;
+	unsigned int valuesSize, valuesCapacity;
+
+	egpStateCacheStats stats;
+} egpfwState;
+
+
+//-----------------------------------------------------------------------------
+// internal
+
+// ****
+// count a call and say whether it has to go to GL
+static int egpfwStateCount(const egpStateKind kind, const int changed)
+{
+	if (changed)
+		++egpfwState.stats.issued[kind];
+	else
+		++egpfwState.stats.elided[kind];
+	return changed;
+}
+
+// ****
+static unsigned int egpfwStateHashUniform(const unsigned int program, const int location)
+{
+	return (program * 0x9e3779b1u) ^ ((unsigned int)location * 0x85ebca6bu);
+}
+
+// ****
+// find slot for a uniform: the one holding it, or the empty one it would go in
+static egpStateUniform *egpfwStateFindUniform(const unsigned int program, const int location)
+{
+	const unsigned int mask = egpfwState.uniformCapacity - 1;
+	unsigned int i = egpfwStateHashUniform(program, location) & mask;
+	egpStateUniform *slot;
+	for (;;)
+	{
+		slot = egpfwState.uniforms + i;
+		if (!slot->program || (slot->program == program && slot->location == location))
+			return slot;
+		i = (i + 1) & mask;
+	}
+}
+
+// ****
+// rebuild uniform table at a new capacity, dropping one program's entries
+// (value block is kept as-is; entries just move)
+static int egpfwStateRehashUniforms(const unsigned int capacity, const unsigned int dropProgram)
+{
+	egpStateUniform *const old = egpfwState.uniforms;
+	const unsigned int oldCapacity = egpfwState.uniformCapacity;
+	unsigned int i;
+
+	egpStateUniform *table = (egpStateUniform *)calloc(capacity, sizeof(egpStateUniform));
+	if (!table)
+		return 0;
+
+	egpfwState.uniforms = table;
+	egpfwState.uniformCapacity = capacity;
+	egpfwState.uniformCount = 0;
+	for (i = 0; i < oldCapacity; ++i)
+	{
+		if (old[i].program && old[i].program != dropProgram)
+		{
+			*egpfwStateFindUniform(old[i].program, old[i].location) = old[i];
+			++egpfwState.uniformCount;
+		}
+	}
+	free(old);
+	return 1;
+}
+
+// ****
+// reserve space in value block, returns offset or -1 if out of memory
+static int egpfwStateAllocValues(const unsigned int size)
+{
+	unsigned int capacity;
+	unsigned char *values;
+	if (egpfwState.valuesSize + size > egpfwState.valuesCapacity)
+	{
+		capacity = egpfwState.valuesCapacity ? egpfwState.valuesCapacity * 2 : 4096;
+		while (capacity < egpfwState.valuesSize + size)
+			capacity *= 2;
+		values = (unsigned char *)realloc(egpfwState.values, capacity);
+		if (!values)
+			return -1;
+		egpfwState.values = values;
+		egpfwState.valuesCapacity = capacity;
+	}
+	egpfwState.valuesSize += size;
+	return (int)(egpfwState.valuesSize - size);
+}
+
+
+//-----------------------------------------------------------------------------
+// functions
+
+// ****
+void egpfwStateUseProgram(const unsigned int glhandle)
+{
+	if (egpfwStateCount(STATE_PROGRAM, egpfwState.program != STATE_KNOWN(glhandle)))
+	{
+		glUseProgram(glhandle);
+		egpfwState.program = STATE_KNOWN(glhandle);
+	}
+}
+
+// ****
+void egpfwStateBindFramebuffer(const unsigned int glhandle)
+{
+	if (egpfwStateCount(STATE_FRAMEBUFFER, egpfwState.framebuffer != STATE_KNOWN(glhandle)))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, glhandle);
+		egpfwState.framebuffer = STATE_KNOWN(glhandle);
+	}
+}
+
+// ****
+void egpfwStateBindVertexArray(const unsigned int glhandle)
+{
+	if (egpfwStateCount(STATE_VERTEX_ARRAY, egpfwState.vertexArray != STATE_KNOWN(glhandle)))
+	{
+		glBindVertexArray(glhandle);
+		egpfwState.vertexArray = STATE_KNOWN(glhandle);
+	}
+}
+
+// ****
+void egpfwStateDrawBuffers(const unsigned int count, const unsigned int *buffers)
+{
+	egpStateDrawBuffers *record = 0;
+	unsigned int i;
+
+	// only the fixed attachment lists are remembered, and only for a
+	//	known framebuffer
+	if (egpfwState.framebuffer)
+	{
+		for (i = 0; i < egpfwState.numDrawBuffers; ++i)
+			if (egpfwState.drawBuffers[i].framebuffer == egpfwState.framebuffer)
+				record = egpfwState.drawBuffers + i;
+		if (!record && egpfwState.numDrawBuffers < STATE_FRAMEBUFFERS)
+		{
+			record = egpfwState.drawBuffers + egpfwState.numDrawBuffers++;
+			record->framebuffer = egpfwState.framebuffer;
+			record->count = 0;
+		}
+	}
+
+	if (egpfwStateCount(STATE_DRAW_BUFFERS, !record || record->count != STATE_KNOWN(count)))
+	{
+		glDrawBuffers(count, buffers);
+		if (record)
+			record->count = STATE_KNOWN(count);
+	}
+}
+
+// ****
+void egpfwStateSetCapability(const unsigned int cap, const int enabled)
+{
+	const unsigned int value = STATE_KNOWN(enabled ? 1u : 0u);
+	unsigned int i;
+	for (i = 0; i < STATE_CAPABILITIES; ++i)
+		if (egpfwStateCapability[i] == cap)
+			break;
+
+	if (egpfwStateCount(STATE_CAPABILITY, i == STATE_CAPABILITIES || egpfwState.capability[i] != value))
+	{
+		if (enabled)
+			glEnable(cap);
+		else
+			glDisable(cap);
+		if (i < STATE_CAPABILITIES)
+			egpfwState.capability[i] = value;
+	}
+}
+
+// ****
+void egpfwStateViewport(const int x, const int y, const int width, const int height)
+{
+	int *const v = egpfwState.viewport;
+	if (egpfwStateCount(STATE_VIEWPORT, !egpfwState.viewportKnown || v[0] != x || v[1] != y || v[2] != width || v[3] != height))
+	{
+		glViewport(x, y, width, height);
+		v[0] = x;
+		v[1] = y;
+		v[2] = width;
+		v[3] = height;
+		egpfwState.viewportKnown = 1;
+	}
+}
+
+// ****
+void egpfwStateBindTexture(const unsigned int unit, const unsigned int target, const unsigned int glhandle)
+{
+	unsigned int i;
+	for (i = 0; i < STATE_TEXTURE_TARGETS; ++i)
+		if (egpfwStateTextureTarget[i] == target)
+			break;
+
+	if (unit >= STATE_TEXTURE_UNITS || i == STATE_TEXTURE_TARGETS)
+	{
+		// not tracked: bind, and the active unit is no longer known
+		egpfwStateCount(STATE_TEXTURE, 1);
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, glhandle);
+		egpfwState.activeUnit = 0;
+	}
+	else if (egpfwStateCount(STATE_TEXTURE, egpfwState.texture[unit][i] != STATE_KNOWN(glhandle)))
+	{
+		if (egpfwState.activeUnit != STATE_KNOWN(unit))
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			egpfwState.activeUnit = STATE_KNOWN(unit);
+		}
+		glBindTexture(target, glhandle);
+		egpfwState.texture[unit][i] = STATE_KNOWN(glhandle);
+	}
+}
+
+// ****
+void egpfwStateSelectTexture(const unsigned int unit, const unsigned int target, const unsigned int glhandle)
+{
+	egpfwStateBindTexture(unit, target, glhandle);
+	if (egpfwState.activeUnit != STATE_KNOWN(unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		egpfwState.activeUnit = STATE_KNOWN(unit);
+	}
+}
+
+// ****
+void egpfwStateBindUniformBuffer(const unsigned int binding, const unsigned int glhandle, const unsigned int offset, const unsigned int size)
+{
+	egpStateBufferRange *range = binding < STATE_BUFFER_BINDINGS ? egpfwState.uniformBuffer + binding : 0;
+	if (egpfwStateCount(STATE_UNIFORM_BUFFER, !range || range->buffer != STATE_KNOWN(glhandle) || range->offset != offset || range->size != size))
+	{
+		if (size)
+			glBindBufferRange(GL_UNIFORM_BUFFER, binding, glhandle, offset, size);
+		else
+			glBindBufferBase(GL_UNIFORM_BUFFER, binding, glhandle);
+		if (range)
+		{
+			range->buffer = STATE_KNOWN(glhandle);
+			range->offset = offset;
+			range->size = size;
+		}
+	}
+}
+
+// ****
+int egpfwStateUniformChanged(const int location, const unsigned int tag, const void *values, const unsigned int size)
+{
+	egpStateUniform *slot;
+	int offset;
+
+	// nothing to compare against without a known program; -1 is a no-op in GL
+	if (!egpfwState.program || egpfwState.program == STATE_KNOWN(0) || location < 0 || !values || !size)
+		return egpfwStateCount(STATE_UNIFORM, 1);
+
+	if (!egpfwState.uniforms && !egpfwStateRehashUniforms(STATE_UNIFORMS_START, 0))
+		return egpfwStateCount(STATE_UNIFORM, 1);
+
+	slot = egpfwStateFindUniform(egpfwState.program, location);
+	if (slot->program)
+	{
+		if (slot->tag == tag && slot->size == size && !memcmp(egpfwState.values + slot->offset, values, size))
+			return egpfwStateCount(STATE_UNIFORM, 0);
+
+		// arrays sent with different counts reuse the largest space they had
+		if (size > slot->capacity)
+		{
+			offset = egpfwStateAllocValues(size);
+			if (offset < 0)
+			{
+				// out of memory: can never match again, so it is just never elided
+				slot->size = 0;
+				return egpfwStateCount(STATE_UNIFORM, 1);
+			}
+			slot->offset = (unsigned int)offset;
+			slot->capacity = size;
+		}
+	}
+	else
+	{
+		// keep the table at most half full
+		if ((egpfwState.uniformCount + 1) * 2 > egpfwState.uniformCapacity)
+		{
+			if (!egpfwStateRehashUniforms(egpfwState.uniformCapacity * 2, 0))
+				return egpfwStateCount(STATE_UNIFORM, 1);
+			slot = egpfwStateFindUniform(egpfwState.program, location);
+		}
+
+		offset = egpfwStateAllocValues(size);
+		if (offset < 0)
+			return egpfwStateCount(STATE_UNIFORM, 1);
+		slot->program = egpfwState.program;
+		slot->location = location;
+		slot->offset = (unsigned int)offset;
+		slot->capacity = size;
+		++egpfwState.uniformCount;
+	}
+
+	slot->tag = tag;
+	slot->size = size;
+	memcpy(egpfwState.values + slot->offset, values, size);
+	return egpfwStateCount(STATE_UNIFORM, 1);
+}
+
+// ****
+void egpfwStateForget(const egpStateKind kind, const unsigned int glhandle)
+{
+	const unsigned int value = STATE_KNOWN(glhandle);
+	unsigned int i, j;
+
+	switch (kind)
+	{
+	case STATE_PROGRAM:
+		if (egpfwState.program == value)
+			egpfwState.program = 0;
+		if (egpfwState.uniforms)
+			egpfwStateRehashUniforms(egpfwState.uniformCapacity, value);
+		break;
+	case STATE_FRAMEBUFFER:
+		if (egpfwState.framebuffer == value)
+			egpfwState.framebuffer = 0;
+		for (i = egpfwState.numDrawBuffers; i > 0; --i)
+			if (egpfwState.drawBuffers[i - 1].framebuffer == value)
+				egpfwState.drawBuffers[i - 1] = egpfwState.drawBuffers[--egpfwState.numDrawBuffers];
+		break;
+	case STATE_VERTEX_ARRAY:
+		if (egpfwState.vertexArray == value)
+			egpfwState.vertexArray = 0;
+		break;
+	case STATE_TEXTURE:
+		for (i = 0; i < STATE_TEXTURE_UNITS; ++i)
+			for (j = 0; j < STATE_TEXTURE_TARGETS; ++j)
+				if (egpfwState.texture[i][j] == value)
+					egpfwState.texture[i][j] = 0;
+		break;
+	case STATE_UNIFORM_BUFFER:
+		for (i = 0; i < STATE_BUFFER_BINDINGS; ++i)
+			if (egpfwState.uniformBuffer[i].buffer == value)
+				egpfwState.uniformBuffer[i].buffer = 0;
+		break;
+	default:
+		break;
+	}
+}
+
+// ****
+void egpfwStateInvalidate()
+{
+	egpfwState.program = egpfwState.framebuffer = egpfwState.vertexArray = egpfwState.activeUnit = 0;
+	memset(egpfwState.texture, 0, sizeof(egpfwState.texture));
+	memset(egpfwState.capability, 0, sizeof(egpfwState.capability));
+	memset(egpfwState.uniformBuffer, 0, sizeof(egpfwState.uniformBuffer));
+	egpfwState.viewportKnown = 0;
+	egpfwState.numDrawBuffers = 0;
+
+	// keep memory for the next frame
+	if (egpfwState.uniforms)
+		memset(egpfwState.uniforms, 0, egpfwState.uniformCapacity * sizeof(egpStateUniform));
+	egpfwState.uniformCount = 0;
+	egpfwState.valuesSize = 0;
+}
+
+// ****
+void egpfwStateEndFrame(egpStateCacheStats *stats_out)
+{
+	if (stats_out)
+		*stats_out = egpfwState.stats;
+	memset(&egpfwState.stats, 0, sizeof(egpfwState.stats));
+}
+
+// ****
+void egpfwStateRelease()
+{
+	egpfwStateInvalidate();
+	free(egpfwState.uniforms);
+	free(egpfwState.values);
+	egpfwState.uniforms = 0;
+	egpfwState.values = 0;
+	egpfwState.uniformCapacity = egpfwState.valuesCapacity = 0;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,185 @@
+// By Dan Buckstein
+// Modified by: _______________________________________________________________
+#include "egpfw/egpfw/egpfwTextureTable.h"
+#include "egpfw/egpfw/egpfwStateCache.h"
+
+
+// OpenGL
+#ifdef _WIN32
+#include "GL/glew.h"
+#else	// !_WIN32
+#include <OpenGL/gl3.h>
+#endif	// _WIN32
+
+
+#include <stdio.h>
+#include <string.h>
+
+
+// std140 puts each array element on its own 16 bytes
+#define TEXTURE_TABLE_STRIDE	2
+
+
+//-----------------------------------------------------------------------------
+// texture table
+
+int egpfwTextureTableSupportsBindless()
+{
+#ifdef GL_ARB_bindless_texture
+	GLint i, numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (i = 0; i < numExtensions; ++i)
+		if (!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_bindless_texture"))
+			return 1;
+#endif	// GL_ARB_bindless_texture
+	return 0;
+}
+
+egpTextureTableDescriptor egpfwCreateTextureTable(const egpTextureTableMode mode, const unsigned int firstUnit)
+{
+	egpTextureTableDescriptor ret = { TEXTURE_TABLE_UNITS };
+	GLint stageUnits = 0, combinedUnits = 0;
+	ret.firstUnit = firstUnit;
+
+	if (mode == TEXTURE_TABLE_BINDLESS && egpfwTextureTableSupportsBindless())
+	{
+		glGenBuffers(1, &ret.uboHandle);
+		if (ret.uboHandle)
+		{
+			ret.mode = TEXTURE_TABLE_BINDLESS;
+			ret.dirty = 1;
+			ret.freeUnits = ~0u;
+			glBindBuffer(GL_UNIFORM_BUFFER, ret.uboHandle);
+			glBufferData(GL_UNIFORM_BUFFER, EGP_TEXTURE_TABLE_SIZE * TEXTURE_TABLE_STRIDE * sizeof(unsigned long long), 0, GL_STATIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			return ret;
+		}
+	}
+
+	// units: the slots' units must exist, and a shader reading the table
+	//	uses one of its fragment samplers per slot
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &stageUnits);
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &combinedUnits);
+	if (firstUnit + EGP_TEXTURE_TABLE_SIZE > (unsigned int)combinedUnits)
+		printf("\n Texture table needs units %u to %u, but the context only has %d!", firstUnit, firstUnit + EGP_TEXTURE_TABLE_SIZE - 1, combinedUnits);
+	if (EGP_TEXTURE_TABLE_SIZE > stageUnits)
+		printf("\n Texture table has %u slots, but shaders only get %d samplers!", EGP_TEXTURE_TABLE_SIZE, stageUnits);
+	else
+		ret.freeUnits = (unsigned int)stageUnits - EGP_TEXTURE_TABLE_SIZE;
+	return ret;
+}
+
+// residency is per handle, not per slot: the same texture may sit in
+//	several slots (aliased render targets), but is only made resident once
+static unsigned int egpfwTextureTableHandleCount(const egpTextureTableDescriptor *table, const unsigned long long handle)
+{
+	unsigned int i, count = 0;
+	for (i = 0; i < EGP_TEXTURE_TABLE_SIZE; ++i)
+		count += table->handle[i] == handle;
+	return count;
+}
+
+void egpfwTextureTableSet(egpTextureTableDescriptor *table, const unsigned int slot, const unsigned int texture)
+{
+	unsigned long long handle = 0;
+	if (!table || slot >= EGP_TEXTURE_TABLE_SIZE || table->texture[slot] == texture)
+		return;
+
+	table->texture[slot] = texture;
+	if (table->mode != TEXTURE_TABLE_BINDLESS)
+		return;
+
+#ifdef GL_ARB_bindless_texture
+	{
+		const unsigned long long old = table->handle[slot];
+		table->handle[slot] = 0;
+		if (old && !egpfwTextureTableHandleCount(table, old))
+			glMakeTextureHandleNonResidentARB(old);
+
+		if (texture)
+		{
+			handle = glGetTextureHandleARB(texture);
+			if (handle && !egpfwTextureTableHandleCount(table, handle))
+				glMakeTextureHandleResidentARB(handle);
+		}
+	}
+#endif	// GL_ARB_bindless_texture
+
+	table->handle[slot] = handle;
+	table->dirty = 1;
+}
+
+void egpfwTextureTableClear(egpTextureTableDescriptor *table)
+{
+	unsigned int i;
+	if (table)
+		for (i = 0; i < EGP_TEXTURE_TABLE_SIZE; ++i)
+			egpfwTextureTableSet(table, i, 0);
+}
+
+void egpfwActivateTextureTable(egpTextureTableDescriptor *table, const unsigned int binding)
+{
+	unsigned long long data[EGP_TEXTURE_TABLE_SIZE * TEXTURE_TABLE_STRIDE] = { 0 };
+	unsigned int i;
+	if (!table)
+		return;
+
+	if (table->mode == TEXTURE_TABLE_BINDLESS)
+	{
+		if (table->dirty)
+		{
+			for (i = 0; i < EGP_TEXTURE_TABLE_SIZE; ++i)
+				data[i * TEXTURE_TABLE_STRIDE] = table->handle[i];
+			glBindBuffer(GL_UNIFORM_BUFFER, table->uboHandle);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), data);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			table->dirty = 0;
+		}
+		egpfwStateBindUniformBuffer(binding, table->uboHandle, 0, 0);
+	}
+	else
+	{
+		// nothing else uses these units, so after the first frame the
+		//	state cache skips all of this
+		for (i = 0; i < EGP_TEXTURE_TABLE_SIZE; ++i)
+			egpfwStateBindTexture(table->firstUnit + i, GL_TEXTURE_2D, table->texture[i]);
+	}
+}
+
+int egpfwConnectTextureTable(const egpTextureTableDescriptor *table, const egpProgram *program, const unsigned int binding)
+{
+	int units[EGP_TEXTURE_TABLE_SIZE], location;
+	unsigned int i;
+	if (!table || !program || !program->glhandle)
+		return 0;
+
+	if (table->mode == TEXTURE_TABLE_BINDLESS)
+		return egpfwBindUniformBlock(program, "TextureTable", binding);
+
+	location = glGetUniformLocation(program->glhandle, "textureTable");
+	if (location < 0)
+		return 0;
+	for (i = 0; i < EGP_TEXTURE_TABLE_SIZE; ++i)
+		units[i] = (int)(table->firstUnit + i);
+	glProgramUniform1iv(program->glhandle, location, EGP_TEXTURE_TABLE_SIZE, units);
+	return 1;
+}
+
+int egpfwReleaseTextureTable(egpTextureTableDescriptor *table)
+{
+	if (table)
+	{
+		egpfwTextureTableClear(table);
+		if (table->uboHandle)
+		{
+			glDeleteBuffers(1, &table->uboHandle);
+			egpfwStateForget(STATE_UNIFORM_BUFFER, table->uboHandle);
+			table->uboHandle = 0;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 // By Dan Buckstein
 // Modified by: _______________________________________________________________
 #include "egpfw/egpfw/egpfwVertexBuffer.h"
+#include "egpfw/egpfw/egpfwStateCache.h"
 
 
 // OpenGL
@@ -24,19 +25,37 @@
 const egpVertexArrayObjectDescriptor *egpfw_vao_active = 0;
 
 // data descriptors aligning with enumerated values in header
+// packed types follow the regular ones (see egpPackedAttributeType)
 const unsigned int egpfwAttribInternalElems[] =
 {
-	0, 1, 2, 3, 4, 1, 2, 3, 4
+	0, 1, 2, 3, 4, 1, 2, 3, 4, 
+	2, 3, 4, 2, 4
 };
 
 const unsigned int egpfwAttribInternalSize[] =
 {
-	0, 4, 8, 12, 16, 4, 8, 12, 16
+	0, 4, 8, 12, 16, 4, 8, 12, 16, 
+	4, 8, 8, 4, 4
 };
 
 const unsigned int egpfwAttribInternalType[] =
 {
-	0, GL_INT, GL_INT, GL_INT, GL_INT, GL_FLOAT, GL_FLOAT, GL_FLOAT, GL_FLOAT
+	0, GL_INT, GL_INT, GL_INT, GL_INT, GL_FLOAT, GL_FLOAT, GL_FLOAT, GL_FLOAT, 
+	GL_HALF_FLOAT, GL_HALF_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_SHORT, GL_INT_2_10_10_10_REV
+};
+
+// whether fetch should normalize integers to [0, 1] or [-1, 1]
+const unsigned int egpfwAttribInternalNormalized[] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 
+	0, 0, 0, 1, 1
+};
+
+// number of source values (floats or ints) per vertex in attribute data
+const unsigned int egpfwAttribSourceElems[] =
+{
+	0, 1, 2, 3, 4, 1, 2, 3, 4, 
+	2, 3, 4, 2, 3
 };
 
 const unsigned int egpfwIndexInternalSize[] =
@@ -44,9 +63,11 @@ const unsigned int egpfwIndexInternalSize[] =
 	0, 1, 1, 2, 2, 4, 4
 };
 
+// draw calls only take unsigned index types; signed indices are never 
+//	negative, so they are drawn as their unsigned counterparts
 const unsigned int egpfwIndexInternalType[] =
 {
-	0, GL_BYTE, GL_UNSIGNED_BYTE, GL_SHORT, GL_UNSIGNED_SHORT, GL_INT, GL_UNSIGNED_INT
+	0, GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT, GL_UNSIGNED_INT
 };
 
 const unsigned int egpfwPrimitive[] =
@@ -55,35 +76,297 @@ const unsigned int egpfwPrimitive[] =
 };
 
 
+//-----------------------------------------------------------------------------
+// packing
+
+// ****
+// float to half float, round to nearest even
+// overflow becomes infinity, underflow becomes (signed) zero
+static unsigned short egpfwPackHalf(const float f)
+{
+	union { float f; unsigned int u; } bits;
+	unsigned int sign, mantissa, half, shift, rest;
+	int exponent;
+
+	bits.f = f;
+	sign = (bits.u >> 16) & 0x8000u;
+	mantissa = bits.u & 0x007fffffu;
+	exponent = (int)((bits.u >> 23) & 0xffu);
+
+	// inf and nan
+	if (exponent == 0xff)
+		return (unsigned short)(sign | 0x7c00u | (mantissa ? 0x0200u : 0u));
+
+	// rebias; too big for half
+	exponent = exponent - 127 + 15;
+	if (exponent >= 31)
+		return (unsigned short)(sign | 0x7c00u);
+
+	// too small for a normal half: shift into a subnormal or flush to zero
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return (unsigned short)sign;
+		mantissa |= 0x00800000u;
+		shift = (unsigned int)(14 - exponent);
+		half = mantissa >> shift;
+		rest = mantissa & ((1u << shift) - 1u);
+		if (rest > (1u << (shift - 1)) || (rest == (1u << (shift - 1)) && (half & 1u)))
+			++half;
+		return (unsigned short)(sign | half);
+	}
+
+	// rounding may carry into the exponent, which is still correct
+	half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+	rest = mantissa & 0x00001fffu;
+	if (rest > 0x00001000u || (rest == 0x00001000u && (half & 1u)))
+		++half;
+	return (unsigned short)(sign | half);
+}
+
+// ****
+// float in [0, 1] to normalized unsigned short
+static unsigned short egpfwPackUnorm16(const float f)
+{
+	const float c = f < 0.0f ? 0.0f : f > 1.0f ? 1.0f : f;
+	return (unsigned short)(c * 65535.0f + 0.5f);
+}
+
+// ****
+// float in [-1, 1] to 10-bit signed normalized, two's complement
+static unsigned int egpfwPackSnorm10(const float f)
+{
+	const float c = (f < -1.0f ? -1.0f : f > 1.0f ? 1.0f : f) * 511.0f;
+	const int i = (int)(c < 0.0f ? c - 0.5f : c + 0.5f);
+	return ((unsigned int)i & 0x3ffu);
+}
+
+// ****
+// interleaved vertex size for a set of attribute types indexed by name
+static unsigned int egpfwVertexSize(const egpAttributeType *attribTypes)
+{
+	unsigned int i, size;
+	for (i = size = 0; i < 16; ++i)
+		size += egpfwAttribInternalSize[attribTypes[i]];
+	return size;
+}
+
+// ****
+// build name-indexed type list from attribute array
+// attributes are always interleaved in name order so a VBO can be described 
+//	by its types alone; later duplicates replace earlier ones
+// returns number of active attributes
+static unsigned int egpfwGatherAttribs(const egpAttributeDescriptor *attribs, const unsigned int numAttribs, egpAttributeType *attribTypes_out, const egpAttributeDescriptor **attribsByName_out)
+{
+	unsigned int i, count = 0;
+	memset(attribTypes_out, 0, sizeof(egpAttributeType) * 16);
+	if (attribsByName_out)
+		memset(attribsByName_out, 0, sizeof(egpAttributeDescriptor *) * 16);
+	for (i = 0; i < numAttribs; ++i)
+	{
+		if (attribs[i].type != ATTRIB_DISABLE && (unsigned int)attribs[i].name < 16 && (unsigned int)attribs[i].type < EGPFW_ATTRIB_TYPE_COUNT)
+		{
+			count += attribTypes_out[attribs[i].name] == ATTRIB_DISABLE;
+			attribTypes_out[attribs[i].name] = attribs[i].type;
+			if (attribsByName_out)
+				attribsByName_out[attribs[i].name] = attribs + i;
+		}
+	}
+	return count;
+}
+
+// ****
+// interleave attribute data into vertex buffer in one pass over the output
+// each vertex is written front to back while every source array is read 
+//	sequentially, so both sides stream through the cache
+// attributes without data are left as zeros
+static void egpfwInterleave(unsigned char *dst, const egpAttributeDescriptor **attribsByName, const unsigned int numVertices)
+{
+	struct { const unsigned char *src; unsigned int type, srcSize, size; } streams[16];
+	unsigned int i, j, numStreams;
+	unsigned short *h;
+	const float *f;
+
+	for (i = numStreams = 0; i < 16; ++i)
+	{
+		if (attribsByName[i])
+		{
+			streams[numStreams].src = (const unsigned char *)attribsByName[i]->data;
+			streams[numStreams].type = attribsByName[i]->type;
+			streams[numStreams].srcSize = egpfwAttribSourceElems[attribsByName[i]->type] * 4;
+			streams[numStreams].size = egpfwAttribInternalSize[attribsByName[i]->type];
+			++numStreams;
+		}
+	}
+
+	for (i = 0; i < numVertices; ++i)
+	{
+		for (j = 0; j < numStreams; ++j)
+		{
+			if (streams[j].src)
+			{
+				f = (const float *)streams[j].src;
+				switch (streams[j].type)
+				{
+				case ATTRIB_VEC2_HALF:
+				case ATTRIB_VEC3_HALF:
+				case ATTRIB_VEC4_HALF:
+					//Three halves are padded out to four to keep the next attribute aligned
+					h = (unsigned short *)dst;
+					h[0] = egpfwPackHalf(f[0]);
+					h[1] = egpfwPackHalf(f[1]);
+					if (streams[j].type != ATTRIB_VEC2_HALF)
+					{
+						h[2] = egpfwPackHalf(f[2]);
+						h[3] = streams[j].type == ATTRIB_VEC4_HALF ? egpfwPackHalf(f[3]) : 0;
+					}
+					break;
+				case ATTRIB_VEC2_UNORM16:
+					h = (unsigned short *)dst;
+					h[0] = egpfwPackUnorm16(f[0]);
+					h[1] = egpfwPackUnorm16(f[1]);
+					break;
+				case ATTRIB_VEC3_SNORM10:
+					*(unsigned int *)dst = egpfwPackSnorm10(f[0]) | (egpfwPackSnorm10(f[1]) << 10) | (egpfwPackSnorm10(f[2]) << 20);
+					break;
+				default:
+					memcpy(dst, f, streams[j].size);
+				}
+				streams[j].src += streams[j].srcSize;
+			}
+			dst += streams[j].size;
+		}
+	}
+}
+
+// ****
+// enable and point attributes of the VBO bound to GL_ARRAY_BUFFER
+// must be called with the VAO to be set up bound
+static void egpfwSetAttribPointers(const egpVertexBufferObjectDescriptor *vbo)
+{
+	unsigned int i, offset;
+	egpAttributeType type;
+	for (i = offset = 0; i < 16; ++i)
+	{
+		type = vbo->attribTypes[i];
+		if (type != ATTRIB_DISABLE)
+		{
+			glEnableVertexAttribArray(i);
+			if (egpfwAttribInternalType[type] == GL_INT)
+				glVertexAttribIPointer(i, egpfwAttribInternalElems[type], GL_INT, vbo->vertexSize, BUFFER_OFFSET(offset));
+			else
+				glVertexAttribPointer(i, egpfwAttribInternalElems[type], egpfwAttribInternalType[type], egpfwAttribInternalNormalized[type] ? GL_TRUE : GL_FALSE, vbo->vertexSize, BUFFER_OFFSET(offset));
+			offset += egpfwAttribInternalSize[type];
+		}
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // functions
 
 egpAttributeDescriptor egpfwCreateAttributeDescriptor(const egpAttributeName name, const egpAttributeType type, const void *data)
 {
 	egpAttributeDescriptor attr = { 0 };
-	//...
+	if ((unsigned int)type < EGPFW_ATTRIB_TYPE_COUNT)
+	{
+		attr.name = name;
+		attr.type = type;
+		attr.size = egpfwAttribInternalSize[type];
+		attr.elems = egpfwAttribInternalElems[type];
+		attr.internalType = egpfwAttribInternalType[type];
+		attr.data = data;
+	}
 	return attr;
 }
 
 egpVertexBufferObjectDescriptor egpfwCreateVBOInterleaved(const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int numVertices)
 {
 	egpVertexBufferObjectDescriptor vbo = { 0 };
-	//...
+	const egpAttributeDescriptor *attribsByName[16];
+	unsigned char *data;
+
+	if (attribs && numAttribs && numVertices)
+	{
+		if (egpfwGatherAttribs(attribs, numAttribs, vbo.attribTypes, attribsByName))
+		{
+			vbo.vertexSize = egpfwVertexSize(vbo.attribTypes);
+			data = (unsigned char *)calloc(numVertices, vbo.vertexSize);
+			if (data)
+			{
+				egpfwInterleave(data, attribsByName, numVertices);
+
+				glGenBuffers(1, &vbo.glhandle);
+				glBindBuffer(GL_ARRAY_BUFFER, vbo.glhandle);
+				glBufferData(GL_ARRAY_BUFFER, numVertices * vbo.vertexSize, data, GL_STATIC_DRAW);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				free(data);
+
+				vbo.vertexCount = numVertices;
+			}
+			else
+				memset(&vbo, 0, sizeof(vbo));
+		}
+		else
+			printf("\n VBO creation failed! No active attributes.");
+	}
 	return vbo;
 }
 
 egpVertexBufferObjectDescriptor egpfwCreateVBOInterleavedIndexed(const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int numVertices, const egpIndexType indexType, const unsigned int numIndices, const void *indexData, egpIndexBufferObjectDescriptor *ibo_out)
 {
 	egpVertexBufferObjectDescriptor vbo = egpfwCreateVBOInterleaved(attribs, numAttribs, numVertices);
-//	egpIndexBufferObjectDescriptor ibo = { 0 };
-	//...
+	egpIndexBufferObjectDescriptor ibo = { 0 };
+	if (vbo.glhandle && ibo_out && indexType != INDEX_DISABLE && numIndices && indexData)
+	{
+		ibo.indexCount = numIndices;
+		ibo.indexSize = egpfwIndexInternalSize[indexType];
+		ibo.internalType = egpfwIndexInternalType[indexType];
+		ibo.indexType = indexType;
+
+		// no VAO bound, so this does not attach the IBO to anything yet
+		egpfwStateBindVertexArray(0);
+		glGenBuffers(1, &ibo.glhandle);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo.glhandle);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * ibo.indexSize, indexData, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		egpfw_vao_active = 0;
+	}
+	if (ibo_out)
+		*ibo_out = ibo;
 	return vbo;
 }
 
 egpVertexArrayObjectDescriptor egpfwCreateVAO(const egpPrimitiveType primType, egpVertexBufferObjectDescriptor *vbo, egpIndexBufferObjectDescriptor *ibo)
 {
 	egpVertexArrayObjectDescriptor vao = { 0 };
-	//...
+	if (vbo && vbo->glhandle)
+	{
+		glGenVertexArrays(1, &vao.glhandle);
+		egpfwStateBindVertexArray(vao.glhandle);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo->glhandle);
+		egpfwSetAttribPointers(vbo);
+
+		// element buffer binding is VAO state, so it stays attached
+		if (ibo && ibo->glhandle)
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->glhandle);
+			vao.ibo = ibo;
+			++ibo->refCount;
+		}
+
+		egpfwStateBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		egpfw_vao_active = 0;
+
+		vao.vbo = vbo;
+		++vbo->refCount;
+		vao.primType = primType;
+		vao.internalPrim = egpfwPrimitive[primType];
+	}
+	else
+		printf("\n VAO creation failed! Invalid VBO.");
 	return vao;
 }
 
@@ -121,44 +404,633 @@ egpVertexArrayObjectDescriptor egpfwCreateVAOInterleavedIndexed(const egpPrimiti
 
 void egpfwActivateVAO(const egpVertexArrayObjectDescriptor *vao)
 {
-	//...
+	egpfwStateBindVertexArray(vao ? vao->glhandle : 0);
+	egpfw_vao_active = vao;
 }
 
 void egpfwDrawActiveVAO()
 {
-	//...
+	const egpVertexArrayObjectDescriptor *vao = egpfw_vao_active;
+	if (vao)
+	{
+		if (vao->ibo)
+			glDrawElements(vao->internalPrim, vao->ibo->indexCount, vao->ibo->internalType, 0);
+		else
+			glDrawArrays(vao->internalPrim, 0, vao->vbo->vertexCount);
+	}
 }
 
 void egpfwDrawActiveVAOPartial(const unsigned int first, const unsigned int count)
 {
-	//...
+	const egpVertexArrayObjectDescriptor *vao = egpfw_vao_active;
+	if (vao)
+	{
+		if (vao->ibo)
+			glDrawElements(vao->internalPrim, count, vao->ibo->internalType, BUFFER_OFFSET(first * vao->ibo->indexSize));
+		else
+			glDrawArrays(vao->internalPrim, first, count);
+	}
 }
 
 void egpfwDrawActiveVAOInstanced(const unsigned int primCount)
 {
-	//...
+	const egpVertexArrayObjectDescriptor *vao = egpfw_vao_active;
+	if (vao)
+	{
+		if (vao->ibo)
+			glDrawElementsInstanced(vao->internalPrim, vao->ibo->indexCount, vao->ibo->internalType, 0, primCount);
+		else
+			glDrawArraysInstanced(vao->internalPrim, 0, vao->vbo->vertexCount, primCount);
+	}
 }
 
 void egpfwDrawActiveVAOInstancedPartial(const unsigned int primCount, const unsigned int first, const unsigned int count)
 {
-	//...
+	const egpVertexArrayObjectDescriptor *vao = egpfw_vao_active;
+	if (vao)
+	{
+		if (vao->ibo)
+			glDrawElementsInstanced(vao->internalPrim, count, vao->ibo->internalType, BUFFER_OFFSET(first * vao->ibo->indexSize), primCount);
+		else
+			glDrawArraysInstanced(vao->internalPrim, first, count, primCount);
+	}
 }
 
 int egpfwReleaseVBO(egpVertexBufferObjectDescriptor *vbo)
 {
-	//...
+	// VAOs using it must be released first
+	if (vbo && vbo->glhandle && !vbo->refCount)
+	{
+		glDeleteBuffers(1, &vbo->glhandle);
+		memset(vbo, 0, sizeof(egpVertexBufferObjectDescriptor));
+		return 1;
+	}
 	return 0;
 }
 
 int egpfwReleaseIBO(egpIndexBufferObjectDescriptor *ibo)
 {
-	//...
+	if (ibo && ibo->glhandle && !ibo->refCount)
+	{
+		glDeleteBuffers(1, &ibo->glhandle);
+		memset(ibo, 0, sizeof(egpIndexBufferObjectDescriptor));
+		return 1;
+	}
 	return 0;
 }
 
 int egpfwReleaseVAO(egpVertexArrayObjectDescriptor *vao)
 {
-	//...
+	if (vao && vao->glhandle)
+	{
+		if (egpfw_vao_active == vao)
+			egpfwActivateVAO(0);
+		glDeleteVertexArrays(1, &vao->glhandle);
+		egpfwStateForget(STATE_VERTEX_ARRAY, vao->glhandle);
+		if (vao->vbo && vao->vbo->refCount)
+			--vao->vbo->refCount;
+		if (vao->ibo && vao->ibo->refCount)
+			--vao->ibo->refCount;
+		memset(vao, 0, sizeof(egpVertexArrayObjectDescriptor));
+		return 1;
+	}
+	return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// dynamic vertex buffers
+
+// ****
+// whether persistent mapping is available at runtime
+static int egpfwDynamicPersistentSupported()
+{
+#ifdef _WIN32
+	return (GLEW_ARB_buffer_storage || GLEW_VERSION_4_4);
+#else	// !_WIN32
+	// OS X tops out at GL 4.1, no buffer storage
+	return 0;
+#endif	// _WIN32
+}
+
+// ****
+// block until the GPU is done with a region and delete its fence
+static void egpfwDynamicWaitRegion(egpDynamicVertexBufferDescriptor *dvbo, const unsigned int region)
+{
+	GLsync fence = (GLsync)dvbo->fence[region];
+	GLenum status;
+	if (fence)
+	{
+		// flush on the first try so the fence is guaranteed to signal
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fence, 0, 1000000);
+		glDeleteSync(fence);
+		dvbo->fence[region] = 0;
+	}
+}
+
+
+int egpfwCreateDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo_out, const egpPrimitiveType primType, const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int maxVertices)
+{
+	unsigned int totalSize, handle[2];
+	egpAttributeType attribTypes[16];
+
+	if (dvbo_out && !dvbo_out->vbo.glhandle && attribs && numAttribs && maxVertices)
+	{
+		if (!egpfwGatherAttribs(attribs, numAttribs, attribTypes, 0))
+			return 0;
+
+		memset(dvbo_out, 0, sizeof(egpDynamicVertexBufferDescriptor));
+		memcpy(dvbo_out->vbo.attribTypes, attribTypes, sizeof(attribTypes));
+		dvbo_out->vbo.vertexSize = egpfwVertexSize(attribTypes);
+		totalSize = dvbo_out->vbo.vertexSize * maxVertices * EGPFW_DYNAMIC_REGIONS;
+		dvbo_out->persistent = egpfwDynamicPersistentSupported();
+
+		glGenVertexArrays(1, handle);
+		glGenBuffers(1, handle + 1);
+		egpfwStateBindVertexArray(handle[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
+
+#ifdef _WIN32
+		if (dvbo_out->persistent)
+		{
+			//Immutable storage mapped once for the lifetime of the buffer
+			//Coherent so writes are visible to draws without explicit flushes
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, totalSize, 0, flags);
+			dvbo_out->mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+			if (!dvbo_out->mapped)
+			{
+				//Storage is immutable now, so the fallback needs a fresh buffer
+				dvbo_out->persistent = 0;
+				glDeleteBuffers(1, handle + 1);
+				glGenBuffers(1, handle + 1);
+				glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
+			}
+		}
+#endif	// _WIN32
+
+		if (!dvbo_out->persistent)
+		{
+			//Fallback: stage in system memory and upload what gets drawn
+			glBufferData(GL_ARRAY_BUFFER, totalSize, 0, GL_STREAM_DRAW);
+			dvbo_out->mapped = malloc(totalSize);
+		}
+
+		//Attribute pointers, same layout as any other interleaved VBO
+		egpfwSetAttribPointers(&dvbo_out->vbo);
+
+		egpfwStateBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		egpfw_vao_active = 0;
+
+		dvbo_out->vbo.glhandle = handle[1];
+		dvbo_out->vbo.vertexCount = maxVertices * EGPFW_DYNAMIC_REGIONS;
+		dvbo_out->vbo.refCount = 1;
+		dvbo_out->vao.glhandle = handle[0];
+		dvbo_out->vao.primType = primType;
+		dvbo_out->vao.internalPrim = egpfwPrimitive[primType];
+		dvbo_out->vao.vbo = &dvbo_out->vbo;
+		dvbo_out->regionVertices = maxVertices;
+		return 1;
+	}
+	return 0;
+}
+
+void *egpfwMapDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo, const unsigned int numVertices, unsigned int *first_out)
+{
+	unsigned int first;
+	if (dvbo && dvbo->mapped && first_out && numVertices && dvbo->used + numVertices <= dvbo->regionVertices)
+	{
+		//First write this frame: region was last drawn from EGPFW_DYNAMIC_REGIONS frames ago
+		if (!dvbo->used)
+			egpfwDynamicWaitRegion(dvbo, dvbo->region);
+
+		first = dvbo->region * dvbo->regionVertices + dvbo->used;
+		dvbo->used += numVertices;
+		*first_out = first;
+		return ((char *)dvbo->mapped + first * dvbo->vbo.vertexSize);
+	}
+	return 0;
+}
+
+void egpfwDrawDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo, const unsigned int first, const unsigned int count)
+{
+	if (dvbo && dvbo->vao.glhandle && count)
+	{
+		if (!dvbo->persistent)
+		{
+			//Each draw gets its own untouched range, so the upload never overwrites data in flight
+			glBindBuffer(GL_ARRAY_BUFFER, dvbo->vbo.glhandle);
+			glBufferSubData(GL_ARRAY_BUFFER, first * dvbo->vbo.vertexSize, count * dvbo->vbo.vertexSize, (char *)dvbo->mapped + first * dvbo->vbo.vertexSize);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		egpfwActivateVAO(&dvbo->vao);
+		egpfwDrawActiveVAOPartial(first, count);
+	}
+}
+
+void egpfwAdvanceDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo)
+{
+	if (dvbo && dvbo->vao.glhandle)
+	{
+		//Only fence regions that were written; the fallback path relies on the driver instead
+		if (dvbo->persistent && dvbo->used)
+			dvbo->fence[dvbo->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		dvbo->region = (dvbo->region + 1) % EGPFW_DYNAMIC_REGIONS;
+		dvbo->used = 0;
+	}
+}
+
+int egpfwReleaseDynamicVBO(egpDynamicVertexBufferDescriptor *dvbo)
+{
+	unsigned int i;
+	if (dvbo && dvbo->vao.glhandle)
+	{
+		for (i = 0; i < EGPFW_DYNAMIC_REGIONS; ++i)
+			if (dvbo->fence[i])
+				glDeleteSync((GLsync)dvbo->fence[i]);
+
+		if (dvbo->persistent)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, dvbo->vbo.glhandle);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		else
+			free(dvbo->mapped);
+
+		// unbind first in case it is the active one
+		if (egpfw_vao_active == &dvbo->vao)
+			egpfwActivateVAO(0);
+		glDeleteVertexArrays(1, &dvbo->vao.glhandle);
+		egpfwStateForget(STATE_VERTEX_ARRAY, dvbo->vao.glhandle);
+		glDeleteBuffers(1, &dvbo->vbo.glhandle);
+		memset(dvbo, 0, sizeof(egpDynamicVertexBufferDescriptor));
+		return 1;
+	}
+	return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// mesh pool and indirect drawing
+
+int egpfwMultiDrawIndirectSupported()
+{
+#ifdef _WIN32
+	return (GLEW_ARB_multi_draw_indirect || GLEW_VERSION_4_3);
+#else	// !_WIN32
+	// OS X tops out at GL 4.1, no multi-draw or base instance
+	return 0;
+#endif	// _WIN32
+}
+
+// ****
+// make a page's buffers and VAO, sized for the pool
+static int egpfwCreateMeshPoolPage(const egpMeshPoolDescriptor *pool, egpMeshPoolPage *page)
+{
+	unsigned int vertexSize = egpfwVertexSize(pool->attribTypes);
+
+	memset(page, 0, sizeof(egpMeshPoolPage));
+	memcpy(page->vbo.attribTypes, pool->attribTypes, sizeof(pool->attribTypes));
+	page->vbo.vertexSize = vertexSize;
+	page->vbo.vertexCount = pool->pageVertices;
+	page->ibo.indexCount = pool->pageIndices;
+	page->ibo.indexSize = egpfwIndexInternalSize[INDEX_UINT];
+	page->ibo.internalType = egpfwIndexInternalType[INDEX_UINT];
+	page->ibo.indexType = INDEX_UINT;
+
+	glGenBuffers(1, &page->vbo.glhandle);
+	glGenBuffers(1, &page->ibo.glhandle);
+	glGenVertexArrays(1, &page->vao.glhandle);
+	if (!page->vbo.glhandle || !page->ibo.glhandle || !page->vao.glhandle)
+		return 0;
+
+	egpfwStateBindVertexArray(page->vao.glhandle);
+	glBindBuffer(GL_ARRAY_BUFFER, page->vbo.glhandle);
+	glBufferData(GL_ARRAY_BUFFER, pool->pageVertices * vertexSize, 0, GL_STATIC_DRAW);
+	egpfwSetAttribPointers(&page->vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ibo.glhandle);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, pool->pageIndices * page->ibo.indexSize, 0, GL_STATIC_DRAW);
+
+	// one index per instance: base instance N fetches N
+	if (pool->drawIndexHandle)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, pool->drawIndexHandle);
+		glEnableVertexAttribArray(EGPFW_DRAW_INDEX_ATTRIB);
+		glVertexAttribIPointer(EGPFW_DRAW_INDEX_ATTRIB, 1, GL_INT, 0, BUFFER_OFFSET(0));
+		glVertexAttribDivisor(EGPFW_DRAW_INDEX_ATTRIB, 1);
+	}
+
+	egpfwStateBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	egpfw_vao_active = 0;
+
+	page->vao.primType = pool->primType;
+	page->vao.internalPrim = egpfwPrimitive[pool->primType];
+	page->vao.vbo = &page->vbo;
+	page->vao.ibo = &page->ibo;
+	page->vbo.refCount = page->ibo.refCount = 1;
+	return 1;
+}
+
+int egpfwCreateMeshPool(egpMeshPoolDescriptor *pool_out, const egpPrimitiveType primType, const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int pageVertices, const unsigned int pageIndices)
+{
+	int *drawIndex;
+	unsigned int i;
+	egpAttributeType attribTypes[16];
+
+	if (pool_out && !pool_out->numPages && attribs && numAttribs && pageVertices && pageIndices)
+	{
+		if (!egpfwGatherAttribs(attribs, numAttribs, attribTypes, 0) || attribTypes[EGPFW_DRAW_INDEX_ATTRIB] != ATTRIB_DISABLE)
+			return 0;
+
+		memset(pool_out, 0, sizeof(egpMeshPoolDescriptor));
+		memcpy(pool_out->attribTypes, attribTypes, sizeof(attribTypes));
+		pool_out->primType = primType;
+		pool_out->pageVertices = pageVertices;
+		pool_out->pageIndices = pageIndices;
+		pool_out->multiDraw = egpfwMultiDrawIndirectSupported();
+
+		// draw index attribute source, shared by every page
+		if (pool_out->multiDraw)
+		{
+			drawIndex = (int *)malloc(EGPFW_DRAW_INDEX_COUNT * sizeof(int));
+			if (!drawIndex)
+				return 0;
+			for (i = 0; i < EGPFW_DRAW_INDEX_COUNT; ++i)
+				drawIndex[i] = (int)i;
+			glGenBuffers(1, &pool_out->drawIndexHandle);
+			glBindBuffer(GL_ARRAY_BUFFER, pool_out->drawIndexHandle);
+			glBufferData(GL_ARRAY_BUFFER, EGPFW_DRAW_INDEX_COUNT * sizeof(int), drawIndex, GL_STATIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			free(drawIndex);
+		}
+		return 1;
+	}
+	return 0;
+}
+
+int egpfwMeshPoolAdd(egpMeshPoolDescriptor *pool, const egpAttributeDescriptor *attribs, const unsigned int numAttribs, const unsigned int numVertices, const egpIndexType indexType, const unsigned int numIndices, const void *indexData, egpMeshPoolMesh *mesh_out)
+{
+	egpAttributeDescriptor converted[16] = { 0 };
+	const egpAttributeDescriptor *attribsByName[16];
+	egpAttributeType attribTypes[16];
+	egpMeshPoolPage *page = 0;
+	unsigned char *vertices;
+	unsigned int *indices;
+	unsigned int i, count, type;
+	int sequential;
+
+	if (!pool || !pool->pageVertices || !attribs || !numAttribs || !numVertices || !mesh_out)
+		return 0;
+	sequential = (indexType == INDEX_DISABLE || !indexData);
+	count = sequential ? numVertices : numIndices;
+	if (!count || numVertices > pool->pageVertices || count > pool->pageIndices)
+		return 0;
+
+	// match the mesh's attributes to the pool's format
+	egpfwGatherAttribs(attribs, numAttribs, attribTypes, attribsByName);
+	for (i = 0; i < 16; ++i)
+	{
+		type = pool->attribTypes[i];
+		if (type != ATTRIB_DISABLE)
+		{
+			converted[i].name = (egpAttributeName)i;
+			converted[i].type = (egpAttributeType)type;
+			if (attribsByName[i])
+			{
+				if (egpfwAttribSourceElems[type] != egpfwAttribSourceElems[attribTypes[i]] || 
+					(egpfwAttribInternalType[type] == GL_INT) != (egpfwAttribInternalType[attribTypes[i]] == GL_INT))
+				{
+					printf("\n Mesh pool add failed! Attribute %u does not match pool format.", i);
+					return 0;
+				}
+				converted[i].data = attribsByName[i]->data;
+			}
+		}
+		attribsByName[i] = type != ATTRIB_DISABLE ? converted + i : 0;
+	}
+
+	// first fit
+	for (i = 0; i < pool->numPages && !page; ++i)
+		if (pool->page[i].usedVertices + numVertices <= pool->pageVertices && pool->page[i].usedIndices + count <= pool->pageIndices)
+			page = pool->page + i;
+	if (!page)
+	{
+		if (pool->numPages == EGPFW_MESH_POOL_PAGES)
+		{
+			printf("\n Mesh pool add failed! All pages are full.");
+			return 0;
+		}
+		page = pool->page + pool->numPages;
+		if (!egpfwCreateMeshPoolPage(pool, page))
+		{
+			egpfwStateBindVertexArray(0);
+			egpfw_vao_active = 0;
+			glDeleteVertexArrays(1, &page->vao.glhandle);
+			glDeleteBuffers(1, &page->vbo.glhandle);
+			glDeleteBuffers(1, &page->ibo.glhandle);
+			memset(page, 0, sizeof(egpMeshPoolPage));
+			return 0;
+		}
+		++pool->numPages;
+	}
+
+	vertices = (unsigned char *)calloc(numVertices, page->vbo.vertexSize);
+	indices = (unsigned int *)malloc(count * sizeof(unsigned int));
+	if (!vertices || !indices)
+	{
+		free(vertices);
+		free(indices);
+		return 0;
+	}
+
+	egpfwInterleave(vertices, attribsByName, numVertices);
+	for (i = 0; i < count; ++i)
+	{
+		if (sequential)
+			indices[i] = i;
+		else switch (indexType)
+		{
+		case INDEX_BYTE:
+		case INDEX_UBYTE:
+			indices[i] = ((const unsigned char *)indexData)[i];
+			break;
+		case INDEX_SHORT:
+		case INDEX_USHORT:
+			indices[i] = ((const unsigned short *)indexData)[i];
+			break;
+		default:
+			indices[i] = ((const unsigned int *)indexData)[i];
+		}
+	}
+
+	// element buffer is bound through the page's own VAO, which already has it
+	egpfwStateBindVertexArray(page->vao.glhandle);
+	glBindBuffer(GL_ARRAY_BUFFER, page->vbo.glhandle);
+	glBufferSubData(GL_ARRAY_BUFFER, page->usedVertices * page->vbo.vertexSize, numVertices * page->vbo.vertexSize, vertices);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, page->usedIndices * sizeof(unsigned int), count * sizeof(unsigned int), indices);
+	egpfwStateBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	egpfw_vao_active = 0;
+	free(vertices);
+	free(indices);
+
+	mesh_out->page = (unsigned int)(page - pool->page);
+	mesh_out->baseVertex = page->usedVertices;
+	mesh_out->firstIndex = page->usedIndices;
+	mesh_out->indexCount = count;
+	page->usedVertices += numVertices;
+	page->usedIndices += count;
+	return 1;
+}
+
+egpDrawIndirectCommand egpfwMeshPoolCommand(const egpMeshPoolMesh *mesh, const unsigned int drawIndex)
+{
+	egpDrawIndirectCommand cmd = { 0 };
+	if (mesh)
+	{
+		cmd.count = mesh->indexCount;
+		cmd.instanceCount = 1;
+		cmd.firstIndex = mesh->firstIndex;
+		cmd.baseVertex = (int)mesh->baseVertex;
+		cmd.baseInstance = drawIndex;
+	}
+	return cmd;
+}
+
+int egpfwCreateIndirectBuffer(egpIndirectBufferDescriptor *buf_out, const unsigned int capacity)
+{
+	if (buf_out && !buf_out->commands && capacity)
+	{
+		memset(buf_out, 0, sizeof(egpIndirectBufferDescriptor));
+		buf_out->commands = (egpDrawIndirectCommand *)malloc(capacity * sizeof(egpDrawIndirectCommand));
+		if (!buf_out->commands)
+			return 0;
+		buf_out->capacity = capacity;
+
+		if (egpfwMultiDrawIndirectSupported())
+		{
+			glGenBuffers(1, &buf_out->glhandle);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buf_out->glhandle);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(egpDrawIndirectCommand), 0, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		return 1;
+	}
+	return 0;
+}
+
+int egpfwUploadIndirectBuffer(egpIndirectBufferDescriptor *buf, const egpDrawIndirectCommand *commands, const unsigned int count)
+{
+	egpDrawIndirectCommand *grown;
+	unsigned int capacity;
+	if (!buf || !buf->commands || (count && !commands))
+		return 0;
+
+	capacity = buf->capacity;
+	if (count > capacity)
+	{
+		while (capacity < count)
+			capacity *= 2;
+		grown = (egpDrawIndirectCommand *)realloc(buf->commands, capacity * sizeof(egpDrawIndirectCommand));
+		if (!grown)
+			return 0;
+		buf->commands = grown;
+		buf->capacity = capacity;
+	}
+
+	memcpy(buf->commands, commands, count * sizeof(egpDrawIndirectCommand));
+	buf->count = count;
+
+	// whole buffer is replaced, so the driver can orphan the old storage 
+	//	instead of waiting for draws still reading it
+	if (buf->glhandle)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buf->glhandle);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, buf->capacity * sizeof(egpDrawIndirectCommand), 0, GL_DYNAMIC_DRAW);
+		if (count)
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(egpDrawIndirectCommand), commands);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	return 1;
+}
+
+void egpfwDrawMeshPoolIndirect(const egpMeshPoolDescriptor *pool, const unsigned int page, const egpIndirectBufferDescriptor *buf, const unsigned int first, const unsigned int count)
+{
+	const egpDrawIndirectCommand *cmd;
+	const egpVertexArrayObjectDescriptor *vao;
+	unsigned int i;
+	if (!pool || page >= pool->numPages || !buf || !count)
+		return;
+
+	// both paths read the same commands, so both reject a range past them
+	if (first > buf->count || count > buf->count - first)
+		return;
+
+	vao = &pool->page[page].vao;
+	egpfwActivateVAO(vao);
+
+#ifdef _WIN32
+	if (pool->multiDraw && buf->glhandle)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buf->glhandle);
+		glMultiDrawElementsIndirect(vao->internalPrim, GL_UNSIGNED_INT, BUFFER_OFFSET(first * sizeof(egpDrawIndirectCommand)), count, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		return;
+	}
+#endif	// _WIN32
+
+	// fallback: same commands, one call each
+	for (i = 0, cmd = buf->commands + first; i < count; ++i, ++cmd)
+	{
+		glVertexAttribI1i(EGPFW_DRAW_INDEX_ATTRIB, (int)cmd->baseInstance);
+		glDrawElementsInstancedBaseVertex(vao->internalPrim, cmd->count, GL_UNSIGNED_INT, BUFFER_OFFSET(cmd->firstIndex * sizeof(unsigned int)), cmd->instanceCount, cmd->baseVertex);
+	}
+}
+
+void egpfwSetDrawIndex(const unsigned int drawIndex)
+{
+	glVertexAttribI1i(EGPFW_DRAW_INDEX_ATTRIB, (int)drawIndex);
+}
+
+int egpfwReleaseIndirectBuffer(egpIndirectBufferDescriptor *buf)
+{
+	if (buf && buf->commands)
+	{
+		if (buf->glhandle)
+			glDeleteBuffers(1, &buf->glhandle);
+		free(buf->commands);
+		memset(buf, 0, sizeof(egpIndirectBufferDescriptor));
+		return 1;
+	}
+	return 0;
+}
+
+int egpfwReleaseMeshPool(egpMeshPoolDescriptor *pool)
+{
+	unsigned int i;
+	egpMeshPoolPage *page;
+	if (pool && pool->pageVertices)
+	{
+		for (i = 0, page = pool->page; i < pool->numPages; ++i, ++page)
+		{
+			// unbind first in case it is the active one
+			if (egpfw_vao_active == &page->vao)
+				egpfwActivateVAO(0);
+			glDeleteVertexArrays(1, &page->vao.glhandle);
+			egpfwStateForget(STATE_VERTEX_ARRAY, page->vao.glhandle);
+			glDeleteBuffers(1, &page->vbo.glhandle);
+			glDeleteBuffers(1, &page->ibo.glhandle);
+		}
+		if (pool->drawIndexHandle)
+			glDeleteBuffers(1, &pool->drawIndexHandle);
+		memset(pool, 0, sizeof(egpMeshPoolDescriptor));
+		return 1;
+	}
 	return 0;
 }
 
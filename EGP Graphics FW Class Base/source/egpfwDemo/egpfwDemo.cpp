@@ -19,7 +19,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <string>
 
 // third party math lib
 #include "cbmath/cbtkMatrix.h"
@@ -40,9 +42,15 @@
 
 #include "egpfw/egpfw.h"
 #include "../../project/VS2015/egpfw/RenderPath.h"
+#include "../../project/VS2015/egpfw/FrameGraph.h"
+#include "../../project/VS2015/egpfw/RenderQueue.h"
 #include "../../project/VS2015/egpfw/RenderNetgraph.h"
 #include "../../project/VS2015/egpfw/KeyframeWindow.h"
 #include "../../project/VS2015/egpfw/SpeedControlWindow.h"
+#include "../../project/VS2015/egpfw/AssetLoader.h"
+#include "../../project/VS2015/egpfw/DynamicResolution.h"
+#include "../../project/VS2015/egpfw/LightClusters.h"
+#include "../../project/VS2015/egpfw/BlurChain.h"
 #include <GL/freeglut.h>
 
 
@@ -86,8 +94,6 @@ float cameraElevation = 0.25f, cameraAzimuth = 4.0f;
 float cameraRotateSpeed = 0.25f, cameraMoveSpeed = 4.0f, cameraDistance = 8.0f;
 cbtk::cbmath::vec4 cameraPosWorld(1.0f, -2.0f, -cameraDistance, 1.0f), deltaCamPos;
 
-float CONST_ZERO_FLOAT = 0.0f;
-
 enum RenderMethod
 {
 	bloomRenderMethod = 0,
@@ -111,12 +117,20 @@ RenderMethod& operator++(RenderMethod& a)
 RenderMethod currentRenderMode = bloomRenderMethod;
 bool displayNetgraphToggle = true;
 
+// GL calls made and skipped by the state cache last frame
+egpStateCacheStats stateCacheStats = { 0 };
+
 //-----------------------------------------------------------------------------
 // graphics-related data and handles
 // good practice: default values for everything
 
 egpVertexArrayObjectDescriptor vao[modelCount] = { 0 };
 egpVertexBufferObjectDescriptor vbo[modelCount] = { 0 };
+egpIndexBufferObjectDescriptor ibo[modelCount] = { 0 };
+
+// deferred scene meshes, all in one pool so the scene is a few multi-draws
+egpMeshPoolDescriptor scenePool = { 0 };
+egpMeshPoolMesh poolMesh[poolMeshCount] = { 0 };
 
 
 // loaded textures
@@ -170,7 +184,8 @@ cbmath::mat4 curveDrawingProjectionMatrix, waypointModelMatrix = cbmath::makeSca
 // light positions and colors
 // for the colors, let the xyz components represent color in rgb, and 
 //	the w component represent the radius of the light volume
-const unsigned int numLights = 16, numLightsShading = 4;
+// the first few are placed by hand, the rest are made up by setupLights
+const unsigned int numLights = 1024, numLightsPlaced = 16;
 cbmath::vec4 lightPos_world[numLights] = {
 	cbmath::vec4(0.0f, 0.0f, 0.0f, 1.0f),
 	cbmath::vec4(10.0f, 0.0f, 0.0f, 1.0f),
@@ -214,12 +229,64 @@ cbmath::vec4 lightColor[numLights] = {
 	cbmath::vec4(1.0f, 0.0f, 0.5f, 2.0f),
 };
 
+// made-up lights circle the origin above the ground
+// x: distance, y: angle, z: angular speed, w: height
+cbmath::vec4 lightOrbit[numLights];
+
+// deferred shading reads the lights through clusters over the view frustum
+LightClusters lightClusters;
 
 
 // light and camera for shading
 cbmath::vec4 lightPos_object, eyePos_object;
 
 
+// uniform blocks (std140), laid out exactly like the blocks in the shaders
+struct FrameUniformBlock
+{
+	cbmath::mat4 viewprojMat;
+	cbmath::vec4 eyePos;
+	cbmath::vec4 clusterGrid;	// xyz: light cluster tiles across, tiles down, depth slices
+	cbmath::vec4 clusterDepth;	// view depth from depth, cluster slice from view depth
+	cbmath::vec4 targetScale;	// xy: part of each render target the frame covers
+	cbmath::mat4 viewprojMatInv;	// g-buffer positions come back from depth with this
+};
+
+struct ObjectUniformBlock
+{
+	cbmath::mat4 modelMat, atlasMat, mvp;
+	cbmath::vec4 lightPos_object, eyePos_object;
+	float normalScale;
+	unsigned int materialId;	// written to the g-buffer; 0 is nothing drawn
+	float pad[2];
+};
+
+static_assert(sizeof(FrameUniformBlock) == 128 + 16 * 4, "FrameUniformBlock must match std140 layout");
+static_assert(sizeof(ObjectUniformBlock) == 240, "ObjectUniformBlock must match std140 layout");
+
+// one buffer for the frame block, one holding every object's range
+egpUniformBufferObjectDescriptor frameUBO, objectUBO;
+// objects are bound as one range each or, by the deferred scene, as an array of 
+//	the whole buffer; 256 is the largest offset alignment GL allows, so it 
+//	works for both
+const unsigned int objectUniformStride = 256;
+std::vector<unsigned char> objectUniformData;
+
+// render targets that blur and deferred shading passes read by slot instead of 
+//	binding them per pass; bindless if the driver can, units 16+ if not
+egpTextureTableDescriptor textureTable = { TEXTURE_TABLE_UNITS };
+const egpTextureTableMode textureTableMode = TEXTURE_TABLE_BINDLESS;
+const unsigned int textureTableFirstUnit = 16;
+
+// most samplers a shader reading the table has of its own (deferred 
+//	shading: two atlases and the light lists)
+const unsigned int textureTableOwnSamplers = 3;
+
+// slot indices sent to the passes as ivec4s
+int textureTableIndex[textureTableSlotCount][4];
+int gbufferTableIndex[4] = { table_gbufferDepth, table_gbufferNormal, table_gbufferSurface, 0 };
+
+
 // raw animation values: 
 float earthDaytime = 0.0f;
 float earthOrbit = 0.0f;
@@ -235,12 +302,51 @@ const float moonTilt = Deg2Rad(6.69f);
 const float moonDistance = 4.0f;
 const float moonSize = 0.27f;
 
-RenderPath globalRenderPath;
+FrameGraph frameGraph(fbo);
+
+// deferred scene objects, sorted by state and drawn by one pass
+RenderQueue sceneQueue(fbo, glslPrograms);
+
+// bloom and depth of field blur into the same three levels, half, quarter 
+//	and eighth size; each level has two targets, the second is its result
+BlurChain blurChain(fbo, glslPrograms, glslCommonUniforms, vao + fsqModel);
+const BlurTarget blurLevels[3][2] = {
+	{ BlurTarget(hblurFBO_d2, textureTableIndex[table_hblurD2], pixelSizeInv + hblurFBO_d2), BlurTarget(vblurFBO_d2, textureTableIndex[table_vblurD2], pixelSizeInv + vblurFBO_d2) },
+	{ BlurTarget(hblurFBO_d4, textureTableIndex[table_hblurD4], pixelSizeInv + hblurFBO_d4), BlurTarget(vblurFBO_d4, textureTableIndex[table_vblurD4], pixelSizeInv + vblurFBO_d4) },
+	{ BlurTarget(hblurFBO_d8, textureTableIndex[table_hblurD8], pixelSizeInv + hblurFBO_d8), BlurTarget(vblurFBO_d8, textureTableIndex[table_vblurD8], pixelSizeInv + vblurFBO_d8) },
+};
+
+// every render method is compiled at startup, switching just activates another; 
+//	targets of the ones not showing are kept up to the budget
+CompiledFrameGraph renderMethodGraph[numRenderMethods];
+const size_t renderTargetPoolBudget = 64 * 1024 * 1024;
+bool profilePasses = false;
+
+// render path resolution follows GPU frame time: the frame is drawn into 
+//	part of the targets and stretched over the window by the final pass
+DynamicResolution dynamicResolution;
+const float frameTimeTargetMs = 1000.0f / 60.0f;
+const float minRenderScale = 0.5f, maxRenderScale = 1.0f;
+
+RenderPath& activeRenderPath()
+{
+	return renderMethodGraph[currentRenderMode].path;
+}
+
 RenderNetgraph globalRenderNetgraph(fbo, vao + fsqModel, glslPrograms, glslCommonUniforms[testTextureProgramIndex]);
 
 KeyframeWindow keyframeWindow(vao, fbo, glslPrograms);
 SpeedControlWindow speedControlWindow(vao, fbo, glslPrograms);
 
+// models and images load in the background; the earth textures alone are 8MB each, 
+//	so one of those per frame at most
+AssetLoader assetLoader(2, 32 * 1024 * 1024, 8 * 1024 * 1024);
+
+// light clusters cull and the scene queue sorts on these every frame, and 
+//	render paths record their passes on them; the main thread helps, so 
+//	one fewer than the cores
+JobSystem jobSystem(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+
 
 //-----------------------------------------------------------------------------
 // game functions
@@ -278,16 +384,16 @@ int initGL()
 	glActiveTexture(GL_TEXTURE0);
 
 	// backface culling ON
-	glEnable(GL_CULL_FACE);
+	egpfwStateSetCapability(GL_CULL_FACE, 1);
 	glCullFace(GL_BACK);
 
 	// depth testing OFF
-	glDisable(GL_DEPTH_TEST);
+	egpfwStateSetCapability(GL_DEPTH_TEST, 0);
 	glDepthFunc(GL_LESS);
 
 	// alpha blending OFF
 	// result = ( new*[new alpha] ) + ( old*[1 - new alpha] )
-	glDisable(GL_BLEND);
+	egpfwStateSetCapability(GL_BLEND, 0);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// lines and points
@@ -341,71 +447,91 @@ void setupGeometry()
 	// good news is they all use the same attribute descriptors, 
 	//	so prepare those first
 	egpAttributeDescriptor attribs[] = {
-		egpCreateAttributeDescriptor(ATTRIB_POSITION, ATTRIB_VEC3, 0),
-		egpCreateAttributeDescriptor(ATTRIB_COLOR, ATTRIB_VEC3, 0),
-		egpCreateAttributeDescriptor(ATTRIB_NORMAL, ATTRIB_VEC3, 0),
-		egpCreateAttributeDescriptor(ATTRIB_TEXCOORD, ATTRIB_VEC2, 0),
+		egpfwCreateAttributeDescriptor(ATTRIB_POSITION, ATTRIB_VEC3, 0),
+		egpfwCreateAttributeDescriptor(ATTRIB_COLOR, ATTRIB_VEC3, 0),
+		egpfwCreateAttributeDescriptor(ATTRIB_NORMAL, ATTRIB_VEC3, 0),
+		egpfwCreateAttributeDescriptor(ATTRIB_TEXCOORD, ATTRIB_VEC2, 0),
 	};
 
 	// axes
 	attribs[0].data = egpGetAxesPositions();
 	attribs[1].data = egpGetAxesColors();
-	vao[axesModel] = egpCreateVAOInterleaved(PRIM_LINES, attribs, 2, egpGetAxesVertexCount(), (vbo + axesModel), 0);
+	vao[axesModel] = egpfwCreateVAOInterleaved(PRIM_LINES, attribs, 2, egpGetAxesVertexCount(), (vbo + axesModel), 0);
 
 	// skybox
 	attribs[0].data = egpGetCubePositions();
 	attribs[1].data = egpGetCubeColors();
 	attribs[2].data = egpGetCubeNormals();
 	attribs[3].data = egpGetCubeTexcoords();
-	vao[skyboxModel] = egpCreateVAOInterleaved(PRIM_TRIANGLES, attribs, 4, egpGetCubeVertexCount(), (vbo + skyboxModel), 0);
+	vao[skyboxModel] = egpfwCreateVAOInterleaved(PRIM_TRIANGLES, attribs, 4, egpGetCubeVertexCount(), (vbo + skyboxModel), 0);
 
 	// low-res sphere
 	attribs[0].data = egpGetSphere8x6Positions();
 	attribs[1].data = egpGetSphere8x6Colors();
 	attribs[2].data = egpGetSphere8x6Normals();
 	attribs[3].data = egpGetSphere8x6Texcoords();
-	vao[sphere8x6Model] = egpCreateVAOInterleaved(PRIM_TRIANGLES, attribs, 4, egpGetSphere8x6VertexCount(), (vbo + sphere8x6Model), 0);
+	vao[sphere8x6Model] = egpfwCreateVAOInterleaved(PRIM_TRIANGLES, attribs, 4, egpGetSphere8x6VertexCount(), (vbo + sphere8x6Model), 0);
 
 	// high-res sphere
 	attribs[0].data = egpGetSphere32x24Positions();
 	attribs[1].data = egpGetSphere32x24Colors();
 	attribs[2].data = egpGetSphere32x24Normals();
 	attribs[3].data = egpGetSphere32x24Texcoords();
-	vao[sphere32x24Model] = egpCreateVAOInterleaved(PRIM_TRIANGLES, attribs, 4, egpGetSphere32x24VertexCount(), (vbo + sphere32x24Model), 0);
+	vao[sphere32x24Model] = egpfwCreateVAOInterleaved(PRIM_TRIANGLES, attribs, 4, egpGetSphere32x24VertexCount(), (vbo + sphere32x24Model), 0);
 
 	// full-screen quad (positions and texcoords only!)
 	attribs[1] = attribs[3];
 	attribs[0].data = egpfwGetUnitQuadPositions();
 	attribs[1].data = egpfwGetUnitQuadTexcoords();
-	vao[fsqModel] = egpCreateVAOInterleaved(PRIM_TRIANGLE_STRIP, attribs, 2, 4, (vbo + fsqModel), 0);
+	vao[fsqModel] = egpfwCreateVAOInterleaved(PRIM_TRIANGLE_STRIP, attribs, 2, 4, (vbo + fsqModel), 0);
 
 	attribs[0].data = cbmath::v3zero.v;
-	vao[pointModel] = egpCreateVAOInterleaved(PRIM_POINT, attribs, 1, 1, (vbo + pointModel), 0);
+	vao[pointModel] = egpfwCreateVAOInterleaved(PRIM_POINT, attribs, 1, 1, (vbo + pointModel), 0);
 
-	// loaded models
-	// attempt to load binary first; if failed, load object and save binary
-	// binary save/load is not necessary, but it is very fast
-	egpTriOBJDescriptor obj[1];
-
-	// low-res sphere
-	*obj = egpfwLoadBinaryOBJ("sphere8x6_bin.txt");
-	if (!obj->data)
+	// scene pool: spheres and ground quad, with packed normals and texcoords
+	// mesh data is given as floats and packed on the way in
 	{
-		*obj = egpfwLoadTriangleOBJ("../../../../resource/obj/sphere8x6.obj", NORMAL_LOAD, 1.0);
-		egpfwSaveBinaryOBJ(obj, "sphere8x6_bin.txt");
+		egpAttributeDescriptor poolAttribs[] = {
+			egpfwCreateAttributeDescriptor(ATTRIB_POSITION, ATTRIB_VEC3, 0),
+			egpfwCreateAttributeDescriptor(ATTRIB_NORMAL, (egpAttributeType)ATTRIB_VEC3_SNORM10, 0),
+			egpfwCreateAttributeDescriptor(ATTRIB_TEXCOORD, (egpAttributeType)ATTRIB_VEC2_HALF, 0),
+		};
+		egpAttributeDescriptor meshAttribs[] = {
+			egpfwCreateAttributeDescriptor(ATTRIB_POSITION, ATTRIB_VEC3, 0),
+			egpfwCreateAttributeDescriptor(ATTRIB_TEXCOORD, ATTRIB_VEC2, 0),
+			egpfwCreateAttributeDescriptor(ATTRIB_NORMAL, ATTRIB_VEC3, 0),
+		};
+
+		// the pool draws lists, so the quad's strip becomes two triangles
+		const unsigned char quadIndices[] = { 0, 1, 2, 2, 1, 3 };
+
+		egpfwCreateMeshPool(&scenePool, PRIM_TRIANGLES, poolAttribs, 3, 65536, 65536);
+
+		meshAttribs[0].data = egpGetSphere8x6Positions();
+		meshAttribs[1].data = egpGetSphere8x6Texcoords();
+		meshAttribs[2].data = egpGetSphere8x6Normals();
+		egpfwMeshPoolAdd(&scenePool, meshAttribs, 3, egpGetSphere8x6VertexCount(), INDEX_DISABLE, 0, 0, poolMesh + sphereLowResPoolMesh);
+
+		meshAttribs[0].data = egpGetSphere32x24Positions();
+		meshAttribs[1].data = egpGetSphere32x24Texcoords();
+		meshAttribs[2].data = egpGetSphere32x24Normals();
+		egpfwMeshPoolAdd(&scenePool, meshAttribs, 3, egpGetSphere32x24VertexCount(), INDEX_DISABLE, 0, 0, poolMesh + sphereHiResPoolMesh);
+
+		// no normals, like the full-screen quad it used to be drawn with
+		meshAttribs[0].data = egpfwGetUnitQuadPositions();
+		meshAttribs[1].data = egpfwGetUnitQuadTexcoords();
+		egpfwMeshPoolAdd(&scenePool, meshAttribs, 2, 4, INDEX_UBYTE, 6, quadIndices, poolMesh + groundPoolMesh);
 	}
-	egpfwCreateVAOFromOBJ(obj, vao + sphereLowResObjModel, vbo + sphereLowResObjModel);
-	egpfwReleaseOBJ(obj);
 
-	// high-res sphere
-	*obj = egpfwLoadBinaryOBJ("sphere32x24_bin.txt");
-	if (!obj->data)
-	{
-		*obj = egpfwLoadTriangleOBJ("../../../../resource/obj/sphere32x24.obj", NORMAL_LOAD, 1.0);
-		egpfwSaveBinaryOBJ(obj, "sphere32x24_bin.txt");
-	}
-	egpfwCreateVAOFromOBJ(obj, vao + sphereHiResObjModel, vbo + sphereHiResObjModel);
-	egpfwReleaseOBJ(obj);
+	// loaded models
+	// these load in the background: binary first; if failed, load object and save binary
+	// binary save/load is not necessary, but it is very fast
+	// until they arrive, the built-in spheres stand in for them
+	// spheres are small and unit-sized, so packed vertices lose nothing visible
+	assetLoader.requestOBJ("../../../../resource/obj/sphere8x6.obj", "sphere8x6_bin.txt", NORMAL_LOAD, OPTIMIZE_ALL | OPTIMIZE_REPORT, true, 
+		vao + sphereLowResObjModel, vbo + sphereLowResObjModel, ibo + sphereLowResObjModel, vao + sphere8x6Model);
+	assetLoader.requestOBJ("../../../../resource/obj/sphere32x24.obj", "sphere32x24_bin.txt", NORMAL_LOAD, OPTIMIZE_ALL | OPTIMIZE_REPORT, true, 
+		vao + sphereHiResObjModel, vbo + sphereHiResObjModel, ibo + sphereHiResObjModel, vao + sphere32x24Model);
 
 	// geometry-related constants
 	groundModelMatrix = cbmath::makeTranslation4(0.0f, -5.0f, 0.0f) * cbmath::makeRotationX4(Deg2Rad(-90.0f)) * cbmath::makeScale4(10.0f, 10.0f, 1.0f);
@@ -424,9 +550,14 @@ void deleteGeometry()
 	unsigned int i;
 	for (i = 0; i < modelCount; ++i)
 	{
-		egpReleaseVAO(vao + i);
-		egpReleaseVBO(vbo + i);
+		egpfwReleaseVAO(vao + i);
+		egpfwReleaseVBO(vbo + i);
+		egpfwReleaseIBO(ibo + i);
 	}
+
+	// queue's indirect commands draw from the pool
+	sceneQueue.release();
+	egpfwReleaseMeshPool(&scenePool);
 }
 
 
@@ -451,32 +582,22 @@ void setupTextures()
 	};
 
 	// load
-	unsigned int ilHandle[textureCount] = { 0 }, status = 0, imgW = 0, imgH = 0;
-	const unsigned char *data = 0;
-	ilGenImages(textureCount, ilHandle);
+	// every texture starts as a single grey texel so its handle is usable 
+	//	right away; the real image replaces it when the loader gets to it
+	const unsigned char placeholder[4] = { 128, 128, 128, 255 };
 	ilEnable(IL_ORIGIN_SET);
 	ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
 	glGenTextures(textureCount, tex);
 	for (unsigned int i = 0; i < textureCount; ++i)
 	{
-		ilBindImage(ilHandle[i]);
-		status = ilLoadImage(imgFiles[i]);
-		if (status)
-		{
-			ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
-			imgW = ilGetInteger(IL_IMAGE_WIDTH);
-			imgH = ilGetInteger(IL_IMAGE_HEIGHT);
-			data = ilGetData();
-
-			glBindTexture(GL_TEXTURE_2D, tex[i]);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, imgW, imgH, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		}
+		egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+		assetLoader.requestTexture(imgFiles[i], tex[i]);
 	}
-	ilDeleteImages(textureCount, ilHandle);
 
 
 	// skybox
-	glBindTexture(GL_TEXTURE_2D, tex[skyboxTexHandle]);					// activate 2D texture
+	egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[skyboxTexHandle]);	// activate 2D texture
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);	// texture gets small/large, smooth
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);		// texture repeats on horiz axis
@@ -484,12 +605,12 @@ void setupTextures()
 
 
 	// earth textures
-	glBindTexture(GL_TEXTURE_2D, tex[earthTexHandle_dm]);
+	egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[earthTexHandle_dm]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);		// these two are deliberately different
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glBindTexture(GL_TEXTURE_2D, tex[earthTexHandle_sm]);
+	egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[earthTexHandle_sm]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -497,32 +618,34 @@ void setupTextures()
 
 
 	// moon textures
-	glBindTexture(GL_TEXTURE_2D, tex[moonTexHandle_dm]);
+	egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[moonTexHandle_dm]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	// atlas textures
-	glBindTexture(GL_TEXTURE_2D, tex[atlas_diffuse]);
+	egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[atlas_diffuse]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);	// pixelated for demonstration purposes
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glBindTexture(GL_TEXTURE_2D, tex[atlas_specular]);
+	egpfwStateSelectTexture(0, GL_TEXTURE_2D, tex[atlas_specular]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	// disable textures
-	glBindTexture(GL_TEXTURE_2D, 0);
+	egpfwStateBindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 void deleteTextures()
 {
 	// delete all textures at once
 	glDeleteTextures(textureCount, tex);
+	for (unsigned int i = 0; i < textureCount; ++i)
+		egpfwStateForget(STATE_TEXTURE, tex[i]);
 
 }
 
@@ -535,6 +658,8 @@ const char *commonUniformName[] = {
 	(const char *)("tex_dm"),
 	(const char *)("tex_sm"),
 	(const char *)("pixelSizeInv"),
+	(const char *)("blurKernel"),
+	(const char *)("blurTapCount"),
 	(const char *)("img"),
 	(const char *)("img1"),
 	(const char *)("img2"),
@@ -555,8 +680,25 @@ const char *commonUniformName[] = {
 	(const char*)("curveMode"),
 	(const char*)("useWaypoints"),
 	(const char *)("color"),
+	(const char *)("tableIndex"),
+	(const char *)("lightLists"),
 };
 
+// fragment shaders that read the texture table need to know if it's bindless
+egpShader createTextureTableShader(const char *source)
+{
+	// the define has to go after the version line
+	const char *version = strstr(source, "#version");
+	const char *body = version ? strchr(version, '\n') : 0;
+	if (textureTable.mode != TEXTURE_TABLE_BINDLESS || !body)
+		return egpCreateShaderFromSource(EGP_SHADER_FRAGMENT, source);
+
+	std::string bindlessSource(source, body + 1);
+	bindlessSource += "#define EGP_BINDLESS\n";
+	bindlessSource += body + 1;
+	return egpCreateShaderFromSource(EGP_SHADER_FRAGMENT, bindlessSource.c_str());
+}
+
 // setup and delete shaders
 void setupShaders()
 {
@@ -571,7 +713,7 @@ void setupShaders()
 
 
 	// activate a VAO for validation
-	egpActivateVAO(vao + sphere8x6Model);
+	egpfwActivateVAO(vao + sphere8x6Model);
 
 
 	// test color program
@@ -662,7 +804,7 @@ void setupShaders()
 				}
 				{
 					files[2] = egpLoadFileContents("../../../../resource/glsl/4x/fs_bloom/blur_gaussian_fs4x.glsl");
-					shaders[2] = egpCreateShaderFromSource(EGP_SHADER_FRAGMENT, files[2].contents);
+					shaders[2] = createTextureTableShader(files[2].contents);
 
 					currentProgramIndex = bloomBlurProgramIndex;
 					currentProgram = glslPrograms + currentProgramIndex;
@@ -676,6 +818,38 @@ void setupShaders()
 					egpReleaseShader(shaders + 2);
 					egpReleaseFileContents(files + 2);
 				}
+				{
+					files[2] = egpLoadFileContents("../../../../resource/glsl/4x/fs_bloom/blur_dualDown_fs4x.glsl");
+					shaders[2] = createTextureTableShader(files[2].contents);
+
+					currentProgramIndex = blurDualDownProgramIndex;
+					currentProgram = glslPrograms + currentProgramIndex;
+
+					*currentProgram = egpCreateProgram();
+					egpAttachShaderToProgram(currentProgram, shaders + 0);
+					egpAttachShaderToProgram(currentProgram, shaders + 2);
+					egpLinkProgram(currentProgram);
+					egpValidateProgram(currentProgram);
+
+					egpReleaseShader(shaders + 2);
+					egpReleaseFileContents(files + 2);
+				}
+				{
+					files[2] = egpLoadFileContents("../../../../resource/glsl/4x/fs_bloom/blur_dualUp_fs4x.glsl");
+					shaders[2] = createTextureTableShader(files[2].contents);
+
+					currentProgramIndex = blurDualUpProgramIndex;
+					currentProgram = glslPrograms + currentProgramIndex;
+
+					*currentProgram = egpCreateProgram();
+					egpAttachShaderToProgram(currentProgram, shaders + 0);
+					egpAttachShaderToProgram(currentProgram, shaders + 2);
+					egpLinkProgram(currentProgram);
+					egpValidateProgram(currentProgram);
+
+					egpReleaseShader(shaders + 2);
+					egpReleaseFileContents(files + 2);
+				}
 				{
 					files[2] = egpLoadFileContents("../../../../resource/glsl/4x/fs_bloom/blend_screen_fs4x.glsl");
 					shaders[2] = egpCreateShaderFromSource(EGP_SHADER_FRAGMENT, files[2].contents);
@@ -697,7 +871,7 @@ void setupShaders()
 			{
 				{
 					files[2] = egpLoadFileContents("../../../../resource/glsl/4x/fs_deferred/deferredShading_fs4x.glsl");
-					shaders[2] = egpCreateShaderFromSource(EGP_SHADER_FRAGMENT, files[2].contents);
+					shaders[2] = createTextureTableShader(files[2].contents);
 
 					currentProgramIndex = deferredShadingProgramIndex;
 					currentProgram = glslPrograms + currentProgramIndex;
@@ -874,34 +1048,41 @@ void setupShaders()
 		// get location of every uniform
 		currentProgram = glslPrograms + currentProgramIndex;
 		currentUniformSet = glslCommonUniforms[currentProgramIndex];
-		egpActivateProgram(currentProgram);
+		egpfwActivateProgram(currentProgram);
 		for (u = 0; u < GLSLCommonUniformCount; ++u)
 			currentUniformSet[u] = egpGetUniformLocation(currentProgram, commonUniformName[u]);
 
+		// connect uniform blocks to their buffers' binding points
+		egpfwBindUniformBlock(currentProgram, "FrameUniforms", frameBlockBinding);
+		egpfwBindUniformBlock(currentProgram, "ObjectUniforms", objectBlockBinding);
+		egpfwConnectTextureTable(&textureTable, currentProgram, textureTableBlockBinding);
+
 		// bind constant uniform locations, if they exist, because they never change
 		// e.g. image bindings
-		egpSendUniformInt(currentUniformSet[unif_dm], UNIF_INT, 1, imageLocations);
-		egpSendUniformInt(currentUniformSet[unif_sm], UNIF_INT, 1, imageLocations + 1);
-
-		egpSendUniformInt(currentUniformSet[unif_img], UNIF_INT, 1, imageLocations);
-		egpSendUniformInt(currentUniformSet[unif_img1], UNIF_INT, 1, imageLocations + 1);
-		egpSendUniformInt(currentUniformSet[unif_img2], UNIF_INT, 1, imageLocations + 2);
-		egpSendUniformInt(currentUniformSet[unif_img3], UNIF_INT, 1, imageLocations + 3);
-		egpSendUniformInt(currentUniformSet[unif_img4], UNIF_INT, 1, imageLocations + 4);
-
-		egpSendUniformInt(currentUniformSet[unif_img_light_diffuse], UNIF_INT, 1, imageLocations + 2);
-		egpSendUniformInt(currentUniformSet[unif_img_light_specular], UNIF_INT, 1, imageLocations + 3);
-
-		egpSendUniformInt(currentUniformSet[unif_img_position], UNIF_INT, 1, imageLocations + 4);
-		egpSendUniformInt(currentUniformSet[unif_img_normal], UNIF_INT, 1, imageLocations + 5);
-		egpSendUniformInt(currentUniformSet[unif_img_texcoord], UNIF_INT, 1, imageLocations + 6);
-		egpSendUniformInt(currentUniformSet[unif_img_depth], UNIF_INT, 1, imageLocations + 7);
+		egpfwSendUniformInt(currentUniformSet[unif_dm], UNIF_INT, 1, imageLocations);
+		egpfwSendUniformInt(currentUniformSet[unif_sm], UNIF_INT, 1, imageLocations + 1);
+
+		egpfwSendUniformInt(currentUniformSet[unif_img], UNIF_INT, 1, imageLocations);
+		egpfwSendUniformInt(currentUniformSet[unif_img1], UNIF_INT, 1, imageLocations + 1);
+		egpfwSendUniformInt(currentUniformSet[unif_img2], UNIF_INT, 1, imageLocations + 2);
+		egpfwSendUniformInt(currentUniformSet[unif_img3], UNIF_INT, 1, imageLocations + 3);
+		egpfwSendUniformInt(currentUniformSet[unif_img4], UNIF_INT, 1, imageLocations + 4);
+
+		egpfwSendUniformInt(currentUniformSet[unif_img_light_diffuse], UNIF_INT, 1, imageLocations + 2);
+		egpfwSendUniformInt(currentUniformSet[unif_img_light_specular], UNIF_INT, 1, imageLocations + 3);
+
+		egpfwSendUniformInt(currentUniformSet[unif_img_position], UNIF_INT, 1, imageLocations + 4);
+		egpfwSendUniformInt(currentUniformSet[unif_img_normal], UNIF_INT, 1, imageLocations + 5);
+		egpfwSendUniformInt(currentUniformSet[unif_img_texcoord], UNIF_INT, 1, imageLocations + 6);
+		egpfwSendUniformInt(currentUniformSet[unif_img_depth], UNIF_INT, 1, imageLocations + 7);
+
+		egpfwSendUniformInt(currentUniformSet[unif_lightLists], UNIF_INT, 1, imageLocations + 2);
 	}
 
 
 	// disable all
-	egpActivateProgram(0);
-	egpActivateVAO(0);
+	egpfwActivateProgram(0);
+	egpfwActivateVAO(0);
 }
 
 void deleteShaders()
@@ -909,90 +1090,246 @@ void deleteShaders()
 	// convenient way to release all programs
 	unsigned int i;
 	for (i = 0; i < GLSLProgramCount; ++i)
+	{
+		// new programs may get the same names, so their uniforms must not look set already
+		egpfwStateForget(STATE_PROGRAM, glslPrograms[i].glhandle);
 		egpReleaseProgram(glslPrograms + i);
+	}
 }
 
 
-// setup and delete framebuffers
-void setupFramebuffers(unsigned int frameWidth, unsigned int frameHeight)
+// setup and delete uniform buffers
+void setupUniformBuffers()
 {
-	// prepare framebuffers in one simple call
+	// object ranges are bound separately, so each starts on an aligned offset
+	if (objectUniformStride % egpfwGetUBOOffsetAlignment())
+		printf("\n Object uniform stride is not a multiple of the UBO offset alignment!");
+	objectUniformData.assign(objectUniformCount * objectUniformStride, 0);
 
-	{ //BLOOM
-		const unsigned int frameWidth_d2 = frameWidth / 2;
-		const unsigned int frameWidth_d4 = frameWidth / 4;
-		const unsigned int frameWidth_d8 = frameWidth / 8;
-		const unsigned int frameHeight_d2 = frameHeight / 2;
-		const unsigned int frameHeight_d4 = frameHeight / 4;
-		const unsigned int frameHeight_d8 = frameHeight / 8;
-		unsigned int i;
+	frameUBO = egpfwCreateUBO(sizeof(FrameUniformBlock), 0);
+	objectUBO = egpfwCreateUBO((unsigned int)objectUniformData.size(), 0);
+}
+
+void deleteUniformBuffers()
+{
+	egpfwReleaseUBO(&frameUBO);
+	egpfwReleaseUBO(&objectUBO);
+}
+
+
+// setup and delete lights
+void setupLights()
+{
+	unsigned int i;
+	float hue;
+
+	// same lights every run
+	srand(1);
+	for (i = numLightsPlaced; i < numLights; ++i)
+	{
+		lightOrbit[i].set(
+			1.0f + 9.0f * (float)rand() / (float)RAND_MAX,
+			6.2832f * (float)rand() / (float)RAND_MAX,
+			(0.02f + 0.08f * (float)rand() / (float)RAND_MAX) * earthDaytimePeriod * (i % 2 ? 1.0f : -1.0f),
+			-4.8f + 1.5f * (float)rand() / (float)RAND_MAX);
+		lightPos_world[i].set(cosf(lightOrbit[i].y) * lightOrbit[i].x, lightOrbit[i].w, -sinf(lightOrbit[i].y) * lightOrbit[i].x, 1.0f);
+
+		hue = 6.2832f * (float)rand() / (float)RAND_MAX;
+		lightColor[i].set(0.5f + 0.5f * cosf(hue), 0.5f + 0.5f * cosf(hue - 2.0944f), 0.5f + 0.5f * cosf(hue + 2.0944f),
+			0.75f + 0.75f * (float)rand() / (float)RAND_MAX);
+	}
 
+	// buffers are created once, so passes can bind them by name
+	lightClusters.create();
+}
+
+void deleteLights()
+{
+	lightClusters.release();
+}
+
+// range of one object's data in the object buffer
+RenderPassUniformBlockData objectUniformRange(ObjectUniformIndex i)
+{
+	return RenderPassUniformBlockData(objectBlockBinding, &objectUBO, i * objectUniformStride, sizeof(ObjectUniformBlock));
+}
+
+// every object's data, for programs that index it by draw
+RenderPassUniformBlockData objectUniformArray()
+{
+	return RenderPassUniformBlockData(objectBlockBinding, &objectUBO, 0, objectUniformCount * objectUniformStride);
+}
+
+
+// setup and delete the texture table
+void setupTextureTable()
+{
+	unsigned int i;
+	for (i = 0; i < textureTableSlotCount; ++i)
+	{
+		textureTableIndex[i][0] = i;
+		textureTableIndex[i][1] = textureTableIndex[i][2] = textureTableIndex[i][3] = 0;
+	}
+
+	// shaders are built for whichever mode this ends up in
+	textureTable = egpfwCreateTextureTable(textureTableMode, textureTableFirstUnit);
+	printf("\n texture table: %s\n", textureTable.mode == TEXTURE_TABLE_BINDLESS ? "bindless" : "texture units");
+	if (textureTable.freeUnits < textureTableOwnSamplers)
+		printf("\n texture table leaves shaders %u samplers, deferred shading needs %u; it won't link!\n", textureTable.freeUnits, textureTableOwnSamplers);
+}
+
+void deleteTextureTable()
+{
+	egpfwReleaseTextureTable(&textureTable);
+}
+
+// point the table at the targets the current graph created
+// (ones it didn't create have no texture, so their slots stay empty)
+void updateTextureTable()
+{
+	const FBOIndex slotFBO[] = {
+		sceneFBO, brightFBO_d2,
+		hblurFBO_d2, vblurFBO_d2, hblurFBO_d4, vblurFBO_d4, hblurFBO_d8, vblurFBO_d8,
+	};
+	unsigned int i;
+
+	for (i = table_scene; i <= table_vblurD8; ++i)
+		egpfwTextureTableSet(&textureTable, i, fbo[slotFBO[i]].colorTargetHandle[0]);
+	egpfwTextureTableSet(&textureTable, table_gbufferDepth, fbo[gbufferSceneFBO].depthTargetHandle[0]);
+	egpfwTextureTableSet(&textureTable, table_gbufferNormal, fbo[gbufferSceneFBO].colorTargetHandle[0]);
+	egpfwTextureTableSet(&textureTable, table_gbufferSurface, fbo[gbufferSceneFBO].colorTargetHandle[1]);
+}
+
+
+// setup and delete framebuffers
+// the frame graph creates the render path targets when a render method 
+//	that uses them is activated, so only describe them here
+void declareFramebuffers()
+{
+	{ //BLOOM
 		// one for the scene
-		fbo[sceneFBO] = egpfwCreateFBO(frameWidth, frameHeight, 1, COLOR_RGBA16, DEPTH_D32, SMOOTH_NOWRAP);
+		frameGraph.declareTarget(sceneFBO, FrameGraphTargetDesc(1, 1, COLOR_RGBA16, DEPTH_D32, SMOOTH_NOWRAP));
 
 		// bright pass
-		fbo[brightFBO_d2] = egpfwCreateFBO(frameWidth_d2, frameHeight_d2, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
+		frameGraph.declareTarget(brightFBO_d2, FrameGraphTargetDesc(2, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
 
 		// blur passes
-		fbo[hblurFBO_d2] = egpfwCreateFBO(frameWidth_d2, frameHeight_d2, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
-		fbo[vblurFBO_d2] = egpfwCreateFBO(frameWidth_d2, frameHeight_d2, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
-		fbo[hblurFBO_d4] = egpfwCreateFBO(frameWidth_d4, frameHeight_d4, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
-		fbo[vblurFBO_d4] = egpfwCreateFBO(frameWidth_d4, frameHeight_d4, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
-		fbo[hblurFBO_d8] = egpfwCreateFBO(frameWidth_d8, frameHeight_d8, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
-		fbo[vblurFBO_d8] = egpfwCreateFBO(frameWidth_d8, frameHeight_d8, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
+		frameGraph.declareTarget(hblurFBO_d2, FrameGraphTargetDesc(2, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
+		frameGraph.declareTarget(vblurFBO_d2, FrameGraphTargetDesc(2, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
+		frameGraph.declareTarget(hblurFBO_d4, FrameGraphTargetDesc(4, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
+		frameGraph.declareTarget(vblurFBO_d4, FrameGraphTargetDesc(4, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
+		frameGraph.declareTarget(hblurFBO_d8, FrameGraphTargetDesc(8, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
+		frameGraph.declareTarget(vblurFBO_d8, FrameGraphTargetDesc(8, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
 
 		// composite pass
-		fbo[compositeFBO] = egpfwCreateFBO(frameWidth, frameHeight, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP);
-
-
-		// get inverted frame sizes
-		// this represents the size of one pixel within SCREEN SPACE
-		// since screen space is within [0, 1], one pixel = 1/size
-		for (i = 0; i < fboCount; ++i)
-			pixelSizeInv[i].set(
-				1.0f / (float)(fbo + i)->frameWidth,
-				1.0f / (float)(fbo + i)->frameHeight
-			);
+		frameGraph.declareTarget(compositeFBO, FrameGraphTargetDesc(1, 1, COLOR_RGBA16, DEPTH_DISABLE, SMOOTH_NOWRAP));
 	}
 
 	{ //DEFERRED
 		const egpColorFormat colorFormat = COLOR_RGBA32F;
 
-		// one for the scene geometry (MRT, one for each attrib)
-		fbo[gbufferSceneFBO] = egpfwCreateFBO(frameWidth, frameHeight, 3, colorFormat, DEPTH_D32, SMOOTH_NOWRAP);
+		// one for the scene geometry, packed: position comes back from depth, 
+		//	normals are octahedral in two channels and the surface target 
+		//	holds the atlas texcoord and material id (16 bytes a pixel, was 52)
+		frameGraph.declareTarget(gbufferSceneFBO, FrameGraphTargetDesc(1, { COLOR_RG16, COLOR_RGBA16 }, DEPTH_D32, SMOOTH_NOWRAP));
 
 		// deferred shading
-		fbo[deferredShadingFBO] = egpfwCreateFBO(frameWidth, frameHeight, 1, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP);
+		frameGraph.declareTarget(deferredShadingFBO, FrameGraphTargetDesc(1, 1, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP));
 
 		// light pre-pass (MRT, one for diffuse, one for specular lighting)
-		fbo[lightPassFBO] = egpfwCreateFBO(frameWidth, frameHeight, 2, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP);
+		frameGraph.declareTarget(lightPassFBO, FrameGraphTargetDesc(1, 2, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP));
 
 		// deferred lighting composite pass
-		fbo[deferredLightingCompositeFBO] = egpfwCreateFBO(frameWidth, frameHeight, 1, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP); 
+		frameGraph.declareTarget(deferredLightingCompositeFBO, FrameGraphTargetDesc(1, 1, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP));
 	}
 
 	{ //Depth of Field
 		const egpColorFormat colorFormat = COLOR_RGBA32F;
 
-		fbo[depthOfFieldOutputFBO] = egpfwCreateFBO(frameWidth, frameHeight, 2, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP);
+		frameGraph.declareTarget(depthOfFieldOutputFBO, FrameGraphTargetDesc(1, 2, colorFormat, DEPTH_DISABLE, SMOOTH_NOWRAP));
+	}
+
+	// the skybox draws into these before the render path runs
+	frameGraph.importTarget(sceneFBO);
+	frameGraph.importTarget(gbufferSceneFBO);
+
+	// targets of render methods that aren't showing are kept up to this much
+	frameGraph.setPoolBudget(renderTargetPoolBudget);
+
+	// targets are made big enough for a full screen window, so resizing 
+	//	only changes how much of them gets drawn
+	frameGraph.setMaxFrameSize(glutGet(GLUT_SCREEN_WIDTH) + viewport_tb, glutGet(GLUT_SCREEN_HEIGHT) + viewport_tb);
+}
+
+void activateFrameGraph();
+
+// the render path draws at the dynamic resolution's fraction of the frame
+// returns 1 if the targets were released and need activating again
+int setRenderFrameSize(unsigned int frameWidth, unsigned int frameHeight)
+{
+	const float scale = dynamicResolution.getScale();
+	const unsigned int renderWidth = (unsigned int)((float)frameWidth * scale + 0.5f);
+	const unsigned int renderHeight = (unsigned int)((float)frameHeight * scale + 0.5f);
+
+	// growing past the targets' size releases them, and bindless handles 
+	//	keep textures alive, so let go of them first
+	if (!frameGraph.fitsFrameSize(renderWidth, renderHeight))
+	{
+		egpfwTextureTableClear(&textureTable);
+		frameGraph.setFrameSize(renderWidth, renderHeight);
+		return 1;
 	}
+	frameGraph.setFrameSize(renderWidth, renderHeight);
+	return 0;
+}
+
+void setupFramebuffers(unsigned int frameWidth, unsigned int frameHeight)
+{
+	unsigned int i;
+	setRenderFrameSize(frameWidth, frameHeight);
+
+	// get inverted texture sizes
+	// this represents the size of one pixel within TEXTURE SPACE
+	// since texture space is within [0, 1], one pixel = 1/size
+	// (sizes come from the descriptions, the FBO may not exist)
+	for (i = 0; i < fboCount; ++i)
+		if (frameGraph.getTargetTextureWidth((FBOIndex)i))
+			pixelSizeInv[i].set(
+				1.0f / (float)frameGraph.getTargetTextureWidth((FBOIndex)i),
+				1.0f / (float)frameGraph.getTargetTextureHeight((FBOIndex)i)
+			);
 
 	{ //Curves
-		const egpColorFormat colorFormat = COLOR_RGBA32F;
+		// drawn by the keyframe window every frame, so not part of the graph
 		fbo[curvesFBO] = egpfwCreateFBO(frameWidth, frameHeight, 1, COLOR_RGB16, DEPTH_DISABLE, SMOOTH_NOWRAP);
 	}
 
 	{ //Speed Control
-		const egpColorFormat colorFormat = COLOR_RGBA32F;
 		fbo[speedControlFBO] = egpfwCreateFBO(frameWidth, frameHeight, 1, COLOR_RGB16, DEPTH_DISABLE, SMOOTH_NOWRAP);
 	}
+
+	// recreate what the showing render method needs
+	activateFrameGraph();
+}
+
+// render path targets keep their storage across resizes, only the 
+//	window-sized ones outside the graph are made again
+void resizeFramebuffers(unsigned int frameWidth, unsigned int frameHeight)
+{
+	egpfwReleaseFBO(fbo + curvesFBO);
+	egpfwReleaseFBO(fbo + speedControlFBO);
+	setupFramebuffers(frameWidth, frameHeight);
 }
 
 void deleteFramebuffers()
 {
-	// how convenient
-	for (unsigned int i = 0; i < fboCount; ++i)
-		egpfwReleaseFBO(fbo + i);
+	// bindless handles keep textures alive, so let go of them first
+	egpfwTextureTableClear(&textureTable);
+
+	// graph targets first, they may share FBOs
+	frameGraph.release();
+	egpfwReleaseFBO(fbo + curvesFBO);
+	egpfwReleaseFBO(fbo + speedControlFBO);
 }
 
 // setup the different render paths
@@ -1013,33 +1350,21 @@ void setupScenePathBloom()
 	earthPass.setVAO(vao + sphereHiResObjModel);
 	earthPass.addTexture(RenderPassTextureData(GL_TEXTURE_2D, GL_TEXTURE1, tex[earthTexHandle_sm]));
 	earthPass.addTexture(RenderPassTextureData(GL_TEXTURE_2D, GL_TEXTURE0, tex[earthTexHandle_dm]));
-	earthPass.addUniform(render_pass_uniform_float(glslCommonUniforms[phongProgramIndex][unif_eyePos], UNIF_VEC4, 1, eyePos_object.v));
-	earthPass.addUniform(render_pass_uniform_float(glslCommonUniforms[phongProgramIndex][unif_lightPos], UNIF_VEC4, 1, lightPos_object.v));
-	earthPass.addUniform(render_pass_uniform_float_matrix(glslCommonUniforms[phongProgramIndex][unif_mvp], 1, 0, &earthModelViewProjectionMatrix));
+	earthPass.addUniformBlock(objectUniformRange(earthObject));
+
+	//Label them for the timing display.
+	moonPass.setName("moon");
+	earthPass.setName("earth");
 
-	//Add them to the global render path.
-	globalRenderPath.addRenderPass(moonPass);
-	globalRenderPath.addRenderPass(earthPass);
+	//Add them to the frame graph.
+	frameGraph.addPass(std::move(moonPass));
+	frameGraph.addPass(std::move(earthPass));
 }
 
 void setupEffectPathBloom()
 {
-	//Create passes for all the individual steps for bloom.
-	RenderPass brightPass(fbo, glslPrograms),
-		hblur1(fbo, glslPrograms), vblur1(fbo, glslPrograms),
-		hblur2(fbo, glslPrograms), vblur2(fbo, glslPrograms),
-		hblur3(fbo, glslPrograms), vblur3(fbo, glslPrograms), 
-		composite(fbo, glslPrograms);
-
-	//If you look at it too long, this all blurs together (ba dum tss) but basically it
-	//just sets up the different steps for bloom. Nothing here is different
-	//than from how it was when it was in the renderScene function.
-
-	//NOTE: The blurs use render_pass_uniform_float_complex because they are referencing variables
-	//that don't actually exist; they need a VEC2 with one component in an actual stored vector, and 
-	//the other component set to 0. We give it a "source" of sorts that the RenderPass will use
-	//later on to create an actual VEC2 to be passed as a uniform.
-	//	...a simpler solution would've been to just make pixelSizeInvHorizontal and pixelSizeInvVertical variables...
+	//Create passes for the bright pass and the composite; the blur chain makes the ones in between.
+	RenderPass brightPass(fbo, glslPrograms), composite(fbo, glslPrograms);
 
 	//Bright pass
 	brightPass.setProgram(bloomBrightProgramIndex);
@@ -1047,54 +1372,24 @@ void setupEffectPathBloom()
 	brightPass.setPipelineStage(brightFBO_d2);
 	brightPass.addColorTarget(FBOTargetColorTexture(sceneFBO, 0, 0));
 
-	currentUniformSet = glslCommonUniforms[bloomBlurProgramIndex];
-
-	//First horizontal blur
-	hblur1.setProgram(bloomBlurProgramIndex);
-	hblur1.setPipelineStage(hblurFBO_d2);
-	hblur1.addColorTarget(FBOTargetColorTexture(brightFBO_d2, 0, 0));
-	hblur1.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &pixelSizeInv[brightFBO_d2].x, &CONST_ZERO_FLOAT }));
-
-	//First vertical blur
-	vblur1.setProgram(bloomBlurProgramIndex);
-	vblur1.setPipelineStage(vblurFBO_d2);
-	vblur1.addColorTarget(FBOTargetColorTexture(hblurFBO_d2, 0, 0));
-	vblur1.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &CONST_ZERO_FLOAT, &pixelSizeInv[hblurFBO_d2].y }));
-
-	//Second horizontal blur
-	hblur2.setProgram(bloomBlurProgramIndex);
-	hblur2.setPipelineStage(hblurFBO_d4);
-	hblur2.addColorTarget(FBOTargetColorTexture(vblurFBO_d2, 0, 0));
-	hblur2.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &pixelSizeInv[vblurFBO_d2].x, &CONST_ZERO_FLOAT }));
-
-	//Second vertical blur
-	vblur2.setProgram(bloomBlurProgramIndex);
-	vblur2.setPipelineStage(vblurFBO_d4);
-	vblur2.addColorTarget(FBOTargetColorTexture(hblurFBO_d4, 0, 0));
-	vblur2.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &CONST_ZERO_FLOAT, &pixelSizeInv[hblurFBO_d4].y }));
-
-	//Third horizontal blur
-	hblur3.setProgram(bloomBlurProgramIndex);
-	hblur3.setPipelineStage(hblurFBO_d8);
-	hblur3.addColorTarget(FBOTargetColorTexture(vblurFBO_d4, 0, 0));
-	hblur3.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &pixelSizeInv[vblurFBO_d4].x, &CONST_ZERO_FLOAT }));
-
-	//Third vertical blur
-	vblur3.setProgram(bloomBlurProgramIndex);
-	vblur3.setPipelineStage(vblurFBO_d8);
-	vblur3.addColorTarget(FBOTargetColorTexture(hblurFBO_d8, 0, 0));
-	vblur3.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &CONST_ZERO_FLOAT, &pixelSizeInv[hblurFBO_d8].y }));
-
 	//Finally, composite them all together with the last pass.
 	composite.setProgram(bloomBlendProgramIndex);
+	composite.setVAO(vao + fsqModel);
 	composite.setPipelineStage(compositeFBO);
 	composite.addColorTarget(FBOTargetColorTexture(sceneFBO, 0, 0));
 	composite.addColorTarget(FBOTargetColorTexture(vblurFBO_d2, 1, 0));
 	composite.addColorTarget(FBOTargetColorTexture(vblurFBO_d4, 2, 0));
 	composite.addColorTarget(FBOTargetColorTexture(vblurFBO_d8, 3, 0));
 	
-	//Add them all to the render path.
-	globalRenderPath.addRenderPasses({ brightPass, hblur1, vblur1, hblur2, vblur2, hblur3, vblur3, composite });
+	//Label them for the timing display.
+	brightPass.setName("bloom bright");
+	composite.setName("bloom composite");
+
+	//Add them all to the frame graph. Bloom only needs the glow to be wide and smooth, so it takes the dual filter:
+	//two cheap passes a level instead of two Gaussians. The blurs read their input through the texture table.
+	frameGraph.addPass(std::move(brightPass));
+	blurChain.addPasses(frameGraph, BLUR_DUAL_FILTER, BlurTarget(brightFBO_d2, textureTableIndex[table_brightD2], pixelSizeInv + brightFBO_d2), blurLevels, 3, "bloom");
+	frameGraph.addPass(std::move(composite));
 }
 
 void setupNetgraphPathBloom()
@@ -1114,40 +1409,19 @@ void setupNetgraphPathBloom()
 
 void setupScenePathDeferred()
 {
-	//Create passes to render the individual objects in the scene.
-	currentUniformSet = glslCommonUniforms[gbufferProgramIndex];
-	RenderPass earthPass(fbo, glslPrograms), moonPass(fbo, glslPrograms), marsPass(fbo, glslPrograms), groundPass(fbo, glslPrograms);
+	//One pass draws every object in the scene through the queue (see updateSceneQueue). The objects are all in the
+	//scene pool, so the queue sends them as one multi-draw. The view-projection matrix comes from the frame block,
+	//everything else from the object array, indexed by draw.
+	RenderPass scenePass(fbo, glslPrograms);
 
-	earthPass.setProgram(gbufferProgramIndex);
-	earthPass.setPipelineStage(gbufferSceneFBO);
-	earthPass.setVAO(vao + sphereHiResObjModel);
-	earthPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_viewprojMat], 1, 0, &viewProjMat));
-	earthPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_modelMat], 1, 0, &earthModelMatrix));
-	earthPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_atlasMat], 1, 0, &earthAtlasMatrix));
-
-	moonPass.setProgram(gbufferProgramIndex);
-	moonPass.setPipelineStage(gbufferSceneFBO);
-	moonPass.setVAO(vao + sphereLowResObjModel);
-	moonPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_viewprojMat], 1, 0, &viewProjMat));
-	moonPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_modelMat], 1, 0, &moonModelMatrix));
-	moonPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_atlasMat], 1, 0, &moonAtlasMatrix));
-
-	marsPass.setProgram(gbufferProgramIndex);
-	marsPass.setPipelineStage(gbufferSceneFBO);
-	marsPass.setVAO(vao + sphereLowResObjModel);
-	marsPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_viewprojMat], 1, 0, &viewProjMat));
-	marsPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_modelMat], 1, 0, &marsModelMatrix));
-	marsPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_atlasMat], 1, 0, &marsAtlasMatrix));
-
-	groundPass.setProgram(gbufferProgramIndex);
-	groundPass.setPipelineStage(gbufferSceneFBO);
-	groundPass.setVAO(vao + fsqModel);
-	groundPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_viewprojMat], 1, 0, &viewProjMat));
-	groundPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_modelMat], 1, 0, &groundModelMatrix));
-	groundPass.addUniform(render_pass_uniform_float_matrix(currentUniformSet[unif_atlasMat], 1, 0, &groundAtlasMatrix));
-
-	//Add them to the actual render path.
-	globalRenderPath.addRenderPasses({ earthPass, moonPass, marsPass, groundPass });
+	scenePass.setPipelineStage(gbufferSceneFBO);
+	scenePass.setQueue(&sceneQueue);
+
+	//Label it for the timing display.
+	scenePass.setName("gbuffer scene");
+
+	//Add it to the frame graph.
+	frameGraph.addPass(std::move(scenePass));
 }
 
 void setupEffectPathDeferred()
@@ -1162,20 +1436,20 @@ void setupEffectPathDeferred()
 	currentUniformSet = glslCommonUniforms[deferredShadingProgramIndex];
 
 	//Add all the uniforms and textures
-	deferredPass.addDepthTarget(FBOTargetDepthTexture(gbufferSceneFBO, 7));
-	deferredPass.addColorTarget(FBOTargetColorTexture(gbufferSceneFBO, 6, 2));
-	deferredPass.addColorTarget(FBOTargetColorTexture(gbufferSceneFBO, 5, 1));
-	deferredPass.addColorTarget(FBOTargetColorTexture(gbufferSceneFBO, 4, 0));
+	//The gbuffer is read through the texture table; the atlases load in the background, so they're still bound normally.
+	deferredPass.addTableRead(gbufferSceneFBO);
+	deferredPass.addUniform(render_pass_uniform_int(currentUniformSet[unif_tableIndex], UNIF_IVEC4, 1, gbufferTableIndex));
 
 	deferredPass.addTexture(RenderPassTextureData(GL_TEXTURE_2D, GL_TEXTURE1, tex[atlas_specular]));
 	deferredPass.addTexture(RenderPassTextureData(GL_TEXTURE_2D, GL_TEXTURE0, tex[atlas_diffuse]));
-	deferredPass.addUniform(render_pass_uniform_float(currentUniformSet[unif_eyePos], UNIF_VEC4, 1, cameraPosWorld.v));
+	//Eye and cluster grid are in the frame block, which stays bound all frame. The light lists are rebuilt every frame
+	//into the same buffer, so its texture is bound like any other.
+	deferredPass.addTexture(RenderPassTextureData(GL_TEXTURE_BUFFER, GL_TEXTURE2, lightClusters.getListTexture()));
 
-	deferredPass.addUniform(render_pass_uniform_float(currentUniformSet[unif_lightColor], UNIF_VEC4, numLightsShading, lightColor->v));
-	deferredPass.addUniform(render_pass_uniform_float(currentUniformSet[unif_lightPos], UNIF_VEC4, numLightsShading, lightPos_world->v));
+	deferredPass.setName("deferred shading");
 
-	//Add it to the actual render path.
-	globalRenderPath.addRenderPass(deferredPass);
+	//Add it to the frame graph.
+	frameGraph.addPass(std::move(deferredPass));
 }
 
 void setupNetgraphPathDeferred()
@@ -1186,57 +1460,19 @@ void setupNetgraphPathDeferred()
 	globalRenderNetgraph.addFBOs({
 		FBOTargetColorTexture(gbufferSceneFBO, 0, 0),
 		FBOTargetColorTexture(gbufferSceneFBO, 0, 1),
-		FBOTargetColorTexture(gbufferSceneFBO, 0, 2),
 		FBOTargetColorTexture(deferredShadingFBO, 0, 0),
 	});
 }
 
 void setupEffectPathDOF()
 {
-	RenderPass
-		hblur1(fbo, glslPrograms), vblur1(fbo, glslPrograms),
-		hblur2(fbo, glslPrograms), vblur2(fbo, glslPrograms),
-		hblur3(fbo, glslPrograms), vblur3(fbo, glslPrograms),
-		dofComposite(fbo, glslPrograms);
-
-	currentUniformSet = glslCommonUniforms[bloomBlurProgramIndex];
-
-	//First horizontal blur
-	hblur1.setProgram(bloomBlurProgramIndex);
-	hblur1.setVAO(vao + fsqModel);
-	hblur1.setPipelineStage(hblurFBO_d2);
-	hblur1.addColorTarget(FBOTargetColorTexture(sceneFBO, 0, 0));
-	hblur1.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &pixelSizeInv[brightFBO_d2].x, &CONST_ZERO_FLOAT }));
-
-	//First vertical blur
-	vblur1.setPipelineStage(vblurFBO_d2);
-	vblur1.addColorTarget(FBOTargetColorTexture(hblurFBO_d2, 0, 0));
-	vblur1.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &CONST_ZERO_FLOAT, &pixelSizeInv[hblurFBO_d2].y }));
-
-	//Second horizontal blur
-	hblur2.setPipelineStage(hblurFBO_d4);
-	hblur2.addColorTarget(FBOTargetColorTexture(vblurFBO_d2, 0, 0));
-	hblur2.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &pixelSizeInv[vblurFBO_d2].x, &CONST_ZERO_FLOAT }));
-
-	//Second vertical blur
-	vblur2.setPipelineStage(vblurFBO_d4);
-	vblur2.addColorTarget(FBOTargetColorTexture(hblurFBO_d4, 0, 0));
-	vblur2.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &CONST_ZERO_FLOAT, &pixelSizeInv[hblurFBO_d4].y }));
-
-	//Third horizontal blur
-	hblur3.setPipelineStage(hblurFBO_d8);
-	hblur3.addColorTarget(FBOTargetColorTexture(vblurFBO_d4, 0, 0));
-	hblur3.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &pixelSizeInv[vblurFBO_d4].x, &CONST_ZERO_FLOAT }));
-
-	//Third vertical blur
-	vblur3.setPipelineStage(vblurFBO_d8);
-	vblur3.addColorTarget(FBOTargetColorTexture(hblurFBO_d8, 0, 0));
-	vblur3.addUniform(render_pass_uniform_float_complex(currentUniformSet[unif_pixelSizeInv], UNIF_VEC2, 1, { &CONST_ZERO_FLOAT, &pixelSizeInv[hblurFBO_d8].y }));
+	RenderPass dofComposite(fbo, glslPrograms);
 
 	currentUniformSet = glslCommonUniforms[depthOfFieldCompositeProgramIndex];
 
 	dofComposite.setPipelineStage(depthOfFieldOutputFBO);
 	dofComposite.setProgram(depthOfFieldCompositeProgramIndex);
+	dofComposite.setVAO(vao + fsqModel);
 
 	dofComposite.addDepthTarget(FBOTargetDepthTexture(sceneFBO, 0));
 	dofComposite.addColorTarget(FBOTargetColorTexture(sceneFBO, 1, 0));
@@ -1244,7 +1480,12 @@ void setupEffectPathDOF()
 	dofComposite.addColorTarget(FBOTargetColorTexture(vblurFBO_d4, 3, 0));
 	dofComposite.addColorTarget(FBOTargetColorTexture(vblurFBO_d8, 4, 0));
 
-	globalRenderPath.addRenderPasses({ hblur1, vblur1, hblur2, vblur2, hblur3, vblur3, dofComposite });
+	//Label it for the timing display.
+	dofComposite.setName("dof composite");
+
+	//The composite blends between the levels by depth, so each has to be a clean step blurrier than the last: Gaussian.
+	blurChain.addPasses(frameGraph, BLUR_SEPARABLE, BlurTarget(sceneFBO, textureTableIndex[table_scene], pixelSizeInv + sceneFBO), blurLevels, 3, "dof");
+	frameGraph.addPass(std::move(dofComposite));
 }
 
 void setupNetgraphPathDOF()
@@ -1260,27 +1501,20 @@ void setupNetgraphPathDOF()
 	});
 }
 
-void setupRenderPaths()
+// netgraph thumbnails and the displayed image for a render method
+void setupNetgraph(RenderMethod method)
 {
-	globalRenderPath.clearAllPasses();
-
-	switch (currentRenderMode)
+	switch (method)
 	{
 		case bloomRenderMethod:
-			setupScenePathBloom();
-			setupEffectPathBloom();
 			setupNetgraphPathBloom();
 			displayMode = deferredShadingFBO;
 			break;
 		case deferredRenderMethod:
-			setupScenePathDeferred();
-			setupEffectPathDeferred();
 			setupNetgraphPathDeferred();
 			displayMode = compositeFBO;
 			break;
 		case depthOfFieldRenderMethod:
-			setupScenePathBloom();
-			setupEffectPathDOF();
 			setupNetgraphPathDOF();
 			displayMode = compositeFBO;
 			break;
@@ -1288,7 +1522,82 @@ void setupRenderPaths()
 		default: 
 			break;
 	}
+}
+
+// build a render method's path from the frame graph: keeps the passes that 
+//	lead to what is displayed and works out the targets they touch
+void compileRenderMethod(RenderMethod method)
+{
+	// the final display reads one netgraph entry after the path runs
+	// (the netgraph itself isn't drawn; if it comes back, export its targets too)
+	setupNetgraph(method);
+	const FBOTargetColorTexture displayed = globalRenderNetgraph.getFBOAtIndex(displayMode);
+
+	frameGraph.clearExports();
+	frameGraph.exportTarget((FBOIndex)displayed.fboIndex);
+	frameGraph.compile(renderMethodGraph[method]);
+}
+
+// point the FBO slots and texture table at the showing render method's 
+//	targets, creating any that were never made or have been evicted
+void activateFrameGraph()
+{
+	// targets may be released, so empty the table until it's refilled
+	egpfwTextureTableClear(&textureTable);
+	frameGraph.activate(renderMethodGraph[currentRenderMode]);
+	updateTextureTable();
+}
+
+// switch to a compiled render method; nothing is rebuilt
+void activateRenderMethod(RenderMethod method)
+{
+	activeRenderPath().setProfiling(false);
+
+	currentRenderMode = method;
+	setupNetgraph(method);
+	activateFrameGraph();
+
+	// timings follow the path that's showing
+	activeRenderPath().setProfiling(profilePasses);
+	globalRenderNetgraph.showTimings(profilePasses ? &activeRenderPath() : nullptr, glslCommonUniforms[testSolidColorProgramIndex], 1000.0f / 60.0f);
+}
+
+// build and compile every render method up front
+void setupRenderPaths()
+{
+	int method;
+	blurChain.setPrograms(bloomBlurProgramIndex, blurDualDownProgramIndex, blurDualUpProgramIndex);
+
+	for (method = 0; method < numRenderMethods; ++method)
+	{
+		frameGraph.clearPasses();
+
+		switch ((RenderMethod)method)
+		{
+			case bloomRenderMethod:
+				setupScenePathBloom();
+				setupEffectPathBloom();
+				break;
+			case deferredRenderMethod:
+				setupScenePathDeferred();
+				setupEffectPathDeferred();
+				break;
+			case depthOfFieldRenderMethod:
+				setupScenePathBloom();
+				setupEffectPathDOF();
+				break;
+			case numRenderMethods:
+			default: 
+				break;
+		}
+
+		compileRenderMethod((RenderMethod)method);
+	}
+
+	// compiled paths have their own copies
+	frameGraph.clearPasses();
 
+	activateRenderMethod(currentRenderMode);
 }
 
 
@@ -1314,11 +1623,11 @@ void drawToBackBuffer(int x, int y, unsigned int w, unsigned int h)
 
 	// reset buffer tests
 	// assume only FBOs are using depth
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_STENCIL_TEST);
+	egpfwStateSetCapability(GL_DEPTH_TEST, 0);
+	egpfwStateSetCapability(GL_STENCIL_TEST, 0);
 
 	// reset viewport with borders clipped
-	glViewport(x, y, w, h);
+	egpfwStateViewport(x, y, w, h);
 }
 
 
@@ -1373,15 +1682,37 @@ int initGame()
 	// don't bother with this here actually... see window resize callback
 	//	setupFramebuffers();
 
+	// start loading threads before anything asks them for work
+	assetLoader.start();
+	jobSystem.start();
+	for (int i = 0; i < numRenderMethods; ++i)
+		renderMethodGraph[i].path.setJobSystem(&jobSystem);
+	lightClusters.setJobSystem(&jobSystem);
+	sceneQueue.setJobSystem(&jobSystem);
+
 	// setup geometry
 	setupGeometry();
 
 	// setup textures
 	setupTextures();
 
+	// setup texture table (shaders are compiled for its mode)
+	setupTextureTable();
+
 	// setup shaders
 	setupShaders();
 
+	// setup uniform buffers (passes refer to them)
+	setupUniformBuffers();
+
+	// setup lights (passes refer to their buffers)
+	setupLights();
+
+	// describe render targets (created when a render method needs them)
+	declareFramebuffers();
+	dynamicResolution.setTarget(frameTimeTargetMs, minRenderScale, maxRenderScale);
+	dynamicResolution.setEnabled(true);
+
 	// setup paths and passes
 	setupRenderPaths();
 
@@ -1399,9 +1730,27 @@ int termGame()
 	// good practice to do this in reverse order of creation
 	//	in case something is referencing something else
 
+	// stop loading first so nothing lands in objects being deleted
+	assetLoader.shutdown();
+	jobSystem.shutdown();
+
+	// delete timer queries
+	for (int i = 0; i < numRenderMethods; ++i)
+		renderMethodGraph[i].path.setProfiling(false);
+	dynamicResolution.release();
+
 	// delete fbos
 	deleteFramebuffers();
 
+	// delete lights
+	deleteLights();
+
+	// delete uniform buffers
+	deleteUniformBuffers();
+
+	// delete texture table
+	deleteTextureTable();
+
 	// delete shaders
 	deleteShaders();
 
@@ -1411,6 +1760,9 @@ int termGame()
 	// delete geometry
 	deleteGeometry();
 
+	// cached uniform values
+	egpfwStateRelease();
+
 	// done
 	return 1;
 }
@@ -1428,6 +1780,11 @@ void displayControls()
 
 	printf("\n l = real-time reload all shaders");
 	printf("\n x = toggle coordinate axes post-draw");
+	printf("\n g = print GL state calls made/skipped last frame");
+	printf("\n f = print frame graph passes, target memory, scene queue batching and light clusters");
+	printf("\n t = toggle per-pass GPU/CPU timing bars (prints last timings)");
+	printf("\n r = toggle dynamic resolution (holds GPU frame time by rendering smaller)");
+	printf("\n b = cycle depth of field blur quality (kernel size)");
 
 	printf("\n 1-6 = change the keyframe control channel");
 	printf("\n 7-0 = change the current curve mode");
@@ -1439,6 +1796,28 @@ void displayControls()
 }
 
 
+// output state cache counters for the last frame
+void displayStateCacheStats()
+{
+	const char *kindName[STATE_KIND_COUNT] = {
+		"program", "framebuffer", "draw buffers", "capability",
+		"viewport", "vertex array", "texture", "uniform buffer", "uniform",
+	};
+	unsigned int i, issued = 0, elided = 0;
+
+	printf("\n-------------------------------------------------------");
+	printf("\n GL STATE CACHE (last frame): issued / skipped \n");
+	for (i = 0; i < STATE_KIND_COUNT; ++i)
+	{
+		printf("\n %-14s %6u / %u", kindName[i], stateCacheStats.issued[i], stateCacheStats.elided[i]);
+		issued += stateCacheStats.issued[i];
+		elided += stateCacheStats.elided[i];
+	}
+	printf("\n %-14s %6u / %u", "total", issued, elided);
+	printf("\n-------------------------------------------------------");
+}
+
+
 // process input each frame
 void handleInputState(float dt)
 {
@@ -1467,10 +1846,49 @@ void handleInputState(float dt)
 	if (egpKeyboardIsKeyPressed(keybd, 'x'))
 		testDrawAxes = 1 - testDrawAxes;
 
+	// state cache counters
+	if (egpKeyboardIsKeyPressed(keybd, 'g'))
+		displayStateCacheStats();
+
+	// frame graph summary
+	if (egpKeyboardIsKeyPressed(keybd, 'f'))
+	{
+		frameGraph.printStats();
+		sceneQueue.printStats();
+		lightClusters.printStats();
+		printf("\n Dynamic resolution: %s, %.0f%% scale, %.2f ms GPU (target %.2f ms)\n", dynamicResolution.isEnabled() ? "on" : "off",
+			dynamicResolution.getScale() * 100.0f, dynamicResolution.getGpuMs(), frameTimeTargetMs);
+	}
+
+	// dynamic resolution: off renders at full size again
+	if (egpKeyboardIsKeyPressed(keybd, 'r'))
+	{
+		dynamicResolution.setEnabled(!dynamicResolution.isEnabled());
+		if (setRenderFrameSize(viewport_tw, viewport_th))
+			activateFrameGraph();
+	}
+
+	// blur quality: the passes read the kernel when they run, so nothing is rebuilt
+	if (egpKeyboardIsKeyPressed(keybd, 'b'))
+	{
+		blurChain.setQuality((BlurQuality)((blurChain.getQuality() + 1) % blurQualityCount));
+		printf("\n Blur quality: %s, %u fetches per pass\n", BlurChain::getQualityName(blurChain.getQuality()), blurChain.getFetchCount());
+	}
+
+	// pass timings: print what was measured so far, then flip
+	if (egpKeyboardIsKeyPressed(keybd, 't'))
+	{
+		if (profilePasses)
+			activeRenderPath().printTimings();
+		profilePasses = !profilePasses;
+		activeRenderPath().setProfiling(profilePasses);
+		globalRenderNetgraph.showTimings(profilePasses ? &activeRenderPath() : nullptr, glslCommonUniforms[testSolidColorProgramIndex], 1000.0f / 60.0f);
+	}
+
 	if (egpKeyboardIsKeyPressed(keybd, 'm'))
 	{
-		++currentRenderMode;
-		setupRenderPaths();
+		RenderMethod next = currentRenderMode;
+		activateRenderMethod(++next);
 	}
 
 	if (egpKeyboardIsKeyPressed(keybd, 'n'))
@@ -1582,6 +2000,90 @@ void updateGameState(float dt)
 		marsModelMatrix = moonModelMatrix;
 		marsModelMatrix.c3.y += 2.0f;
 	}
+
+	// lights: the placed ones stay put, the made-up ones circle
+	for (unsigned int i = numLightsPlaced; i < numLights; ++i)
+	{
+		lightOrbit[i].y += dt * lightOrbit[i].z;
+		lightPos_world[i].set(cosf(lightOrbit[i].y) * lightOrbit[i].x, lightOrbit[i].w, -sinf(lightOrbit[i].y) * lightOrbit[i].x, 1.0f);
+	}
+}
+
+
+// inverse of a matrix from makePerspective, without a general 4x4 inverse
+cbmath::mat4 perspectiveInverse(const cbmath::mat4& p)
+{
+	cbmath::mat4 inv = cbmath::m4Identity;
+	inv.m00 = 1.0f / p.m00;
+	inv.m11 = 1.0f / p.m11;
+	inv.m22 = 0.0f;
+	inv.m23 = 1.0f / p.m32;
+	inv.m32 = -1.0f;
+	inv.m33 = p.m22 / p.m32;
+	return inv;
+}
+
+// fill and upload uniform blocks
+void setObjectUniforms(ObjectUniformIndex i, const cbmath::mat4& modelMat, const cbmath::mat4& atlasMat, float normalScale)
+{
+	ObjectUniformBlock* block = (ObjectUniformBlock*)(objectUniformData.data() + i * objectUniformStride);
+	const cbmath::mat4 modelInverse = cbmath::transformInverseNoScale(modelMat);
+	block->modelMat = modelMat;
+	block->atlasMat = atlasMat;
+	block->mvp = viewProjMat * modelMat;
+	block->lightPos_object = modelInverse * lightPos_world[3];
+	block->eyePos_object = modelInverse * cameraPosWorld;
+	block->normalScale = normalScale;
+	block->materialId = i + 1;
+}
+
+void updateUniformBuffers()
+{
+	FrameUniformBlock frame;
+
+	frame.viewprojMat = viewProjMat;
+	frame.eyePos = cameraPosWorld;
+
+	// cull the lights for this view; the frame block says how to find a pixel's cluster
+	lightClusters.build(lightPos_world, lightColor, numLights, viewMatrix, projectionMatrix, znear, zfar);
+	frame.clusterGrid = lightClusters.getGridParams();
+	frame.clusterDepth = lightClusters.getDepthParams();
+	frame.targetScale.set(frameGraph.getFrameScaleX(), frameGraph.getFrameScaleY(), 0.0f, 0.0f);
+	frame.viewprojMatInv = cbmath::transformInverseNoScale(viewMatrix) * perspectiveInverse(projectionMatrix);
+
+	setObjectUniforms(skyboxObject, skyboxModelMatrix, skyboxAtlasMatrix, -1.0f);
+	setObjectUniforms(earthObject, earthModelMatrix, earthAtlasMatrix, +1.0f);
+	setObjectUniforms(moonObject, moonModelMatrix, moonAtlasMatrix, +1.0f);
+	setObjectUniforms(marsObject, marsModelMatrix, marsAtlasMatrix, +1.0f);
+	setObjectUniforms(groundObject, groundModelMatrix, groundAtlasMatrix, +1.0f);
+
+	// one upload per block per frame, replacing the whole buffer so the driver can orphan it
+	egpfwUpdateUBO(&frameUBO, 0, sizeof(frame), &frame);
+	egpfwUpdateUBO(&objectUBO, 0, (unsigned int)objectUniformData.size(), objectUniformData.data());
+
+	// frame block stays bound all frame
+	egpfwBindUBO(&frameUBO, frameBlockBinding);
+}
+
+
+// distance of an object from the camera over the far plane, for sorting
+float viewDepth(const cbmath::mat4& modelMat)
+{
+	const cbmath::vec4 position_view = viewMatrix * modelMat.c3;
+	return -position_view.z / zfar;
+}
+
+// deferred scene objects go through the queue; sorted every frame since 
+//	their distances change
+void updateSceneQueue()
+{
+	sceneQueue.clear();
+	const RenderPassUniformBlockData objects = objectUniformArray();
+	sceneQueue.submit(gbufferSceneFBO, gbufferProgramIndex, 0, &scenePool, poolMesh[sphereHiResPoolMesh], viewDepth(earthModelMatrix), objects, earthObject);
+	sceneQueue.submit(gbufferSceneFBO, gbufferProgramIndex, 0, &scenePool, poolMesh[sphereLowResPoolMesh], viewDepth(moonModelMatrix), objects, moonObject);
+	sceneQueue.submit(gbufferSceneFBO, gbufferProgramIndex, 0, &scenePool, poolMesh[sphereLowResPoolMesh], viewDepth(marsModelMatrix), objects, marsObject);
+	sceneQueue.submit(gbufferSceneFBO, gbufferProgramIndex, 0, &scenePool, poolMesh[groundPoolMesh], viewDepth(groundModelMatrix), objects, groundObject);
+	sceneQueue.sort();
 }
 
 
@@ -1594,16 +2096,16 @@ void renderSkybox()
 		currentProgramIndex = testTextureProgramIndex;
 		currentProgram = glslPrograms + currentProgramIndex;
 		currentUniformSet = glslCommonUniforms[currentProgramIndex];
-		egpActivateProgram(currentProgram);
+		egpfwActivateProgram(currentProgram);
 
 		// draw skybox instead of clearing
 		glCullFace(GL_FRONT);
 		glDepthFunc(GL_ALWAYS);
-		glBindTexture(GL_TEXTURE_2D, tex[skyboxTexHandle]);
+		egpfwStateBindTexture(0, GL_TEXTURE_2D, tex[skyboxTexHandle]);
 
-		egpSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, skyboxModelViewProjectionMatrix.m);
-		egpActivateVAO(vao + skyboxModel);
-		egpDrawActiveVAO();
+		egpfwSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, skyboxModelViewProjectionMatrix.m);
+		egpfwActivateVAO(vao + skyboxModel);
+		egpfwDrawActiveVAO();
 
 		glDepthFunc(GL_LESS);
 		glCullFace(GL_BACK);
@@ -1615,26 +2117,22 @@ void renderSkybox()
 		currentProgramIndex = gbufferProgramIndex;
 		currentProgram = glslPrograms + currentProgramIndex;
 		currentUniformSet = glslCommonUniforms[currentProgramIndex];
-		egpActivateProgram(currentProgram);
-
-		// send common uniforms first
-		egpSendUniformFloatMatrix(currentUniformSet[unif_viewprojMat], UNIF_MAT4, 1, 0, viewProjMat.m);
+		egpfwActivateProgram(currentProgram);
 
 		// background
+		// skybox range has its normals inverted; every other object's range has them as-is
+		// the program reads objects by draw index, so the skybox is drawn as one
 		{
-			// normal scaling adjustment values
-			const float normalScale[2] = { -1.0f, +1.0f };
+			const RenderPassUniformBlockData objects = objectUniformArray();
 
 			glCullFace(GL_FRONT);
 			glDepthFunc(GL_ALWAYS);
-			egpSendUniformFloat(currentUniformSet[unif_normalScale], UNIF_FLOAT, 1, normalScale);	// invert
+			egpfwBindUBORange(objects.ubo, objects.binding, objects.offset, objects.size);
+			egpfwSetDrawIndex(skyboxObject);
 
-			egpSendUniformFloatMatrix(currentUniformSet[unif_modelMat], UNIF_MAT4, 1, 0, skyboxModelMatrix.m);
-			egpSendUniformFloatMatrix(currentUniformSet[unif_atlasMat], UNIF_MAT4, 1, 0, skyboxAtlasMatrix.m);
-			egpActivateVAO(vao + skyboxModel);
-			egpDrawActiveVAO();
+			egpfwActivateVAO(vao + skyboxModel);
+			egpfwDrawActiveVAO();
 
-			egpSendUniformFloat(currentUniformSet[unif_normalScale], UNIF_FLOAT, 1, normalScale + 1);
 			glDepthFunc(GL_LESS);
 			glCullFace(GL_BACK);
 		}
@@ -1660,26 +2158,26 @@ void renderCurve()
 	currentProgramIndex = drawCurveProgram;
 	currentProgram = glslPrograms + currentProgramIndex;
 	currentUniformSet = glslCommonUniforms[currentProgramIndex];
-	egpActivateProgram(currentProgram);
-	egpSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, curveDrawingProjectionMatrix.m);
+	egpfwActivateProgram(currentProgram);
+	egpfwSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, curveDrawingProjectionMatrix.m);
 
 	// ship waypoint data to program, where it will be received by GS
-	egpSendUniformFloat(currentUniformSet[unif_waypoint], UNIF_VEC4, waypointCount, waypoint->v);
-	egpSendUniformInt(currentUniformSet[unif_waypointCount], UNIF_INT, 1, &waypointCount);
-	egpSendUniformInt(currentUniformSet[unif_curveMode], UNIF_INT, 1, &curveMode);
-	egpSendUniformInt(currentUniformSet[unif_useWaypoints], UNIF_INT, 1, &useWaypoints);
+	egpfwSendUniformFloat(currentUniformSet[unif_waypoint], UNIF_VEC4, waypointCount, waypoint->v);
+	egpfwSendUniformInt(currentUniformSet[unif_waypointCount], UNIF_INT, 1, &waypointCount);
+	egpfwSendUniformInt(currentUniformSet[unif_curveMode], UNIF_INT, 1, &curveMode);
+	egpfwSendUniformInt(currentUniformSet[unif_useWaypoints], UNIF_INT, 1, &useWaypoints);
 
-	egpActivateVAO(vao + pointModel);
-	egpDrawActiveVAO();
+	egpfwActivateVAO(vao + pointModel);
+	egpfwDrawActiveVAO();
 
 	// draw waypoints using solid color program and sphere model
 	currentProgramIndex = testSolidColorProgramIndex;
 	currentProgram = glslPrograms + currentProgramIndex;
 	currentUniformSet = glslCommonUniforms[currentProgramIndex];
-	egpActivateProgram(currentProgram);
-	egpSendUniformFloat(currentUniformSet[unif_color], UNIF_VEC4, 1, waypointColor.v);
+	egpfwActivateProgram(currentProgram);
+	egpfwSendUniformFloat(currentUniformSet[unif_color], UNIF_VEC4, 1, waypointColor.v);
 
-	egpActivateVAO(vao + sphere8x6Model);
+	egpfwActivateVAO(vao + sphere8x6Model);
 
 	// draw waypoints
 	for (i = 0, waypointPtr = waypoint; i < waypointCount; ++i, ++waypointPtr)
@@ -1687,8 +2185,8 @@ void renderCurve()
 		// set position, update MVP for this waypoint and draw
 		waypointModelMatrix.c3 = *waypointPtr;
 		waypointMVP = curveDrawingProjectionMatrix * waypointModelMatrix;
-		egpSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, waypointMVP.m);
-		egpDrawActiveVAO();
+		egpfwSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, waypointMVP.m);
+		egpfwDrawActiveVAO();
 	}
 
 
@@ -1700,12 +2198,27 @@ void renderCurve()
 // DRAWING AND UPDATING SHOULD BE SEPARATE (good practice)
 void renderGameState()
 {
+	// resolution follows GPU time; changing it only moves the targets' 
+	//	viewports, so it's done before the frame's uniforms go up
+	if (dynamicResolution.update() && setRenderFrameSize(viewport_tw, viewport_th))
+		activateFrameGraph();
+
+	// per-frame and per-object uniforms go up once, before anything draws
+	updateUniformBuffers();
+	egpfwActivateTextureTable(&textureTable, textureTableBlockBinding);
+	if (currentRenderMode == deferredRenderMethod)
+		updateSceneQueue();
+
+	// GPU timing starts only now, so the time the GPU spends waiting 
+	//	on the preparation above doesn't count as its own
+	dynamicResolution.beginFrame();
+
 	// first pass: scene
 
 	renderSkybox(); //We "hardcode" this because it requires special GL calls that the RenderPass can't handle.
 
 	// Complete our currently selected render path (draws all objects, and whatever other passes are needed).
-	globalRenderPath.render();
+	activeRenderPath().render();
 
 	egpfwActivateFBO(fbo + curvesFBO);
 	keyframeWindow.renderToFBO(glslCommonUniforms[drawCurveProgram], glslCommonUniforms[testSolidColorProgramIndex], speedControlWindow.getTVal(keyframeWindow.getCurrentChannel()));
@@ -1726,13 +2239,15 @@ void renderGameState()
 		// use texturing program, no mvp
 		currentProgramIndex = testTexturePassthruProgramIndex;
 		currentProgram = glslPrograms + currentProgramIndex;
-		egpActivateProgram(currentProgram);
-		egpActivateVAO(vao + fsqModel);
+		egpfwActivateProgram(currentProgram);
+		egpfwActivateVAO(vao + fsqModel);
 
 		// Get the fbo we want by grabbing it directly from the netgraph (whether it's visible or not).
+		// Only part of it was drawn at the dynamic resolution; the quad's texcoords cover that part, so it's stretched 
+		//	over the whole window with bilinear filtering.
 		FBOTargetColorTexture bg = globalRenderNetgraph.getFBOAtIndex(displayMode);
 		egpfwBindColorTargetTexture(fbo + bg.fboIndex, 0, bg.targetIndex);
-		egpDrawActiveVAO();
+		egpfwDrawActiveVAO();
 
 		keyframeWindow.renderToBackbuffer(glslCommonUniforms[testTextureProgramIndex]);
 		speedControlWindow.renderToBackbuffer(glslCommonUniforms[testTextureProgramIndex]);
@@ -1740,8 +2255,12 @@ void renderGameState()
 		/*if (displayNetgraphToggle)
 			globalRenderNetgraph.render();*/
 
+		// timing bars draw on their own; they're empty unless profiling
+		if (displayNetgraphToggle)
+			globalRenderNetgraph.renderTimings();
+
 		// done with textures
-		glBindTexture(GL_TEXTURE_2D, 0);
+		egpfwStateBindTexture(0, GL_TEXTURE_2D, 0);
 
 		// TEST DRAW: coordinate axes at center of spaces
 		//	and other line objects
@@ -1750,24 +2269,27 @@ void renderGameState()
 			currentProgramIndex = testColorProgramIndex;
 			currentProgram = glslPrograms + currentProgramIndex;
 			currentUniformSet = glslCommonUniforms[currentProgramIndex];
-			egpActivateProgram(currentProgram);
-			egpSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, viewProjMat.m);
+			egpfwActivateProgram(currentProgram);
+			egpfwSendUniformFloatMatrix(currentUniformSet[unif_mvp], UNIF_MAT4, 1, 0, viewProjMat.m);
 
 			// center of world
 			// (this is useful to see where the origin is and how big one unit is)
-			egpActivateVAO(vao + axesModel);
-			egpDrawActiveVAO();
+			egpfwActivateVAO(vao + axesModel);
+			egpfwDrawActiveVAO();
 		}
 
 		// done
-		glEnable(GL_DEPTH_TEST);
+		egpfwStateSetCapability(GL_DEPTH_TEST, 1);
 	}
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
 	// disable all renderables, shaders
-	egpActivateProgram(0);
-	egpActivateVAO(0);
+	egpfwActivateProgram(0);
+	egpfwActivateVAO(0);
+
+	// everything for this frame has been sent
+	dynamicResolution.endFrame();
 }
 
 
@@ -1786,9 +2308,11 @@ int idle()
 	if (egpTimerUpdate(renderTimer))
 	{
 		///////////////////////////////////////////////////////////////////////
+		assetLoader.processUploads();
 		updateGameState(renderTimer->dt);
 		handleInputState(renderTimer->dt);
 		renderGameState();
+		egpfwStateEndFrame(&stateCacheStats);
 		///////////////////////////////////////////////////////////////////////
 		ret = 1;
 	}
@@ -1834,10 +2358,9 @@ void onResizeWindow(int w, int h)
 		minClipDist = (float)((unsigned int)(sqrtf(zfar*zfar / 3.0f)));
 	}
 
-	// if framebuffers are backed against the size of the main window, then 
-	//	it's probably a good idea to tear down and remake the framebuffers...
-	deleteFramebuffers();
-	setupFramebuffers(viewport_tw, viewport_th);
+	// framebuffers are backed against the size of the main window, but 
+	//	the render path's are big enough already and only need a new viewport
+	resizeFramebuffers(viewport_tw, viewport_th);
 
 	//-----------------------------------------------------------------------------
 	// setup curve drawing camera